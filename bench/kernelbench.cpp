@@ -0,0 +1,410 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+// Kernel benchmark suite. Build and run it in a simulator with `make sim-bench`
+// (see `SIM` in the `makefile`), or flash the resulting elf. Each test is run
+// in turn, then the results are sent out of USART0 as CSV, in CPU cycles:
+//
+//     # zero kernelbench,1,<MHz>
+//     test,count,min,max,avg
+//     yield,...
+//     ...
+//     end
+//
+// after which the MCU sleeps with interrupts off (which ends a simavr run).
+// The cost of taking the timestamps has already been subtracted. Lines for
+// the same test can be compared between commits.
+//
+// Timer1 free-runs at the CPU clock (as for `make bench`), so nothing longer
+// than 65535 cycles can be timed.
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "pipe.h"
+#include "usart.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    // One line of the results
+    struct BenchResult {
+        const char* name;                               // pointer to Flash, not SRAM
+        SwitchBench cycles;
+    };
+
+    const uint8_t MAX_RESULTS{ 16 };
+    const uint16_t WAKE_ROUNDS{ 256 };
+    const uint8_t MEMORY_BLOCKS{ 16 };
+    const uint8_t MEMORY_ROUNDS{ 16 };
+    const uint16_t PIPE_BYTES{ 64 };
+    const uint8_t PIPE_CHUNK_BYTES{ 32 };
+    const uint8_t PIPE_ROUNDS{ 32 };
+    const uint8_t USART_TX_BYTES{ 64 };
+    const uint32_t USART_TX_BAUD{ 1000000UL };          // fast enough that the ISR is most of the work
+    const uint16_t SPIN_LOOPS{ 4000 };
+    const uint32_t REPORT_BAUD{ 115200UL };
+
+    BenchResult _results[ MAX_RESULTS ];
+    uint8_t _numResults{ 0 };
+    uint16_t _stampCycles{ 0 };                         // what a pair of stamp()s costs
+
+    volatile bool _running{ false };                    // keeps the helper Threads going
+    volatile uint16_t _signalledAt{ 0 };
+    const Synapse* volatile _sleeperSyn{ nullptr };
+    const Synapse* _benchSyn{ nullptr };
+    SwitchBench* _wakeCycles{ nullptr };
+
+
+    // Reads Timer1. TCNT1 is read a byte at a time, through a register that
+    // the switch benchmark's ISRs share, so interrupts have to be off.
+    uint16_t stamp()
+    {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            return TCNT1;
+        }
+    }
+
+
+    // Starts a new line of results
+    SwitchBench& addResult( const char* const name )
+    {
+        BenchResult& r{ _results[ ( _numResults < MAX_RESULTS ) ? _numResults++ : MAX_RESULTS - 1 ] };
+
+        r.name = name;
+        r.cycles = SwitchBench{ 0UL, 0UL, 0xFFFF, 0 };
+
+        return r.cycles;
+    }
+
+
+    // Adds one measurement to a line of results
+    void record( SwitchBench& b, const uint16_t cycles )
+    {
+        b.count++;
+        b.totalCycles += cycles;
+        b.minCycles = ( cycles < b.minCycles ) ? cycles : b.minCycles;
+        b.maxCycles = ( cycles > b.maxCycles ) ? cycles : b.maxCycles;
+    }
+
+
+    // Adds the time between two stamp()s to a line of results
+    void record( SwitchBench& b, const uint16_t startedAt, const uint16_t endedAt )
+    {
+        const uint16_t elapsed{ (uint16_t) ( endedAt - startedAt ) };
+
+        record( b, ( elapsed > _stampCycles ) ? (uint16_t) ( elapsed - _stampCycles ) : (uint16_t) 0 );
+    }
+
+
+    // Waits to be signalled by benchWake(), timing how long it took to get here
+    int sleeperThread()
+    {
+        Synapse syn;
+        _sleeperSyn = &syn;
+
+        while ( _running ) {
+            if ( syn.wait( 100_ms ) & syn ) {
+                const uint16_t now{ stamp() };
+
+                record( *_wakeCycles, _signalledAt, now );
+                _benchSyn->signal();
+            }
+        }
+
+        _sleeperSyn = nullptr;
+
+        return 0;
+    }
+
+
+    // Burns its quantum, to be pre-empted
+    int spinThread()
+    {
+        while ( _running ) {
+            // burn
+        }
+
+        return 0;
+    }
+
+
+    // Times signal() to the moment the signalled Thread returns from wait(), and
+    // (along the way) the yield() path
+    void benchWake()
+    {
+        Synapse syn;
+        Synapse doneSyn;
+
+        _benchSyn = &syn;
+        _running = true;
+
+        new Thread( PSTR( "sleeper" ), 128, sleeperThread, TF_READY, &doneSyn );
+
+        while ( !_sleeperSyn ) {
+            me.delay( 1_ms );
+        }
+
+        _wakeCycles = &addResult( PSTR( "signal_wake" ) );
+        Thread::resetSwitchBench();
+
+        for ( uint16_t i = 0; i < WAKE_ROUNDS; i++ ) {
+            _signalledAt = stamp();
+            _sleeperSyn->signal();
+            syn.wait( 100_ms );
+        }
+
+        addResult( PSTR( "yield" ) ) = Thread::getSwitchBench( SwitchPath::Yield );
+
+        _running = false;
+        doneSyn.wait();
+    }
+
+
+    // Times the tick ISR, with and without pre-emption, by letting two Threads
+    // fight over the MCU for a second
+    void benchPreempt()
+    {
+        Synapse doneSyn1;
+        Synapse doneSyn2;
+
+        _running = true;
+
+        new Thread( PSTR( "spin1" ), 128, spinThread, TF_READY, &doneSyn1 );
+        new Thread( PSTR( "spin2" ), 128, spinThread, TF_READY, &doneSyn2 );
+
+        Thread::resetSwitchBench();
+        me.delay( 1_secs );
+
+        addResult( PSTR( "tick" ) ) = Thread::getSwitchBench( SwitchPath::Tick );
+        addResult( PSTR( "preempt" ) ) = Thread::getSwitchBench( SwitchPath::Preempt );
+
+        _running = false;
+        doneSyn1.wait();
+        doneSyn2.wait();
+    }
+
+
+    // Times allocate() and free() of two pages, with one page in every holeEvery
+    // of the heap free (0 for none), so that every hole is too small
+    void benchMemory( const char* const allocName, const char* const freeName, const uint8_t holeEvery )
+    {
+        void* blocks[ MEMORY_BLOCKS ];
+
+        for ( uint8_t i = 0; i < MEMORY_BLOCKS; i++ ) {
+            blocks[ i ] = memory::allocate( PAGE_BYTES );
+        }
+
+        for ( uint8_t i = 0; holeEvery and i < MEMORY_BLOCKS; i += holeEvery ) {
+            if ( blocks[ i ] ) {
+                memory::free( blocks[ i ], PAGE_BYTES );
+                blocks[ i ] = nullptr;
+            }
+        }
+
+        SwitchBench& allocs{ addResult( allocName ) };
+        SwitchBench& frees{ addResult( freeName ) };
+
+        for ( uint8_t i = 0; i < MEMORY_ROUNDS; i++ ) {
+            const uint16_t t0{ stamp() };
+            void* const p{ memory::allocate( 2 * PAGE_BYTES ) };
+            const uint16_t t1{ stamp() };
+            if ( p ) {
+                memory::free( p, 2 * PAGE_BYTES );
+            }
+            const uint16_t t2{ stamp() };
+
+            record( allocs, t0, t1 );
+            record( frees, t1, t2 );
+        }
+
+        for ( uint8_t i = 0; i < MEMORY_BLOCKS; i++ ) {
+            if ( blocks[ i ] ) {
+                memory::free( blocks[ i ], PAGE_BYTES );
+            }
+        }
+    }
+
+
+    // Times a chunk written to a Pipe and read back out again
+    void benchPipe()
+    {
+        Pipe p{ PIPE_BYTES };
+        uint8_t chunk[ PIPE_CHUNK_BYTES ];
+
+        memset( chunk, 0x55, sizeof( chunk ) );
+
+        SwitchBench& writes{ addResult( PSTR( "pipe_write32" ) ) };
+        SwitchBench& reads{ addResult( PSTR( "pipe_read32" ) ) };
+
+        for ( uint8_t i = 0; p and i < PIPE_ROUNDS; i++ ) {
+            const uint16_t t0{ stamp() };
+            p.write( chunk, sizeof( chunk ) );
+            const uint16_t t1{ stamp() };
+            p.read( chunk, sizeof( chunk ) );
+            const uint16_t t2{ stamp() };
+
+            record( writes, t0, t1 );
+            record( reads, t1, t2 );
+        }
+    }
+
+
+    // Busy-waits, for timing how much of the MCU the ISRs take
+    uint16_t spin()
+    {
+        const uint16_t t0{ stamp() };
+
+        for ( volatile uint16_t i = 0; i < SPIN_LOOPS; i++ ) {
+            // empty
+        }
+
+        return stamp() - t0;
+    }
+
+
+    // Works out the UsartTx ISR cost per byte, from how much longer a busy
+    // loop takes while a buffer is being sent
+    void benchUsartTx()
+    {
+        Synapse readySyn;
+        UsartTx tx{ 0, USART_TX_BAUD, readySyn };
+        uint8_t buffer[ USART_TX_BYTES ];
+
+        memset( buffer, 'U', sizeof( buffer ) );
+
+        SwitchBench& perByte{ addResult( PSTR( "usart_tx_isr" ) ) };
+
+        if ( !tx ) {
+            return;
+        }
+
+        for ( uint8_t i = 0; i < 8; i++ ) {
+            Thread::forbid();
+
+            const uint16_t idle{ spin() };
+            tx.transmit( buffer, sizeof( buffer ) );
+            const uint16_t busy{ spin() };
+
+            Thread::permit();
+
+            while ( tx.isBusy() ) {
+                readySyn.wait( 10_ms );
+            }
+
+            // the whole buffer goes out within one spin(), at this baud
+            record( perByte, ( busy > idle ) ? (uint16_t) ( ( busy - idle ) / USART_TX_BYTES ) : (uint16_t) 0 );
+        }
+    }
+
+
+    // Sends a line of text out of the report UsartTx, and waits for it to go
+    void send( UsartTx& tx, Synapse& readySyn, const char* const line )
+    {
+        tx.transmit( line, strlen( line ) );
+
+        while ( tx.isBusy() ) {
+            readySyn.wait( 10_ms );
+        }
+    }
+
+
+    // Sends one result, as a line of CSV
+    void report( UsartTx& tx, Synapse& readySyn, const BenchResult& r )
+    {
+        const SwitchBench& b{ r.cycles };
+        char line[ 64 ];
+        char* p{ line };
+
+        strncpy_P( p, r.name, 20 );
+        p[ 20 ] = '\0';
+        p += strlen( p );
+
+        *p++ = ',';
+        ultoa( b.count, p, 10 );
+        p += strlen( p );
+
+        *p++ = ',';
+        utoa( b.count ? b.minCycles : 0, p, 10 );
+        p += strlen( p );
+
+        *p++ = ',';
+        utoa( b.maxCycles, p, 10 );
+        p += strlen( p );
+
+        *p++ = ',';
+        ultoa( b.count ? b.totalCycles / b.count : 0UL, p, 10 );
+        p += strlen( p );
+
+        strcpy_P( p, PSTR( "\r\n" ) );
+
+        send( tx, readySyn, line );
+    }
+
+
+    int benchThread()
+    {
+        // how much a measurement costs on its own
+        const uint16_t t0{ stamp() };
+        const uint16_t t1{ stamp() };
+        _stampCycles = t1 - t0;
+
+        benchWake();
+        benchPreempt();
+        benchMemory( PSTR( "alloc_frag0" ), PSTR( "free_frag0" ), 0 );
+        benchMemory( PSTR( "alloc_frag25" ), PSTR( "free_frag25" ), 4 );
+        benchMemory( PSTR( "alloc_frag50" ), PSTR( "free_frag50" ), 2 );
+        benchPipe();
+        benchUsartTx();
+
+        // now it's safe to use USART0 for the results
+        Synapse readySyn;
+        UsartTx tx{ 0, REPORT_BAUD, readySyn };
+        char line[ 64 ];
+
+        if ( tx ) {
+            strcpy_P( line, PSTR( "# zero kernelbench,1," ) );
+            utoa( F_CPU_MHZ, line + strlen( line ), 10 );
+            strcat_P( line, PSTR( "\r\ntest,count,min,max,avg\r\n" ) );
+            send( tx, readySyn, line );
+
+            for ( uint8_t i = 0; i < _numResults; i++ ) {
+                report( tx, readySyn, _results[ i ] );
+            }
+
+            strcpy_P( line, PSTR( "end\r\n" ) );
+            send( tx, readySyn, line );
+        }
+
+        // done - simavr takes this as the end of the run
+        cli();
+        sleep_enable();
+        sleep_cpu();
+
+        return 0;
+    }
+
+}    // namespace
+
+
+int main()
+{
+    new Thread( PSTR( "bench" ), 320, benchThread );
+}
@@ -0,0 +1,115 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+// Context switch benchmark. Build with `make bench`, then flash (or simulate)
+// the resulting elf. Every second, one CSV line per switch path is
+// printed on the debug pin:
+//
+//     path,count,min,max,avg
+//
+// Two Threads ping-pong a signal back and forth (the yield() path), while
+// a third spins, being pre-empted as its quantum runs out.
+
+
+#include <avr/pgmspace.h>
+
+#include "thread.h"
+#include "debug.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    const Synapse* _ping{ nullptr };
+    const Synapse* _pong{ nullptr };
+
+
+    int pingThread()
+    {
+        Synapse syn;
+        _ping = &syn;
+
+        while ( true ) {
+            syn.wait();
+
+            if ( _pong ) {
+                _pong->signal();
+            }
+        }
+    }
+
+
+    int pongThread()
+    {
+        Synapse syn;
+        _pong = &syn;
+
+        while ( true ) {
+            if ( _ping ) {
+                _ping->signal();
+            }
+
+            syn.wait( 10_ms );
+        }
+    }
+
+
+    int spinThread()
+    {
+        while ( true ) {
+            // burn
+        }
+    }
+
+
+    void report( const char* const name, const SwitchPath path )
+    {
+        const SwitchBench b{ Thread::getSwitchBench( path ) };
+
+        debug::print( name, true );
+        debug::print( ',' );
+        debug::print( (uint16_t) b.count );
+        debug::print( ',' );
+        debug::print( b.count ? b.minCycles : (uint16_t) 0 );
+        debug::print( ',' );
+        debug::print( b.maxCycles );
+        debug::print( ',' );
+        debug::print( b.count ? (uint16_t) ( b.totalCycles / b.count ) : (uint16_t) 0 );
+        debug::print( "\r\n" );
+    }
+
+
+    int reportThread()
+    {
+        while ( true ) {
+            Thread::resetSwitchBench();
+            me.delay( 1_secs );
+
+            // don't let the printing colour the numbers
+            Thread::forbid();
+
+            report( PSTR( "yield" ), SwitchPath::Yield );
+            report( PSTR( "tick" ), SwitchPath::Tick );
+            report( PSTR( "preempt" ), SwitchPath::Preempt );
+
+            Thread::permit();
+        }
+    }
+
+}    // namespace
+
+
+int main()
+{
+    new Thread( PSTR( "ping" ), 128, pingThread );
+    new Thread( PSTR( "pong" ), 128, pongThread );
+    new Thread( PSTR( "spin" ), 128, spinThread );
+    new Thread( PSTR( "report" ), 192, reportThread );
+}
@@ -0,0 +1,109 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include "arena.h"
+#include "memory.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates an Arena, reserving its memory from the heap
+/// @param capacity The number of bytes to reserve.
+/// @param strategy Optional. Default: SearchStrategy::BottomUp. The method used to search
+/// the heap for free memory.
+/// @note The capacity is rounded up to a whole number of pages, and the extra bytes
+/// can be used too. Check the Arena with `operator bool()` before using it.
+Arena::Arena( const uint16_t capacity, const memory::SearchStrategy strategy )
+:
+    _base{ (uint8_t*) memory::allocate( capacity, &_capacity, strategy ) }
+{
+    // empty
+}
+
+
+/// @brief Gives the Arena's memory back to the heap
+/// @note Anything allocated from the Arena must not be used after this.
+Arena::~Arena()
+{
+    memory::free( _base, _capacity );
+}
+
+
+/// @brief Determines if the Arena got its memory from the heap
+/// @returns `true` if the Arena can be allocated from, `false` otherwise.
+Arena::operator bool() const
+{
+    return _base != nullptr;
+}
+
+
+/// @brief Takes a number of bytes from the Arena
+/// @param numBytes The number of bytes required.
+/// @returns A pointer to the bytes, or `nullptr` if there aren't enough left.
+/// @note No critical section is entered - only the owning Thread should allocate.
+void* Arena::allocate( const uint16_t numBytes )
+{
+    if ( numBytes > _capacity - _used ) {
+        return nullptr;
+    }
+
+    void* const rc{ _base + _used };
+    _used += numBytes;
+
+    return rc;
+}
+
+
+/// @brief Releases everything allocated from the Arena, keeping its memory for reuse
+void Arena::reset()
+{
+    _used = 0;
+}
+
+
+/// @brief Remembers how much of the Arena has been used, for a later rewind()
+/// @returns A mark to pass to rewind().
+uint16_t Arena::getMark() const
+{
+    return _used;
+}
+
+
+/// @brief Releases everything allocated since a mark was taken
+/// @param mark A value previously returned by getMark().
+void Arena::rewind( const uint16_t mark )
+{
+    if ( mark < _used ) {
+        _used = mark;
+    }
+}
+
+
+/// @brief Gets the total size of the Arena
+/// @returns The number of bytes that can be allocated from an empty Arena.
+uint16_t Arena::getCapacity() const
+{
+    return _capacity;
+}
+
+
+/// @brief Gets the number of bytes allocated from the Arena so far
+/// @returns The number of bytes used.
+uint16_t Arena::getUsedBytes() const
+{
+    return _used;
+}
+
+
+/// @brief Gets the number of bytes left in the Arena
+/// @returns The number of bytes that can still be allocated.
+uint16_t Arena::getFreeBytes() const
+{
+    return _capacity - _used;
+}
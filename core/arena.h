@@ -0,0 +1,50 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_ARENA_H
+#define TCRI_ZERO_ARENA_H
+
+
+#include <stdint.h>
+#include "memory.h"
+
+
+namespace zero {
+
+    /// @brief A region of memory handed out by bumping a pointer, and given back all at once
+    /// @details An Arena takes one contiguous chunk from memory::allocate() when it's
+    /// created. allocate() just moves a pointer along that chunk - there's no locking,
+    /// no page map, and nothing to free one at a time. reset() (or the Arena going out
+    /// of scope) gives the lot back.
+    /// @note An Arena belongs to the Thread that uses it. It is not safe to allocate
+    /// from one Arena in more than one Thread.
+    class Arena {
+    public:
+        Arena(
+            const uint16_t capacity,                    // number of bytes to reserve from the heap
+            const memory::SearchStrategy strategy = memory::SearchStrategy::BottomUp );
+        ~Arena();
+
+        explicit operator bool() const;                 // Determines if the Arena got its memory
+
+        void* allocate( const uint16_t numBytes );      // takes bytes from the Arena
+        void reset();                                   // releases everything allocated so far
+
+        uint16_t getMark() const;                       // remembers how far the Arena has been used
+        void rewind( const uint16_t mark );             // releases everything allocated since getMark()
+
+        uint16_t getCapacity() const;                   // total bytes in the Arena
+        uint16_t getUsedBytes() const;                  // bytes allocated so far
+        uint16_t getFreeBytes() const;                  // bytes left to allocate
+
+        #include "arena_private.h"
+    };
+
+}    // namespace zero
+
+#endif
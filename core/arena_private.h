@@ -0,0 +1,18 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+
+private:
+    Arena( const Arena& a ) = delete;
+    void operator=( const Arena& a ) = delete;
+
+    uint16_t _capacity{ 0 };                            // declared before _base, whose initialiser sets it
+    uint8_t* const _base;
+    uint16_t _used{ 0 };
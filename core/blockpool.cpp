@@ -0,0 +1,118 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include <util/atomic.h>
+
+#include "blockpool.h"
+#include "memory.h"
+
+
+using namespace zero;
+
+
+/// @brief Takes the pool's storage from the heap, if it doesn't have it already
+/// @returns `true` if the pool has its storage, `false` if the heap couldn't provide it.
+/// @note Not to be called from an ISR. Until this has succeeded, allocate() has nothing
+/// to hand out.
+template <uint16_t BLOCK_BYTES, uint16_t BLOCK_COUNT>
+bool BlockPool<BLOCK_BYTES, BLOCK_COUNT>::reserve()
+{
+    if ( !_blocks ) {
+        // first time through, so go and get some storage
+        uint8_t* const storage{ (uint8_t*) memory::allocate( BLOCK_BYTES * BLOCK_COUNT ) };
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            if ( !_blocks ) {
+                _blocks = storage;
+                _untouched = storage ? BLOCK_COUNT : 0;
+            }
+            else {
+                // someone else beat us to it
+                memory::free( storage, BLOCK_BYTES * BLOCK_COUNT );
+            }
+        }
+    }
+
+    return _blocks != nullptr;
+}
+
+
+/// @brief Allocates a block from the pool
+/// @returns A pointer to the block, or `nullptr` if there are no free blocks (or the
+/// pool has no storage, see reserve()).
+/// @note May be called from within an ISR. Allocation takes the same short, fixed time
+/// every call, and never goes to the heap.
+template <uint16_t BLOCK_BYTES, uint16_t BLOCK_COUNT>
+void* BlockPool<BLOCK_BYTES, BLOCK_COUNT>::allocate()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        void* rc{ nullptr };
+
+        if ( _freeList ) {
+            rc = _freeList;
+            _freeList = *(void**) rc;
+        }
+        else if ( _untouched ) {
+            rc = _blocks + ( --_untouched * BLOCK_BYTES );
+        }
+
+        if ( rc ) {
+            _inUse++;
+        }
+
+        return rc;
+    }
+}
+
+
+/// @brief Gives a block back to the pool
+/// @param p The block to free.
+/// @returns `true` if the block belongs to this pool (and was freed), `false` otherwise.
+/// @note May be called from within an ISR.
+template <uint16_t BLOCK_BYTES, uint16_t BLOCK_COUNT>
+bool BlockPool<BLOCK_BYTES, BLOCK_COUNT>::free( void* const p )
+{
+    if ( !owns( p ) ) {
+        return false;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        *(void**) p = _freeList;
+        _freeList = p;
+        _inUse--;
+    }
+
+    return true;
+}
+
+
+/// @brief Determines if a block belongs to this pool
+/// @param p The block to check.
+/// @returns `true` if the block is part of this pool's storage, `false` otherwise.
+template <uint16_t BLOCK_BYTES, uint16_t BLOCK_COUNT>
+bool BlockPool<BLOCK_BYTES, BLOCK_COUNT>::owns( const void* const p ) const
+{
+    return _blocks and
+           (const uint8_t*) p >= _blocks and
+           (const uint8_t*) p < _blocks + ( BLOCK_BYTES * BLOCK_COUNT );
+}
+
+
+/// @brief Gets the number of blocks available
+/// @returns The number of blocks that can be allocated before the pool is empty, or `0`
+/// if the pool has no storage.
+template <uint16_t BLOCK_BYTES, uint16_t BLOCK_COUNT>
+uint16_t BlockPool<BLOCK_BYTES, BLOCK_COUNT>::getFreeCount() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _blocks ? BLOCK_COUNT - _inUse : 0;
+    }
+}
+
+
+#include "blockpool_classes.h"
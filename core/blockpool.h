@@ -0,0 +1,48 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_BLOCKPOOL_H
+#define TCRI_ZERO_BLOCKPOOL_H
+
+
+#include <stdint.h>
+
+
+namespace zero {
+
+    /// @brief Provides O(1) allocation of fixed-size blocks
+    /// @details The pool's storage is taken from the heap, in one piece, by reserve().
+    /// After that, allocating and freeing a block is just a matter of popping or pushing a
+    /// free list, with no searching and no rounding up to a page.
+    /// @tparam BLOCK_BYTES The size of each block, in bytes.
+    /// @tparam BLOCK_COUNT The number of blocks in the pool.
+    /// @note BlockPools must be global (or static), since they rely on starting out
+    /// zeroed rather than on a constructor, so that they work even before `main()`.
+    /// @note Call reserve() from a Thread (or before `main()`) before allocating - until
+    /// then, the pool is empty.
+    /// @note To make a pool of your own, for example `BlockPool<sizeof( MyThing ), 8>`,
+    /// add it to `blockpool_classes.h`.
+    template <uint16_t BLOCK_BYTES, uint16_t BLOCK_COUNT>
+    class BlockPool {
+
+        static_assert( BLOCK_BYTES >= sizeof( void* ), "BlockPool blocks must be able to hold a pointer" );
+        static_assert( BLOCK_COUNT > 0, "BlockPool must have at least one (1) block" );
+
+    public:
+        bool reserve();
+        void* allocate();
+        bool free( void* const p );
+        bool owns( const void* const p ) const;
+        uint16_t getFreeCount() const;
+
+        #include "blockpool_private.h"
+    };
+
+}    // namespace zero
+
+#endif
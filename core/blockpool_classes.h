@@ -0,0 +1,28 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+namespace zero {
+
+    #ifdef ZERO_BLOCK_POOLS
+        // the size classes used by new and delete
+        template class BlockPool<BLOCK_POOL_SMALL_BYTES, BLOCK_POOL_SMALL_COUNT>;
+        template class BlockPool<BLOCK_POOL_MEDIUM_BYTES, BLOCK_POOL_MEDIUM_COUNT>;
+        template class BlockPool<BLOCK_POOL_LARGE_BYTES, BLOCK_POOL_LARGE_COUNT>;
+    #endif
+
+    #ifdef ZERO_ISR_POOL
+        // the buffers ISRs allocate from, unless it's the same shape as one of the above
+        #if !defined( ZERO_BLOCK_POOLS ) or ( \
+            !( ISR_POOL_BLOCK_BYTES == BLOCK_POOL_SMALL_BYTES and ISR_POOL_BLOCK_COUNT == BLOCK_POOL_SMALL_COUNT ) and \
+            !( ISR_POOL_BLOCK_BYTES == BLOCK_POOL_MEDIUM_BYTES and ISR_POOL_BLOCK_COUNT == BLOCK_POOL_MEDIUM_COUNT ) and \
+            !( ISR_POOL_BLOCK_BYTES == BLOCK_POOL_LARGE_BYTES and ISR_POOL_BLOCK_COUNT == BLOCK_POOL_LARGE_COUNT ) )
+            template class BlockPool<ISR_POOL_BLOCK_BYTES, ISR_POOL_BLOCK_COUNT>;
+        #endif
+    #endif
+
+}
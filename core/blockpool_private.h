@@ -0,0 +1,16 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+
+private:
+    uint8_t* _blocks;                                   // the pool's storage, once it has some
+    void* _freeList;                                    // blocks that have been used and given back
+    uint16_t _untouched;                                // blocks (from the end) that have never been used
+    uint16_t _inUse;                                    // blocks currently handed out
@@ -16,9 +16,19 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <util/delay.h>
+#include <util/atomic.h>
 
 #include "debug.h"
-#include "gpio.h"
+#include "fastpin.h"
+#include "thread.h"
+
+#ifdef DEBUG_BUFFERED
+    #ifndef ZERO_DRIVERS_SUART
+        #error "DEBUG_BUFFERED needs ZERO_DRIVERS_SUART to drain the debug ring"
+    #endif
+
+    #include "suart.h"
+#endif
 
 
 using namespace zero;
@@ -37,7 +47,180 @@ namespace {
 #ifdef DEBUG_ENABLED
 
     const int DEBUG_DELAY{ ( 10000 / ( DEBUG_BAUD / 100 ) ) };
-    Gpio* _debugPin{ nullptr };
+    FastPin<DEBUG_PIN>* _debugPin{ nullptr };           // each bit is a single sbi/cbi
+
+
+    // Bit-bangs a single byte out of the debug pin, with interrupts off
+    void transmitBlocking( const char c )
+    {
+        // setup the output 'register'
+        uint16_t reg( c << 1 );
+        reg &= ~( 1 << 0 );                             // force start bit low
+        reg |= ( 1 << 9 );                              // stop bit high (so it ends high)
+
+        // stop interrupts because timing is critical
+        const uint8_t oldSreg = SREG;
+        cli();
+
+        while ( reg ) {
+            if ( reg & 1 ) {
+                _debugPin->switchOn();
+            }
+            else {
+                _debugPin->switchOff();
+            }
+
+            reg >>= 1;
+
+            // 52us = 19200bps, 104us = 9600bps
+            _delay_us( DEBUG_DELAY );
+        }
+
+        SREG = oldSreg;
+    }
+
+
+    // Walks a NULL-terminated character array, handing each character to out
+    void forEachChar( const char* s, const bool fromFlash, void ( *out )( const char ) )
+    {
+        while ( true ) {
+            char c{ *s };
+
+            if ( fromFlash ) {
+                c = pgm_read_byte( s );
+            }
+
+            if ( !c ) {
+                break;
+            }
+
+            out( c );
+            s++;
+        }
+    }
+
+#ifdef DEBUG_BUFFERED
+
+    static_assert( DEBUG_BUFFER_BYTES >= 16 and DEBUG_BUFFER_BYTES <= 256 and
+        !( DEBUG_BUFFER_BYTES & ( DEBUG_BUFFER_BYTES - 1 ) ),
+        "DEBUG_BUFFER_BYTES must be a power of 2, from 16 to 256" );
+
+    const uint8_t RING_MASK{ DEBUG_BUFFER_BYTES - 1 };
+    const uint8_t CHUNK_BYTES{ 16 };                    // most bytes handed to the SuartTx at once
+
+    // globals
+    char _ring[ DEBUG_BUFFER_BYTES ];                   // characters waiting to go out
+    volatile uint8_t _head{ 0 };                        // next slot to print into, only moved by printers
+    volatile uint8_t _tail{ 0 };                        // next slot to send, only moved by the drainers
+    volatile uint16_t _dropped{ 0 };                    // number of characters lost because the ring was full
+    volatile bool _direct{ false };                     // set if the drain Thread couldn't get a SuartTx
+    Thread* _drainThread{ nullptr };                    // the Thread that empties the ring
+    SuartTx* _drainTx{ nullptr };                       // the drain Thread's transmitter, once it has one
+    SignalBitField _drainSignal{ 0 };                   // the signal that wakes the drain Thread
+
+
+    // Adds a character to the ring, or counts it as dropped if there's no room
+    void enqueue( const char c )
+    {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            const uint8_t next{ (uint8_t) ( ( _head + 1 ) & RING_MASK ) };
+
+            if ( next == _tail ) {
+                _dropped++;
+                return;
+            }
+
+            const bool wasEmpty{ _head == _tail };
+            _ring[ _head ] = c;
+            _head = next;
+
+            // the drain Thread only sleeps once the ring is empty
+            if ( wasEmpty and _drainSignal ) {
+                _drainThread->signal( _drainSignal );
+            }
+        }
+    }
+
+
+    // Bit-bangs everything still in the ring. The drain Thread is kept
+    // out meanwhile, and any chunk it has already handed to the SuartTx
+    // goes out first, so the two never drive the pin at once.
+    void drainBlocking()
+    {
+        ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+            if ( _drainTx ) {
+                _drainTx->finish();
+            }
+
+            while ( true ) {
+                char c;
+
+                // take one character at a time, so interrupts get a look in
+                // between each of them
+                ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                    if ( _tail == _head ) {
+                        return;
+                    }
+
+                    c = _ring[ _tail ];
+                    _tail = ( _tail + 1 ) & RING_MASK;
+                }
+
+                transmitBlocking( c );
+            }
+        }
+    }
+
+
+    // The debug drain Thread. Copies the ring out in chunks and hands
+    // them to a SuartTx on the debug pin, so that the bits are clocked
+    // out by Timer2 instead of a tight loop with interrupts off.
+    int debugThreadEntry()
+    {
+        Synapse txReadySyn;
+        SuartTx tx{ DEBUG_BAUD, _debugPin->getGpio(), txReadySyn };
+
+        if ( !tx ) {
+            // Timer2 is taken (or running at another speed), so fall
+            // back to bit-banging everything
+            _direct = true;
+            drainBlocking();
+            return 0;
+        }
+
+        Synapse drainSyn;
+        _drainSignal = drainSyn;
+        _drainTx = &tx;
+
+        char chunk[ CHUNK_BYTES ];
+
+        while ( true ) {
+            // flush() can empty the ring from under us, and mustn't find a
+            // chunk that's out of the ring but not yet with the SuartTx, so
+            // take it and hand it over with interrupts off - it's only a few bytes
+            uint8_t numBytes{ 0 };
+
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                while ( numBytes < CHUNK_BYTES and _tail != _head ) {
+                    chunk[ numBytes++ ] = _ring[ _tail ];
+                    _tail = ( _tail + 1 ) & RING_MASK;
+                }
+
+                if ( numBytes ) {
+                    tx.transmit( chunk, numBytes );
+                }
+            }
+
+            if ( numBytes ) {
+                txReadySyn.wait();
+            }
+            else {
+                drainSyn.wait();
+            }
+        }
+    }
+
+#endif
 
 #endif
 
@@ -47,43 +230,49 @@ namespace {
 void debug::init()
 {
 #ifdef DEBUG_ENABLED
-    _debugPin = new Gpio{ DEBUG_PIN };
+    _debugPin = new FastPin<DEBUG_PIN>;
     _debugPin->setAsOutput();
-    _debugPin->lock( GpioAspect::Direction );
+    _debugPin->getGpio().lock( GpioAspect::Direction );
     _debugPin->switchOn();
 #endif
 }
 
 
+/// @private
+/// @brief Creates the Thread that drains the debug ring
+/// @note Does nothing unless `DEBUG_BUFFERED` is enabled in the `makefile`.
+void debug::startDrain()
+{
+#ifdef DEBUG_BUFFERED
+    _drainThread = new Thread{ PSTR( "debug" ), DEBUG_THREAD_STACK_BYTES, debugThreadEntry };
+
+    if ( _drainThread ) {
+        // debug output should not get in the way of the code being debugged
+        _drainThread->setPriority( TP_LOWEST );
+    }
+    else {
+        _direct = true;
+        drainBlocking();
+    }
+#endif
+}
+
+
 /// @brief Transmits a single byte via software TX
 /// @param c The character to transmit.
+/// @note With `DEBUG_BUFFERED`, the character is put into the debug ring and this
+/// returns straight away. If the ring is full, the character is dropped and counted.
 void debug::print( const char c )
 {
 #ifdef DEBUG_ENABLED
-    // setup the output 'register'
-    uint16_t reg( c << 1 );
-    reg &= ~( 1 << 0 );                                 // force start bit low
-    reg |= ( 1 << 9 );                                  // stop bit high (so it ends high)
-
-    // stop interrupts because timing is critical
-    const uint8_t oldSreg = SREG;
-    cli();
-
-    while ( reg ) {
-        if ( reg & 1 ) {
-            _debugPin->switchOn();
+    #ifdef DEBUG_BUFFERED
+        if ( !_direct ) {
+            enqueue( c );
+            return;
         }
-        else {
-            _debugPin->switchOff();
-        }
-
-        reg >>= 1;
-
-        // 52us = 19200bps, 104us = 9600bps
-        _delay_us( DEBUG_DELAY );
-    }
+    #endif
 
-    SREG = oldSreg;
+    transmitBlocking( c );
 #endif
 }
 
@@ -94,21 +283,70 @@ void debug::print( const char c )
 void debug::print( const char* s, const bool fromFlash )
 {
 #ifdef DEBUG_ENABLED
-    while ( true ) {
-        char c{ *s };
+    forEachChar( s, fromFlash, debug::print );
+#endif
+}
 
-        if ( fromFlash ) {
-            c = pgm_read_byte( s );
-        }
 
-        if ( !c ) {
-            break;
+/// @brief Transmits a NULL-terminated character array, blocking until it's all sent
+/// @details Anything still waiting in the debug ring is sent first, so the output
+/// stays in order. Interrupts are disabled while each character is transmitted.
+/// @param s The null-terminated character array to transmit.
+/// @param fromFlash If `true`, `s` points to an address in Flash memory instead of SRAM
+/// @note Intended for fatal paths (such as `onStackOverflow()`), where there may be
+/// no drain Thread left to run. Everywhere else, use print().
+void debug::printBlocking( const char* s, const bool fromFlash )
+{
+#ifdef DEBUG_ENABLED
+    // keep the drain Thread off the pin until we're done with it
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        debug::flush();
+        forEachChar( s, fromFlash, transmitBlocking );
+    }
+#endif
+}
+
+
+/// @brief Transmits raw bytes, blocking until they're all sent
+/// @details Like printBlocking(), anything still waiting in the debug ring is sent first.
+/// @param data The bytes to transmit. Zeros are sent like any other byte.
+/// @param numBytes The number of bytes to transmit.
+void debug::writeBlocking( const void* const data, const uint16_t numBytes )
+{
+#ifdef DEBUG_ENABLED
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        debug::flush();
+
+        for ( uint16_t i = 0; i < numBytes; i++ ) {
+            transmitBlocking( ( (const char*) data )[ i ] );
         }
+    }
+#endif
+}
+
 
-        debug::print( c );
-        s++;
+/// @brief Sends everything waiting in the debug ring, blocking until it's all sent
+/// @note Does nothing unless `DEBUG_BUFFERED` is enabled in the `makefile`.
+void debug::flush()
+{
+#ifdef DEBUG_BUFFERED
+    drainBlocking();
+#endif
+}
+
+
+/// @brief Gets the number of characters lost because the debug ring was full
+/// @returns The number of dropped characters since boot. Always `0` unless
+/// `DEBUG_BUFFERED` is enabled in the `makefile`.
+uint16_t debug::getDroppedCount()
+{
+#ifdef DEBUG_BUFFERED
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _dropped;
     }
 #endif
+
+    return 0;
 }
 
 
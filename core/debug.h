@@ -22,11 +22,16 @@ namespace zero {
     /// @details No set up or initialization is required by your code - just be sure that
     /// the `makefile` has the `DEBUG_*` settings to your liking, and then call
     /// these functions.
-    /// @note These are all blocking calls - control returns to the caller only after the
-    /// transmission is complete.
+    /// @note By default, these are all blocking calls - control returns to the caller only
+    /// after the transmission is complete.
     /// @note Interrupts are disabled while each character is transmitted in a tight-loop
     /// (approximately 1ms per character at 9600bps). Interrupts are enabled between each
     /// character.
+    /// @note With `DEBUG_BUFFERED` enabled in the `makefile`, print() instead puts the
+    /// characters into a ring, which a low priority Thread drains through a `SuartTx` on
+    /// the same pin. Nothing blocks, and interrupts stay on. When the ring is full,
+    /// characters are dropped and counted (see getDroppedCount()). Use printBlocking()
+    /// on fatal paths, where the drain Thread may never run again.
     /// @note For asynchronous and better performing data transmission, see
     /// the `UsartTx` or `SuartTx` classes.
 
@@ -34,9 +39,16 @@ namespace zero {
         /// @private
         void init();
 
+        /// @private
+        void startDrain();
+
         void print( const char c );
         void print( const char* s, const bool fromFlash = false );
         void print( const uint16_t n, const int base = 10 );
+        void printBlocking( const char* s, const bool fromFlash = false );
+        void writeBlocking( const void* const data, const uint16_t numBytes );
+        void flush();
+        uint16_t getDroppedCount();
         void assert( const bool v, const char* const msg, const int lineNumber = 0 );
     };
 
@@ -0,0 +1,126 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DEFERRED_WORK
+
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "deferred.h"
+#include "thread.h"
+#include "debug.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    static_assert( DEFERRED_QUEUE_ITEMS >= 2 and DEFERRED_QUEUE_ITEMS <= 128 and
+        !( DEFERRED_QUEUE_ITEMS & ( DEFERRED_QUEUE_ITEMS - 1 ) ),
+        "DEFERRED_QUEUE_ITEMS must be a power of 2, from 2 to 128" );
+
+    const uint8_t QUEUE_MASK{ DEFERRED_QUEUE_ITEMS - 1 };
+
+    struct WorkItem {
+        DeferredFunc fn;
+        void* arg;
+    };
+
+    // globals
+    WorkItem _queue[ DEFERRED_QUEUE_ITEMS ];            // the ring of work to do
+    volatile uint8_t _head{ 0 };                        // next slot to post into, only moved by posters
+    volatile uint8_t _tail{ 0 };                        // next slot to run, only moved by the work Thread
+    volatile uint16_t _dropped{ 0 };                    // number of posts refused because the ring was full
+    Thread* _workThread{ nullptr };                     // the Thread that runs it all
+    SignalBitField _workSignal{ 0 };                    // the signal that wakes the work Thread
+
+
+    // The deferred work Thread. Runs everything in the ring, then
+    // sleeps until there's more.
+    int deferredThreadEntry()
+    {
+        Synapse workSyn;
+        _workSignal = workSyn;
+
+        while ( true ) {
+            // _tail is ours alone, and _head is a single byte, so no
+            // need to turn interrupts off to look at either
+            while ( _tail != _head ) {
+                const WorkItem item{ _queue[ _tail ] };
+
+                // the slot must be read before it's handed back to the
+                // posters, and _queue isn't volatile, so stop the compiler
+                // moving the read past the _tail update
+                __asm__ __volatile__ ( "" ::: "memory" );
+                _tail = ( _tail + 1 ) & QUEUE_MASK;
+
+                item.fn( item.arg );
+            }
+
+            workSyn.wait();
+        }
+    }
+
+}    // namespace
+
+
+/// @private
+/// @brief Creates the deferred work Thread
+void deferred::init()
+{
+    _workThread = new Thread{ PSTR( "deferred" ), DEFERRED_THREAD_STACK_BYTES, deferredThreadEntry };
+    dbg_assert( _workThread, "Deferred thread init fail" );
+
+    // bottom halves should run before anything else
+    if ( _workThread ) {
+        _workThread->setPriority( TP_HIGHEST );
+    }
+}
+
+
+/// @brief Queues a function to be run on the deferred work Thread
+/// @param fn The function to run.
+/// @param arg Optional. Default: `nullptr`. The argument to pass to the function.
+/// @returns `true` if the work was queued, `false` if the queue was full (in which
+/// case the work is dropped and counted, see getDroppedCount()).
+/// @note Posting may be done from within an ISR, and takes only a few cycles.
+bool deferred::post( const DeferredFunc fn, void* const arg )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        const uint8_t next{ (uint8_t) ( ( _head + 1 ) & QUEUE_MASK ) };
+
+        if ( next == _tail ) {
+            _dropped++;
+            return false;
+        }
+
+        _queue[ _head ] = WorkItem{ fn, arg };
+        _head = next;
+
+        if ( _workSignal ) {
+            _workThread->signal( _workSignal );
+        }
+    }
+
+    return true;
+}
+
+
+/// @brief Gets the number of work items dropped because the queue was full
+/// @returns The number of posts that were refused since boot.
+uint16_t deferred::getDroppedCount()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _dropped;
+    }
+}
+
+
+#endif
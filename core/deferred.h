@@ -0,0 +1,45 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_DEFERRED_H
+#define TCRI_ZERO_DEFERRED_H
+
+
+#ifdef ZERO_DEFERRED_WORK
+
+
+#include <stdint.h>
+
+
+namespace zero {
+
+    /// @brief A piece of work handed from an ISR to the deferred work Thread
+    /// @param arg The argument given to deferred::post().
+    typedef void ( *DeferredFunc )( void* const arg );
+
+    /// @brief Provides a queue for ISRs to push work out of interrupt context
+    /// @details Work items are run, in the order they were posted, by a single high
+    /// priority kernel Thread. An ISR can do the bare minimum with interrupts off, and
+    /// leave the rest to the deferred work Thread, without each driver needing a Thread
+    /// (and stack) of its own.
+    /// @note Work items share the deferred work Thread's stack (`DEFERRED_THREAD_STACK_BYTES`
+    /// in the `makefile`), and each one holds up the ones behind it, so keep them short.
+
+    namespace deferred {
+        /// @private
+        void init();
+
+        bool post( const DeferredFunc fn, void* const arg = nullptr );
+        uint16_t getDroppedCount();
+    }
+
+}    // namespace zero
+
+#endif
+
+#endif
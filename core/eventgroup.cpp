@@ -0,0 +1,159 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include <util/atomic.h>
+
+#include "eventgroup.h"
+#include "thread.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a new EventGroup, with all bits clear
+EventGroup::EventGroup()
+{
+    // empty
+}
+
+
+/// @brief Sets bits, waking every waiting Thread whose wait is now satisfied
+/// @param bits The bits to set.
+/// @returns The bits that remain set once the woken Threads have cleared theirs.
+/// @note Setting bits may be done from within an ISR.
+EventBits EventGroup::set( const EventBits bits )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _bits |= bits;
+
+        EventBits toClear{ 0 };
+        Waiter* w{ _waiters.getHead() };
+
+        // every Waiter sees the bits as they were set, before anyone clears them
+        while ( w ) {
+            Waiter* const next{ w->next };
+            w->result = check( w->bits, w->waitForAll );
+
+            if ( w->result ) {
+                if ( w->clearOnExit ) {
+                    toClear |= w->result;
+                }
+
+                _waiters.remove( *w );
+                w->syn->signal();
+            }
+
+            w = next;
+        }
+
+        _bits &= ~toClear;
+        return _bits;
+    }
+}
+
+
+/// @brief Clears bits
+/// @param bits The bits to clear.
+/// @returns The bits as they were before being cleared.
+/// @note Clearing bits may be done from within an ISR.
+EventBits EventGroup::clear( const EventBits bits )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        const EventBits rc{ _bits };
+        _bits &= ~bits;
+        return rc;
+    }
+}
+
+
+/// @brief Gets the current bits
+/// @returns The bits currently set.
+EventBits EventGroup::get() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _bits;
+    }
+}
+
+
+/// @brief Waits for any (or all) of a number of bits to be set
+/// @param bits The bits of interest.
+/// @param waitForAll Optional. Default: `false`. If `true`, waits until every one of
+/// `bits` is set, otherwise until any one of them is.
+/// @param clearOnExit Optional. Default: `true`. If `true`, the bits which satisfied the
+/// wait are cleared.
+/// @param timeout Optional. Default: `0_ms` (no timeout). The maximum length of time to
+/// wait.
+/// @returns The bits of interest that were set, or `0` if the wait timed out or no
+/// signal could be allocated to wait on.
+/// @note Only call this from a Thread, not an ISR.
+EventBits EventGroup::wait(
+    const EventBits bits,
+    const bool waitForAll,
+    const bool clearOnExit,
+    const Duration timeout )
+{
+    if ( !bits ) {
+        return 0;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( const EventBits rc = check( bits, waitForAll ) ) {
+            if ( clearOnExit ) {
+                _bits &= ~rc;
+            }
+
+            return rc;
+        }
+    }
+
+    // a signal to be woken with when the bits are set
+    Synapse syn;
+
+    if ( !syn ) {
+        return 0;
+    }
+
+    Waiter w{ &syn, bits, waitForAll, clearOnExit, 0, nullptr };
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        // the bits may have been set while we weren't looking
+        if ( const EventBits rc = check( bits, waitForAll ) ) {
+            if ( clearOnExit ) {
+                _bits &= ~rc;
+            }
+
+            return rc;
+        }
+
+        _waiters.append( w );
+    }
+
+    syn.wait( timeout );
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( !w.result ) {
+            _waiters.remove( w );
+        }
+    }
+
+    return w.result;
+}
+
+
+// Determines which of the bits satisfy a wait, if any
+EventBits EventGroup::check( const EventBits bits, const bool waitForAll ) const
+{
+    const EventBits rc{ (EventBits) ( _bits & bits ) };
+
+    if ( waitForAll ) {
+        return ( rc == bits ) ? rc : 0;
+    }
+
+    return rc;
+}
@@ -0,0 +1,45 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_EVENTGROUP_H
+#define TCRI_ZERO_EVENTGROUP_H
+
+
+#include <stdint.h>
+#include "thread.h"
+#include "time.h"
+#include "waitqueue.h"
+
+
+namespace zero {
+
+    /// A bit field representing one or more events in an EventGroup.
+    typedef uint16_t EventBits;
+
+    /// @brief A set of event bits that any number of Threads can wait on, and which may
+    /// be set from ISRs
+    class EventGroup {
+    public:
+        EventGroup();
+
+        EventBits set( const EventBits bits );          // sets bits, waking any Threads they satisfy
+        EventBits clear( const EventBits bits );        // clears bits
+        EventBits get() const;                          // gets the current bits
+
+        EventBits wait(
+            const EventBits bits,                       // the bits of interest
+            const bool waitForAll = false,              // wait for all of the bits, not just any one?
+            const bool clearOnExit = true,              // clear the bits that satisfied the wait?
+            const Duration timeout = 0_ms );            // how long to wait
+
+        #include "eventgroup_private.h"
+    };
+
+}    // namespace zero
+
+#endif
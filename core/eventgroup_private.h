@@ -0,0 +1,29 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+
+    // a Thread blocked in wait(), with result set by set() once its bits turn up
+    struct Waiter {
+        const Synapse* const syn;
+        const EventBits bits;
+        const bool waitForAll;
+        const bool clearOnExit;
+        EventBits result;
+        Waiter* next;
+    };
+
+private:
+    EventGroup( const EventGroup& e ) = delete;
+    void operator=( const EventGroup& e ) = delete;
+
+    EventBits check( const EventBits bits, const bool waitForAll ) const;
+
+    EventBits _bits{ 0 };
+    WaitQueue<Waiter> _waiters;
@@ -14,7 +14,10 @@
 #include <string.h>
 
 #include "memory.h"
+#include "blockpool.h"
+#include "debug.h"
 #include "thread.h"
+#include "trace.h"
 #include "util.h"
 #include "attrs.h"
 
@@ -54,6 +57,68 @@ namespace {
     {
         return ROUND_UP( bytes, PAGE_BYTES ) / PAGE_BYTES;
     }
+
+
+    // heap statistics, kept up to date by allocate() and free()
+    uint16_t _usedPages{ 0 };
+    uint16_t _peakUsedPages{ 0 };
+    uint32_t _allocations{ 0 };
+    uint32_t _frees{ 0 };
+    uint32_t _failures{ 0 };
+
+    // the largest free run, only worked out again when someone asks
+    // for it after the heap has changed
+    uint16_t _largestFreePages{ SRAM_PAGES };
+    bool _largestFreeStale{ false };
+
+#ifdef ZERO_BLOCK_POOLS
+
+    static_assert( BLOCK_POOL_SMALL_BYTES < BLOCK_POOL_MEDIUM_BYTES and
+        BLOCK_POOL_MEDIUM_BYTES < BLOCK_POOL_LARGE_BYTES,
+        "BLOCK_POOL_*_BYTES must go from smallest to largest" );
+
+    // the size classes for new and delete
+    BlockPool<BLOCK_POOL_SMALL_BYTES, BLOCK_POOL_SMALL_COUNT> _smallBlocks;
+    BlockPool<BLOCK_POOL_MEDIUM_BYTES, BLOCK_POOL_MEDIUM_COUNT> _mediumBlocks;
+    BlockPool<BLOCK_POOL_LARGE_BYTES, BLOCK_POOL_LARGE_COUNT> _largeBlocks;
+
+
+    // Finds a block for a small object, trying the next size
+    // class up if the best fitting one is empty
+    void* allocateBlock( const size_t size )
+    {
+        void* rc{ nullptr };
+
+        if ( size <= BLOCK_POOL_SMALL_BYTES ) {
+            rc = _smallBlocks.allocate();
+        }
+
+        if ( !rc and size <= BLOCK_POOL_MEDIUM_BYTES ) {
+            rc = _mediumBlocks.allocate();
+        }
+
+        if ( !rc and size <= BLOCK_POOL_LARGE_BYTES ) {
+            rc = _largeBlocks.allocate();
+        }
+
+        return rc;
+    }
+
+
+    // Gives a block back to whichever pool it came from
+    bool freeBlock( void* const p )
+    {
+        return _smallBlocks.free( p ) or _mediumBlocks.free( p ) or _largeBlocks.free( p );
+    }
+
+#endif
+
+#ifdef ZERO_ISR_POOL
+
+    // buffers for ISRs, reserved before any Thread runs
+    BlockPool<ISR_POOL_BLOCK_BYTES, ISR_POOL_BLOCK_COUNT> _isrBlocks;
+
+#endif
     
 }    // namespace
 
@@ -64,6 +129,17 @@ void WEAK onOutOfMemory()
 }
 
 
+/// @brief Called when an allocation fails. Override to find out what couldn't be allocated.
+/// @param bytesReqd The number of bytes that were asked for.
+/// @param strategy The search strategy that was used.
+/// @note The default implementation calls `onOutOfMemory()`. memory::getStats() can
+/// be called from here to see how full (or fragmented) the heap was.
+void WEAK onOutOfMemory( const uint16_t, const SearchStrategy )
+{
+    onOutOfMemory();
+}
+
+
 /// @brief Allocates a chunk of SRAM.
 /// @param bytesReqd The minimum number of bytes required.
 /// @param allocatedBytes Optional. Default: `nullptr`. A place to store the number
@@ -96,25 +172,31 @@ void* MALLOC memory::allocate(
             // if there was a chunk the size we wanted
             if ( startPage >= 0 ) {
                 // mark the pages as no longer available
-                for ( uint16_t curPageNumber = startPage;
-                    curPageNumber < startPage + numPages;
-                    curPageNumber++ )
-                {
-                    _sram.markAsUsed( curPageNumber );
-                }
+                _sram.markAsUsed( startPage, numPages );
+
+                _usedPages += numPages;
+                _peakUsedPages = MAX( _peakUsedPages, _usedPages );
+                _allocations++;
+                _largestFreeStale = true;
 
                 // tell the caller how much we gave them
                 if ( allocatedBytes ) {
                     *allocatedBytes = numPages * PAGE_BYTES;
                 }
 
+                trace_event( TraceEvent::Allocate, numPages * PAGE_BYTES );
+
                 // outta here
                 rc = (void*) getAddressForPage( startPage );
             }
+            else {
+                _failures++;
+                trace_event( TraceEvent::AllocateFail, bytesReqd );
+            }
         }
 
         if ( !rc ) {
-            onOutOfMemory();
+            onOutOfMemory( bytesReqd, strategy );
         }
     }
 
@@ -133,26 +215,134 @@ void memory::free( const void* const address, const uint16_t numBytes )
     const uint16_t startPage{ getPageForAddress( (uint16_t) address ) };
 
     ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
-        // run from the first page to the last, ensuring the bitmap says 'free'
-        for ( uint16_t curPage = startPage;
-            curPage < startPage + numPages;
-            curPage++ )
-        {
-            _sram.markAsFree( curPage );
+        // ensure the bitmap says 'free' from the first page to the last
+        _sram.markAsFree( startPage, numPages );
+
+        // a mismatched size (or a double free) mustn't wrap the count round
+        dbg_assert( numPages <= _usedPages, "free() of more than is allocated" );
+        _usedPages -= ( numPages < _usedPages ) ? numPages : _usedPages;
+        _frees++;
+        _largestFreeStale = true;
+
+        trace_event( TraceEvent::Free, numPages * PAGE_BYTES );
+    }
+}
+
+
+/// @brief Gets the heap's usage statistics.
+/// @returns A snapshot of the statistics.
+/// @note Everything but the largest free chunk is counted as allocations come and go.
+/// The largest free chunk is worked out again (a byte at a time through the page map)
+/// only if the heap has changed since the last call.
+HeapStats memory::getStats()
+{
+    HeapStats rc;
+
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        if ( _largestFreeStale ) {
+            _largestFreePages = _sram.getLargestFreeRun();
+            _largestFreeStale = false;
         }
+
+        rc.totalBytes = (uint16_t) DYNAMIC_BYTES;
+        rc.usedBytes = _usedPages * PAGE_BYTES;
+        rc.peakUsedBytes = _peakUsedPages * PAGE_BYTES;
+        rc.largestFreeBytes = _largestFreePages * PAGE_BYTES;
+        rc.allocations = _allocations;
+        rc.frees = _frees;
+        rc.failures = _failures;
     }
+
+    return rc;
+}
+
+
+#ifdef ZERO_BLOCK_POOLS
+
+/// @private
+/// @brief Reserves the storage for the block pools behind new and delete
+/// @returns `true` if every pool's storage was reserved, `false` otherwise.
+/// @note Called before `main()`, so that the heap is only gone to once for each pool,
+/// rather than by whichever small `new` happens to come first.
+bool memory::initBlockPools()
+{
+    const bool small{ _smallBlocks.reserve() };
+    const bool medium{ _mediumBlocks.reserve() };
+    const bool large{ _largeBlocks.reserve() };
+
+    return small and medium and large;
+}
+
+#endif
+
+
+#ifdef ZERO_ISR_POOL
+
+/// @private
+/// @brief Reserves the ISR buffer pool's storage from the heap
+/// @returns `true` if the storage was reserved, `false` otherwise.
+/// @note Called before `main()`, so that no ISR ever causes a heap search.
+bool memory::initIsrPool()
+{
+    return _isrBlocks.reserve();
 }
 
 
+/// @brief Allocates a buffer in bounded time, from a pool set aside for ISRs.
+/// @param bytesReqd The minimum number of bytes required.
+/// @param allocatedBytes Optional. Default: `nullptr`. A place to store the number
+/// of bytes actually allocated.
+/// @returns A pointer to the buffer, or `nullptr` if the pool is empty or the buffers
+/// are smaller than `bytesReqd`.
+/// @note Unlike allocate(), this may be called from within an ISR. Every buffer is
+/// `ISR_POOL_BLOCK_BYTES` long, and there are `ISR_POOL_BLOCK_COUNT` of them (see
+/// the `makefile`).
+void* memory::allocateFromIsr( const uint16_t bytesReqd, uint16_t* const allocatedBytes )
+{
+    void* const rc{ ( bytesReqd <= ISR_POOL_BLOCK_BYTES ) ? _isrBlocks.allocate() : nullptr };
+
+    if ( allocatedBytes ) {
+        *allocatedBytes = rc ? ISR_POOL_BLOCK_BYTES : 0;
+    }
+
+    return rc;
+}
+
+
+/// @brief Returns a buffer from allocateFromIsr() to its pool.
+/// @param address The address of the buffer.
+/// @returns `true` if the buffer belonged to the ISR pool (and was freed), `false` otherwise.
+/// @note May be called from within an ISR, or from a Thread.
+bool memory::freeFromIsr( const void* const address )
+{
+    return _isrBlocks.free( (void*) address );
+}
+
+#endif
+
+
 // overloads for new and delete operators
 void* operator new( size_t size )
 {
+    #ifdef ZERO_BLOCK_POOLS
+        // small objects come from the block pools, if there's room
+        if ( void* const p = allocateBlock( size ) ) {
+            return p;
+        }
+    #endif
+
     return memory::allocate( size );
 }
 
 
 void operator delete( void* p, size_t size )
 {
+    #ifdef ZERO_BLOCK_POOLS
+        if ( freeBlock( p ) ) {
+            return;
+        }
+    #endif
+
     memory::free( p, size );
 }
 
@@ -32,6 +32,52 @@ namespace zero {
         // deallocate a contiguous chunk of memory
         void free( const void* const address, const uint16_t numBytes );
 
+
+        /// @brief A snapshot of the heap's usage, as returned by getStats()
+        struct HeapStats {
+            /// Size of the heap, in bytes
+            uint16_t totalBytes;
+
+            /// Bytes currently allocated
+            uint16_t usedBytes;
+
+            /// Most bytes ever allocated at once
+            uint16_t peakUsedBytes;
+
+            /// Size of the largest contiguous free chunk, the biggest allocate() that can succeed
+            uint16_t largestFreeBytes;
+
+            /// Number of successful allocate() calls
+            uint32_t allocations;
+
+            /// Number of free() calls
+            uint32_t frees;
+
+            /// Number of allocate() calls that failed
+            uint32_t failures;
+        };
+
+        // get the heap's usage statistics
+        HeapStats getStats();
+
+        #ifdef ZERO_BLOCK_POOLS
+            // reserve the block pools behind new and delete (called at startup)
+            bool initBlockPools();
+        #endif
+
+        #ifdef ZERO_ISR_POOL
+            // reserve the ISR buffer pool (called at startup)
+            bool initIsrPool();
+
+            // allocate a fixed-size buffer, safe to call from an ISR
+            void* allocateFromIsr(
+                const uint16_t bytesReqd,
+                uint16_t* const allocatedBytes = nullptr );
+
+            // give back a buffer from allocateFromIsr(), safe to call from an ISR
+            bool freeFromIsr( const void* const address );
+        #endif
+
     }    // namespace memory
 
 }    // namespace zero
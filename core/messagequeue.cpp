@@ -0,0 +1,162 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include <string.h>
+#include <util/atomic.h>
+
+#include "messagequeue.h"
+#include "memory.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a new MessageQueue
+/// @param recordBytes The size of each record, in bytes.
+/// @param capacity The number of records the queue can hold.
+/// @note The queue's storage comes from the heap. Check the queue with `operator bool()`
+/// before using it.
+MessageQueue::MessageQueue( const uint16_t recordBytes, const uint16_t capacity )
+:
+    _recordBytes{ recordBytes },
+    _capacity{ capacity },
+    _buffer{ (uint8_t*) memory::allocate( recordBytes * capacity, &_bufferBytes ) },
+    _records{ 0, capacity },
+    _room{ (uint16_t) ( _buffer ? capacity : 0 ), capacity }
+{
+    // empty
+}
+
+
+// dtor
+MessageQueue::~MessageQueue()
+{
+    memory::free( _buffer, _bufferBytes );
+}
+
+
+/// @brief Determines if the MessageQueue initialized correctly
+/// @returns `true` if the queue got its memory, `false` otherwise.
+MessageQueue::operator bool() const
+{
+    return _buffer;
+}
+
+
+/// @brief Copies a record into the queue, waiting for room if need be
+/// @param record The record to send.
+/// @param timeout Optional. Default: `0_ms` (no timeout). The maximum length of time
+/// to wait for room.
+/// @returns `true` if the record was sent, `false` if the wait timed out.
+/// @note Only call this from a Thread, not an ISR - use trySend() there.
+bool MessageQueue::send( const void* const record, const Duration timeout )
+{
+    if ( !_room.wait( timeout ) ) {
+        return false;
+    }
+
+    put( record );
+    return true;
+}
+
+
+/// @brief Copies the oldest record out of the queue, waiting for one if need be
+/// @param record The place to store the record.
+/// @param timeout Optional. Default: `0_ms` (no timeout). The maximum length of time
+/// to wait for a record.
+/// @returns `true` if a record was received (`record` will be valid), `false` if the
+/// wait timed out.
+/// @note Only call this from a Thread, not an ISR - use tryReceive() there.
+bool MessageQueue::receive( void* const record, const Duration timeout )
+{
+    if ( !_records.wait( timeout ) ) {
+        return false;
+    }
+
+    take( record );
+    return true;
+}
+
+
+/// @brief Copies a record into the queue, but only if there's room
+/// @param record The record to send.
+/// @returns `true` if the record was sent, `false` if the queue was full.
+/// @note May be called from within an ISR.
+bool MessageQueue::trySend( const void* const record )
+{
+    if ( !_room.tryWait() ) {
+        return false;
+    }
+
+    put( record );
+    return true;
+}
+
+
+/// @brief Copies the oldest record out of the queue, but only if there is one
+/// @param record The place to store the record.
+/// @returns `true` if a record was received (`record` will be valid), `false` if the
+/// queue was empty.
+/// @note May be called from within an ISR.
+bool MessageQueue::tryReceive( void* const record )
+{
+    if ( !_records.tryWait() ) {
+        return false;
+    }
+
+    take( record );
+    return true;
+}
+
+
+/// @brief Gets the number of records waiting in the queue
+/// @returns The number of records that can be received without waiting.
+uint16_t MessageQueue::getCount() const
+{
+    return _records.getCount();
+}
+
+
+/// @brief Gets the number of records the queue can hold
+/// @returns The queue's capacity.
+uint16_t MessageQueue::getCapacity() const
+{
+    return _capacity;
+}
+
+
+// Copies a record into the slot at the head, once room for it has been
+// taken, and lets a receiver know it's there
+void MessageQueue::put( const void* const record )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        memcpy( _buffer + ( _head * _recordBytes ), record, _recordBytes );
+
+        if ( ++_head == _capacity ) {
+            _head = 0;
+        }
+    }
+
+    _records.post();
+}
+
+
+// Copies the record out of the slot at the tail, once it has been taken,
+// and lets a sender know there's room
+void MessageQueue::take( void* const record )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        memcpy( record, _buffer + ( _tail * _recordBytes ), _recordBytes );
+
+        if ( ++_tail == _capacity ) {
+            _tail = 0;
+        }
+    }
+
+    _room.post();
+}
@@ -0,0 +1,57 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_MESSAGEQUEUE_H
+#define TCRI_ZERO_MESSAGEQUEUE_H
+
+
+#include <stdint.h>
+#include "semaphore.h"
+#include "time.h"
+
+
+namespace zero {
+
+    /// @brief Thread-safe FIFO queue of fixed-size records
+    /// @details Each send() and receive() copies one whole record, rather than a byte at
+    /// a time as with a Pipe. To pass larger things around without copying them, make the
+    /// records pointers (`sizeof( void* )` bytes), for example to blocks from a BlockPool.
+    /// @code
+    /// struct Reading { int16_t x, y, z; uint32_t stamp; uint16_t flags; };
+    /// MessageQueue readings{ sizeof( Reading ), 8 };
+    ///
+    /// Reading r;
+    /// if ( readings.receive( &r, 10_ms ) ) { ... }
+    /// @endcode
+    class MessageQueue {
+    public:
+        MessageQueue(
+            const uint16_t recordBytes,                 // size of each record, in bytes
+            const uint16_t capacity );                  // number of records the queue can hold
+
+        explicit operator bool() const;                 // Determines if the queue got its memory
+
+        bool send(
+            const void* const record,                   // the record to copy into the queue
+            const Duration timeout = 0_ms );            // longest to wait for room (0 is forever)
+        bool receive(
+            void* const record,                         // the place to copy the record to
+            const Duration timeout = 0_ms );            // longest to wait for a record (0 is forever)
+
+        bool trySend( const void* const record );       // sends only if there's room, ISR-safe
+        bool tryReceive( void* const record );          // receives only if there's a record, ISR-safe
+
+        uint16_t getCount() const;                      // records waiting to be received
+        uint16_t getCapacity() const;                   // most records the queue can hold
+
+        #include "messagequeue_private.h"
+    };
+
+}    // namespace zero
+
+#endif
@@ -0,0 +1,29 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    ~MessageQueue();
+
+private:
+    MessageQueue( const MessageQueue& q ) = delete;
+    void operator=( const MessageQueue& q ) = delete;
+
+    void put( const void* const record );
+    void take( void* const record );
+
+    const uint16_t _recordBytes;
+    const uint16_t _capacity;
+    uint16_t _bufferBytes{ 0 };                         // declared before _buffer, whose initialiser sets it
+    uint8_t* const _buffer;
+
+    uint16_t _head{ 0 };                                // next record to be written
+    uint16_t _tail{ 0 };                                // next record to be read
+
+    Semaphore _records;                                 // records waiting to be received
+    Semaphore _room;                                    // free slots
@@ -0,0 +1,147 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include "mutex.h"
+#include "thread.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a new Mutex
+Mutex::Mutex()
+{
+    // empty
+}
+
+
+/// @brief Waits until the current Thread owns the Mutex
+/// @details Waiting Threads are queued in priority order (first come, first served
+/// within a priority level), and the Mutex is handed straight to the next in line when
+/// it is unlocked. While a higher priority Thread is waiting, the owner temporarily runs
+/// at that Thread's priority, so that it can't be held up by anything in between.
+/// @param timeout Optional. Default: `0_ms` (no timeout). The maximum length of time
+/// to wait to own the Mutex.
+/// @returns `true` if the current Thread now owns the Mutex, `false` if the wait timed
+/// out, the Thread already owns the Mutex, or no signal could be allocated to wait on.
+/// @note Only call this from a Thread, not an ISR.
+bool Mutex::lock( const Duration timeout )
+{
+    // fast path, nobody else wants it
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        if ( !_owner ) {
+            take( me );
+            return true;
+        }
+
+        if ( _owner == &me ) {
+            return false;
+        }
+    }
+
+    // a signal to be woken with when it's our turn
+    Synapse syn;
+
+    if ( !syn ) {
+        return false;
+    }
+
+    Waiter w{ &me, &syn, nullptr };
+
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        // it may have come free while we weren't looking
+        if ( !_owner ) {
+            take( me );
+            return true;
+        }
+
+        _waiters.insertByPriority( w );
+
+        #if PRIORITY_LEVELS > 1
+            // lend our priority to the owner while we wait
+            if ( me.getPriority() > _owner->getPriority() ) {
+                _owner->setPriority( me.getPriority() );
+            }
+        #endif
+    }
+
+    syn.wait( timeout );
+
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        // unlock() will have made us the owner before waking us
+        if ( _owner == &me ) {
+            return true;
+        }
+
+        // timed out, so we're no longer in the running
+        _waiters.remove( w );
+    }
+
+    return false;
+}
+
+
+/// @brief Takes the Mutex if it is not owned by anyone
+/// @returns `true` if the current Thread now owns the Mutex, `false` otherwise.
+bool Mutex::tryLock()
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        if ( !_owner ) {
+            take( me );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// @brief Gives up the Mutex, handing it to the highest priority waiting Thread
+/// @note Only the owner of the Mutex can unlock it.
+/// @note The owner's priority is restored to what it was when it took the Mutex, so
+/// Mutexes held at the same time should be unlocked in the reverse order to locking.
+void Mutex::unlock()
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        if ( _owner != &me ) {
+            return;
+        }
+
+        #if PRIORITY_LEVELS > 1
+            // give back anything we were lent
+            me.setPriority( _ownerPriority );
+        #endif
+
+        if ( Waiter* const w = _waiters.pop() ) {
+            take( *w->thread );
+
+            // signalling while switching is off means the Waiter (and its
+            // Synapse) can't go out of scope before we're done with them
+            w->syn->signal();
+        }
+        else {
+            _owner = nullptr;
+        }
+    }
+}
+
+
+/// @brief Determines if the Mutex is owned by any Thread
+/// @returns `true` if the Mutex is locked, `false` otherwise.
+bool Mutex::isLocked() const
+{
+    return _owner;
+}
+
+
+// Makes a Thread the owner of the Mutex
+void Mutex::take( Thread& t )
+{
+    _owner = &t;
+    _ownerPriority = t.getPriority();
+}
@@ -0,0 +1,36 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_MUTEX_H
+#define TCRI_ZERO_MUTEX_H
+
+
+#include <stdint.h>
+#include "thread.h"
+#include "time.h"
+#include "waitqueue.h"
+
+
+namespace zero {
+
+    /// @brief Mutual exclusion between Threads, without stopping context switching
+    class Mutex {
+    public:
+        Mutex();
+
+        bool lock( const Duration timeout = 0_ms );     // waits to own the Mutex
+        bool tryLock();                                 // takes the Mutex only if it's free
+        void unlock();                                  // gives the Mutex up
+        bool isLocked() const;                          // determines if anyone owns the Mutex
+
+        #include "mutex_private.h"
+    };
+
+}    // namespace zero
+
+#endif
@@ -0,0 +1,27 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+
+    // a Thread blocked in lock(), made the owner by unlock() before it's woken
+    struct Waiter {
+        Thread* const thread;
+        const Synapse* const syn;
+        Waiter* next;
+    };
+
+private:
+    Mutex( const Mutex& m ) = delete;
+    void operator=( const Mutex& m ) = delete;
+
+    void take( Thread& t );
+
+    Thread* _owner{ nullptr };
+    WaitQueue<Waiter> _waiters;
+    ThreadPriority _ownerPriority{ TP_DEFAULT };
@@ -11,6 +11,7 @@
 
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/sleep.h>
 #include <avr/power.h>
 #include <util/atomic.h>
@@ -18,6 +19,7 @@
 #include "power.h"
 #include "gpio.h"
 #include "watchdog.h"
+#include "resource.h"
 #include "attrs.h"
 
 
@@ -66,6 +68,12 @@ bool Power::init()
     _resetFlags = ResetFlags( MCUSR );
     MCUSR = 0;
 
+    #ifdef ZERO_IDLE_GOVERNOR
+        // every peripheral clock stays off until its resource is obtained
+        power_all_disable();
+        power_timer0_enable();
+    #endif
+
     // Watchdog init must be delayed until after MCUSR is
     // cleared (if the reset was caused by the WDT that is)
     #ifdef ZERO_DRIVERS_WDT
@@ -135,3 +143,96 @@ void Power::sleep( const uint8_t mode, const bool force, const bool silent )
         sleep_cpu();
     }
 }
+
+
+#ifdef ZERO_IDLE_GOVERNOR
+
+/// @brief Works out the deepest sleep mode that won't upset anything currently running
+/// @param timed `true` if any Thread is waiting on a deadline (a `delay()` or a `wait()`
+/// with a timeout), `false` otherwise.
+/// @returns The sleep mode, from `avr/sleep.h`:
+/// - `SLEEP_MODE_IDLE` if a deadline is pending, as the kernel clock (Timer0) stops in
+///   every deeper mode, or if a Watchdog participant has a deadline of its own (the kernel
+///   clock checks it, and keeps the WDT quiet meanwhile), or if a USART, SPI, Timer1, I2C,
+///   or a synchronous Timer2 is in use.
+/// - `SLEEP_MODE_ADC` if an ADC conversion is in progress, and nothing else needs clocks.
+/// - `SLEEP_MODE_PWR_SAVE` if Timer2 is in use, clocked asynchronously from its crystal.
+/// - `SLEEP_MODE_PWR_DOWN` otherwise - only pin changes, external interrupts and the
+///   watchdog can wake the MCU.
+/// @note Only available when `IDLE_GOVERNOR` is enabled in the `makefile`.
+uint8_t Power::getIdleSleepMode( const bool timed )
+{
+    using resource::ResourceId;
+    using resource::isObtained;
+
+    if ( timed or Watchdog::hasDeadlines() or
+        isObtained( ResourceId::UsartRx0 ) or isObtained( ResourceId::UsartTx0 ) or
+        isObtained( ResourceId::UsartRx1 ) or isObtained( ResourceId::UsartTx1 ) or
+        isObtained( ResourceId::UsartRx2 ) or isObtained( ResourceId::UsartTx2 ) or
+        isObtained( ResourceId::UsartRx3 ) or isObtained( ResourceId::UsartTx3 ) or
+        isObtained( ResourceId::Spi ) or isObtained( ResourceId::Timer1 ) or
+        isObtained( ResourceId::Timer3 ) or isObtained( ResourceId::I2c ) ) {
+        return SLEEP_MODE_IDLE;
+    }
+
+    const bool timer2{ isObtained( ResourceId::Timer2 ) };
+
+    #ifdef AS2
+        const bool timer2Async{ timer2 and ( ASSR & ( 1 << AS2 ) ) };
+    #else
+        const bool timer2Async{ false };
+    #endif
+
+    if ( timer2 and !timer2Async ) {
+        return SLEEP_MODE_IDLE;
+    }
+
+    // entering ADC noise reduction starts a conversion, so only
+    // use it when one is already under way
+    if ( isObtained( ResourceId::Adc ) and ( ADCSRA & ( 1 << ADSC ) ) ) {
+        return SLEEP_MODE_ADC;
+    }
+
+    if ( timer2Async ) {
+        return SLEEP_MODE_PWR_SAVE;
+    }
+
+    return SLEEP_MODE_PWR_DOWN;
+}
+
+
+/// @brief Sleeps in the deepest mode getIdleSleepMode() allows, until an interrupt
+/// @param timed `true` if any Thread is waiting on a deadline, `false` otherwise.
+/// @note Called by the idle Thread, with interrupts off, so that nothing can become ready
+/// between the choice of mode and the sleep. Interrupts are on when this returns. The
+/// onSleep() handler is called with interrupts still off.
+/// @note Unlike sleep(), power-down leaves the GPIO and peripheral clocks alone. The
+/// kernel clock doesn't advance while in any mode deeper than idle, but that only happens
+/// when no Thread is waiting on a deadline.
+void Power::idle( const bool timed )
+{
+    if ( !_allowSleep ) {
+        sei();
+        return;
+    }
+
+    const uint8_t mode{ getIdleSleepMode( timed ) };
+
+    onSleep( mode );
+
+    set_sleep_mode( mode );
+    sleep_enable();
+
+    #ifdef BODS
+        if ( mode == SLEEP_MODE_PWR_DOWN or mode == SLEEP_MODE_PWR_SAVE ) {
+            sleep_bod_disable();
+        }
+    #endif
+
+    // the instruction after sei() always runs before any interrupt
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+#endif
@@ -54,6 +54,14 @@ namespace zero {
             const uint8_t mode,
             const bool force = false,
             const bool silent = false);
+
+        #ifdef ZERO_IDLE_GOVERNOR
+            // The deepest sleep mode that the peripherals in use allow
+            static uint8_t getIdleSleepMode( const bool timed );
+
+            /// @private
+            static void idle( const bool timed );
+        #endif
     };
 
 }
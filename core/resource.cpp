@@ -10,8 +10,12 @@
 /// @brief Contains functions for controlling resource access
 
 
+#include <avr/io.h>
+#include <avr/power.h>
 #include <util/atomic.h>
 #include "resource.h"
+#include "thread.h"
+#include "waitqueue.h"
 
 
 using namespace zero;
@@ -21,12 +25,112 @@ namespace {
 
     uint16_t _resourceMap{ 0 };
 
+
+    // a Thread blocked in obtain(), with granted set once release() hands it the resource
+    struct Waiter {
+        const resource::ResourceId id;
+        const Synapse* const syn;
+        bool granted;
+        Waiter* next;
+    };
+
+    WaitQueue<Waiter> _waiters;                         // every blocked Thread, oldest first
+
+
+    #ifdef ZERO_IDLE_GOVERNOR
+
+        #define ZERO_SET_CLOCK( on, name ) \
+            if ( on ) {                    \
+                power_##name##_enable();   \
+            }                              \
+            else {                         \
+                power_##name##_disable();  \
+            }
+
+        // Determines if a resource is in the map
+        bool isHeld( const resource::ResourceId id )
+        {
+            return _resourceMap & ( 1U << (uint16_t) id );
+        }
+
+
+        // Switches a peripheral's clock on or off in the PRR, to match the resource
+        // map. USART RX and TX share a clock, so it stays on while either is held.
+        void updateClock( const resource::ResourceId id )
+        {
+            using resource::ResourceId;
+
+            switch ( id ) {
+                #ifdef PRTIM1
+                    case ResourceId::Timer1: ZERO_SET_CLOCK( isHeld( id ), timer1 ); break;
+                #endif
+
+                #ifdef PRTIM2
+                    case ResourceId::Timer2: ZERO_SET_CLOCK( isHeld( id ), timer2 ); break;
+                #endif
+
+                #ifdef PRTIM3
+                    case ResourceId::Timer3: ZERO_SET_CLOCK( isHeld( id ), timer3 ); break;
+                #endif
+
+                #ifdef PRUSART0
+                    case ResourceId::UsartRx0:
+                    case ResourceId::UsartTx0:
+                        ZERO_SET_CLOCK( isHeld( ResourceId::UsartRx0 ) or isHeld( ResourceId::UsartTx0 ), usart0 );
+                        break;
+                #endif
+
+                #ifdef PRUSART1
+                    case ResourceId::UsartRx1:
+                    case ResourceId::UsartTx1:
+                        ZERO_SET_CLOCK( isHeld( ResourceId::UsartRx1 ) or isHeld( ResourceId::UsartTx1 ), usart1 );
+                        break;
+                #endif
+
+                #ifdef PRUSART2
+                    case ResourceId::UsartRx2:
+                    case ResourceId::UsartTx2:
+                        ZERO_SET_CLOCK( isHeld( ResourceId::UsartRx2 ) or isHeld( ResourceId::UsartTx2 ), usart2 );
+                        break;
+                #endif
+
+                #ifdef PRUSART3
+                    case ResourceId::UsartRx3:
+                    case ResourceId::UsartTx3:
+                        ZERO_SET_CLOCK( isHeld( ResourceId::UsartRx3 ) or isHeld( ResourceId::UsartTx3 ), usart3 );
+                        break;
+                #endif
+
+                #ifdef PRSPI
+                    case ResourceId::Spi: ZERO_SET_CLOCK( isHeld( id ), spi ); break;
+                #endif
+
+                #ifdef PRADC
+                    case ResourceId::Adc: ZERO_SET_CLOCK( isHeld( id ), adc ); break;
+                #endif
+
+                #ifdef PRTWI
+                    case ResourceId::I2c: ZERO_SET_CLOCK( isHeld( id ), twi ); break;
+                #endif
+
+                default:
+                    // Timer0 is the kernel's, and is never switched off
+                    break;
+            }
+        }
+
+        #undef ZERO_SET_CLOCK
+
+    #endif
+
 }
 
 
 /// @brief Obtains exclusive access to a resource
 /// @param id The resource you wish to access.
 /// @returns `true` if the resource was able to be reserved, `false` otherwise.
+/// @note With `IDLE_GOVERNOR` enabled in the `makefile`, peripheral clocks are kept off
+/// in the PRR until the peripheral is obtained, so obtain it before touching its registers.
 bool resource::obtain( const ResourceId id )
 {
     const uint16_t m{ 1U << (uint16_t) id };
@@ -34,6 +138,11 @@ bool resource::obtain( const ResourceId id )
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
         if ( !( _resourceMap & m ) ) {
             _resourceMap |= m;
+
+            #ifdef ZERO_IDLE_GOVERNOR
+                updateClock( id );
+            #endif
+
             return true;
         }
 
@@ -42,11 +151,89 @@ bool resource::obtain( const ResourceId id )
 }
 
 
+/// @brief Obtains exclusive access to a resource, waiting for it if necessary
+/// @param id The resource you wish to access.
+/// @param timeout The maximum length of time to wait. `0_ms` waits forever.
+/// @returns `true` if the resource is now held, `false` if the wait timed out or no
+/// signal could be allocated to wait on.
+/// @details Threads waiting for the same resource are queued first come, first served,
+/// and release() hands the resource straight to the one at the front - nobody polls,
+/// and nobody can jump the queue, including callers of the non-blocking obtain().
+/// @note Only call this from a Thread, not an ISR.
+bool resource::obtain( const ResourceId id, const Duration timeout )
+{
+    if ( obtain( id ) ) {
+        return true;
+    }
+
+    // a signal to be woken with when it's our turn
+    Synapse syn;
+
+    if ( !syn ) {
+        return false;
+    }
+
+    Waiter w{ id, &syn, false, nullptr };
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        // it may have come free while we weren't looking
+        if ( obtain( id ) ) {
+            return true;
+        }
+
+        _waiters.append( w );
+    }
+
+    syn.wait( timeout );
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        // release() will have handed it over before waking us
+        if ( w.granted ) {
+            return true;
+        }
+
+        // timed out, so we're no longer in the queue
+        _waiters.remove( w );
+    }
+
+    return false;
+}
+
+
 /// @brief Releases a previous held resource back to the system
 /// @param id The resource to be released.
+/// @note If any Threads are waiting in obtain() for the resource, it goes straight to the
+/// one that has been waiting longest, and stays held.
 void resource::release( const ResourceId id )
 {
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        for ( Waiter* w = _waiters.getHead(); w; w = w->next ) {
+            if ( w->id == id ) {
+                _waiters.remove( *w );
+                w->granted = true;
+
+                // signalling with interrupts off means the Waiter (and its
+                // Synapse) can't go out of scope before we're done with them
+                w->syn->signal();
+                return;
+            }
+        }
+
         _resourceMap &= ~( 1U << (uint16_t) id );
+
+        #ifdef ZERO_IDLE_GOVERNOR
+            updateClock( id );
+        #endif
+    }
+}
+
+
+/// @brief Determines if a resource is currently held
+/// @param id The resource of interest.
+/// @returns `true` if something has obtained the resource, `false` otherwise.
+bool resource::isObtained( const ResourceId id )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _resourceMap & ( 1U << (uint16_t) id );
     }
 }
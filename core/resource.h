@@ -11,6 +11,7 @@
 
 
 #include <stdint.h>
+#include "time.h"
 
 
 namespace zero {
@@ -66,7 +67,9 @@ namespace zero {
         };
 
         bool obtain( const ResourceId r );
+        bool obtain( const ResourceId r, const Duration timeout );
         void release( const ResourceId r );
+        bool isObtained( const ResourceId r );
 
     };    // namespace resource
 
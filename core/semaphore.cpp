@@ -0,0 +1,124 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include <util/atomic.h>
+
+#include "semaphore.h"
+#include "thread.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a new Semaphore
+/// @param initialCount Optional. Default: `0`. The number of units available to begin with.
+/// @param maxCount Optional. Default: `0xFFFF`. The most units that can be available
+/// at once. Posts beyond this are refused.
+Semaphore::Semaphore( const uint16_t initialCount, const uint16_t maxCount )
+:
+    _count{ initialCount },
+    _maxCount{ maxCount }
+{
+    // empty
+}
+
+
+/// @brief Makes one unit available, waking the next waiting Thread if there is one
+/// @returns `true` if the unit was posted, `false` if the Semaphore was already at
+/// its maximum count.
+/// @note Every post is counted, so ten posts before the consumer runs give it ten
+/// successful wait() calls.
+/// @note Posting may be done from within an ISR.
+bool Semaphore::post()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        // hand the unit straight to whoever's been waiting
+        if ( Waiter* const w = _waiters.pop() ) {
+            w->granted = true;
+            w->syn->signal();
+            return true;
+        }
+
+        if ( _count == _maxCount ) {
+            return false;
+        }
+
+        _count++;
+    }
+
+    return true;
+}
+
+
+/// @brief Takes one unit, waiting for one to be posted if there are none
+/// @param timeout Optional. Default: `0_ms` (no timeout). The maximum length of time
+/// to wait for a unit.
+/// @returns `true` if a unit was taken, `false` if the wait timed out or no signal
+/// could be allocated to wait on.
+/// @note Only call this from a Thread, not an ISR.
+bool Semaphore::wait( const Duration timeout )
+{
+    if ( tryWait() ) {
+        return true;
+    }
+
+    // a signal to be woken with when a unit comes our way
+    Synapse syn;
+
+    if ( !syn ) {
+        return false;
+    }
+
+    Waiter w{ &me, &syn, nullptr, false };
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        // one may have been posted while we weren't looking
+        if ( _count ) {
+            _count--;
+            return true;
+        }
+
+        _waiters.insertByPriority( w );
+    }
+
+    syn.wait( timeout );
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( !w.granted ) {
+            _waiters.remove( w );
+        }
+    }
+
+    return w.granted;
+}
+
+
+/// @brief Takes one unit, but only if one is available
+/// @returns `true` if a unit was taken, `false` otherwise.
+bool Semaphore::tryWait()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _count ) {
+            _count--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// @brief Gets the number of units available
+/// @returns The number of units that can be taken without waiting.
+uint16_t Semaphore::getCount() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _count;
+    }
+}
+
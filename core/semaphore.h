@@ -0,0 +1,38 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_SEMAPHORE_H
+#define TCRI_ZERO_SEMAPHORE_H
+
+
+#include <stdint.h>
+#include "thread.h"
+#include "time.h"
+#include "waitqueue.h"
+
+
+namespace zero {
+
+    /// @brief Counting semaphore, which may be posted from ISRs
+    class Semaphore {
+    public:
+        Semaphore(
+            const uint16_t initialCount = 0,            // number of units available to begin with
+            const uint16_t maxCount = 0xFFFF );         // most units that can be available at once
+
+        bool post();                                    // makes one unit available
+        bool wait( const Duration timeout = 0_ms );     // takes one unit, waiting if need be
+        bool tryWait();                                 // takes one unit only if there is one
+        uint16_t getCount() const;                      // number of units available
+
+        #include "semaphore_private.h"
+    };
+
+}    // namespace zero
+
+#endif
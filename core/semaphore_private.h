@@ -0,0 +1,26 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+
+    // a Thread blocked in wait(), with granted set once post() hands it a unit
+    struct Waiter {
+        Thread* const thread;
+        const Synapse* const syn;
+        Waiter* next;
+        bool granted;
+    };
+
+private:
+    Semaphore( const Semaphore& s ) = delete;
+    void operator=( const Semaphore& s ) = delete;
+
+    uint16_t _count;
+    const uint16_t _maxCount;
+    WaitQueue<Waiter> _waiters;
@@ -0,0 +1,185 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_TASKS
+
+
+#include "task.h"
+#include "thread.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a new Task
+/// @param entry The body of the Task, which starts with `TASK_BEGIN()` and ends with
+/// `TASK_END()`.
+/// @note The Task does not run until it is added to a TaskRunner.
+Task::Task( const TaskEntry entry )
+:
+    _entry{ entry }
+{
+    // empty
+}
+
+
+/// @brief Determines if the Task has run to completion
+/// @returns `true` if the Task has finished, `false` otherwise.
+bool Task::isFinished() const
+{
+    return _state == TaskState::Finished;
+}
+
+
+/// @brief Starts the Task from the top again, the next time its TaskRunner looks at it
+/// @note Only call this from the TaskRunner's Thread.
+void Task::restart()
+{
+    _resumePoint = 0;
+    _state = TaskState::Ready;
+    _signals = 0;
+}
+
+
+/// @brief Gets the signals that resumed the Task from its last wait
+/// @returns The signals received, or `SIG_TIMEOUT` if the wait timed out.
+SignalBitField Task::getSignals() const
+{
+    return _signals;
+}
+
+
+// Records what the Task is about to be suspended waiting for
+void Task::suspend( const TaskState state, const SignalBitField sigs, const uint32_t ms )
+{
+    _state = state;
+    _waitingSignals = sigs;
+    _signals = 0;
+    _timed = ms;
+    _wakeAt = Thread::now() + ms;
+}
+
+
+// Determines if the Task can carry on, taking any signals it was waiting for
+bool Task::isDue( SignalBitField& pending, const uint32_t now )
+{
+    switch ( _state ) {
+        case TaskState::Ready:
+        case TaskState::Polling:
+            return true;
+
+        case TaskState::Waiting:
+            if ( pending & _waitingSignals ) {
+                _signals = pending & _waitingSignals;
+                return true;
+            }
+
+            if ( _timed and (int32_t) ( now - _wakeAt ) >= 0 ) {
+                _signals = SIG_TIMEOUT;
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+
+/// @brief Adds a Task to the group
+/// @param t The Task to add. It will start from the top.
+/// @note Only call this from the TaskRunner's Thread.
+void TaskRunner::add( Task& t )
+{
+    t.restart();
+    _tasks.append( t );
+}
+
+
+/// @brief Takes a Task out of the group
+/// @param t The Task to remove.
+/// @note Only call this from the TaskRunner's Thread, which includes from within a Task.
+void TaskRunner::remove( Task& t )
+{
+    if ( _tasks.contains( t ) ) {
+        _tasks.remove( t );
+    }
+}
+
+
+/// @brief Runs the Tasks on the current Thread until they have all finished
+/// @details While every Task is suspended, the Thread sleeps in `Thread::wait()` on all
+/// the signals the Tasks are waiting for, up until the earliest Task timeout. A suspended
+/// Task costs only the Task object, not a stack.
+void TaskRunner::run()
+{
+    while ( Task* cur = _tasks.getHead() ) {
+        // let everything that can go, go
+        const uint32_t now{ Thread::now() };
+
+        while ( cur ) {
+            Task* const next{ cur->_next };
+
+            if ( cur->isDue( _pending, now ) ) {
+                cur->_state = TaskState::Ready;
+
+                if ( !cur->_entry( *cur ) ) {
+                    cur->_state = TaskState::Finished;
+                    remove( *cur );
+                }
+            }
+
+            cur = next;
+        }
+
+        _pending = 0;
+
+        // figure out what to sleep on, and for how long
+        SignalBitField sigs{ 0 };
+        uint32_t sleepMs{ 0UL };
+        bool sleepy{ true };
+
+        for ( cur = _tasks.getHead(); cur; cur = cur->_next ) {
+            if ( cur->_state == TaskState::Ready ) {
+                sleepy = false;
+                break;
+            }
+
+            uint32_t ms{ 0UL };
+
+            if ( cur->_state == TaskState::Polling ) {
+                ms = 1UL;
+            }
+            else if ( cur->_timed ) {
+                const int32_t left{ (int32_t) ( cur->_wakeAt - Thread::now() ) };
+
+                // already due, so go around again straight away
+                if ( left <= 0 ) {
+                    sleepy = false;
+                    break;
+                }
+
+                ms = (uint32_t) left;
+            }
+
+            if ( ms and ( !sleepMs or ms < sleepMs ) ) {
+                sleepMs = ms;
+            }
+
+            sigs |= cur->_waitingSignals;
+        }
+
+        if ( sleepy and ( sigs or sleepMs ) ) {
+            _pending = me.wait( sigs, Duration{ sleepMs } ) & ~SIG_TIMEOUT;
+        }
+    }
+}
+
+
+#endif
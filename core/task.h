@@ -0,0 +1,114 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_TASK_H
+#define TCRI_ZERO_TASK_H
+
+
+#ifdef ZERO_TASKS
+
+
+#include <stdint.h>
+#include "thread.h"
+#include "list.h"
+#include "time.h"
+
+
+namespace zero {
+
+    // forward decl because chicken/egg
+    class Task;
+
+    /// @private
+    /// @brief What a Task is waiting for
+    enum class TaskState : uint8_t {
+        Ready = 0,
+        Waiting,
+        Polling,
+        Finished,
+    };
+
+    /// @brief The body of a Task
+    /// @param t The Task being run.
+    /// @returns `true` if the Task suspended, `false` if it finished. Use the `TASK_xxx`
+    /// macros rather than returning directly.
+    typedef bool ( *TaskEntry )( Task& t );
+
+    /// @brief A stackless cooperative task, run by a TaskRunner on a host Thread
+    /// @details Tasks suspend by returning to the TaskRunner, so local variables do not
+    /// survive a `TASK_WAIT()`, `TASK_DELAY()` etc. Keep anything that needs to live across
+    /// a suspension in a static, or in an object the Task can reach.
+    class Task {
+    public:
+        Task( const TaskEntry entry );
+
+        bool isFinished() const;                        // determines if the Task has run to completion
+        void restart();                                 // starts the Task from the top again
+        SignalBitField getSignals() const;              // the signals that resumed the Task
+
+        #include "task_private.h"
+    };
+
+
+    /// @brief Runs a group of Tasks on the current Thread
+    class TaskRunner {
+    public:
+        void add( Task& t );                            // adds a Task to the group
+        void remove( Task& t );                         // takes a Task out of the group
+        void run();                                     // runs the Tasks until they have all finished
+
+    private:
+        List<Task> _tasks;
+        SignalBitField _pending{ 0 };
+    };
+
+}    // namespace zero
+
+
+/// @brief Starts the body of a Task. Must be the first statement of a TaskEntry.
+#define TASK_BEGIN( t )                 switch ( ( t )._resumePoint ) { case 0:
+
+/// @brief Ends the body of a Task. Must be the last statement of a TaskEntry.
+#define TASK_END( t )                   } ( t )._resumePoint = 0; return false
+
+/// @brief Lets the other Tasks run, then carries on
+#define TASK_YIELD( t )                 TASK_SUSPEND( t, zero::TaskState::Ready, 0, 0UL )
+
+/// @brief Suspends the Task until at least one of the signals is received
+#define TASK_WAIT( t, sigs )            TASK_SUSPEND( t, zero::TaskState::Waiting, sigs, 0UL )
+
+/// @brief Suspends the Task until at least one of the signals is received, or the timeout expires
+#define TASK_WAIT_FOR( t, sigs, dur )   TASK_SUSPEND( t, zero::TaskState::Waiting, sigs, (uint32_t) ( dur ) )
+
+/// @brief Suspends the Task for a length of time
+#define TASK_DELAY( t, dur )            TASK_SUSPEND( t, zero::TaskState::Waiting, 0, (uint32_t) ( dur ) )
+
+/// @brief Suspends the Task until a condition becomes true
+/// @note The condition is checked each time the TaskRunner wakes, and at least every
+/// millisecond, so prefer `TASK_WAIT()` on a Synapse where there is one.
+#define TASK_WAIT_UNTIL( t, cond )                                          \
+    do {                                                                    \
+        ( t )._resumePoint = __LINE__; [[fallthrough]]; case __LINE__:      \
+        if ( !( cond ) ) {                                                  \
+            ( t ).suspend( zero::TaskState::Polling, 0, 0UL );              \
+            return true;                                                    \
+        }                                                                   \
+    } while ( 0 )
+
+/// @private
+#define TASK_SUSPEND( t, state, sigs, ms )                                  \
+    do {                                                                    \
+        ( t ).suspend( state, sigs, ms );                                   \
+        ( t )._resumePoint = __LINE__;                                      \
+        return true; case __LINE__:;                                        \
+    } while ( 0 )
+
+
+#endif
+
+#endif
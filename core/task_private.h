@@ -0,0 +1,30 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    void suspend( const TaskState state, const SignalBitField sigs, const uint32_t ms );
+    bool isDue( SignalBitField& pending, const uint32_t now );
+
+    uint16_t _resumePoint{ 0 };
+
+    Task* _prev{ nullptr };
+    Task* _next{ nullptr };
+
+private:
+    Task( const Task& t ) = delete;
+    void operator=( const Task& t ) = delete;
+
+    friend class TaskRunner;
+
+    const TaskEntry _entry;
+    TaskState _state{ TaskState::Ready };
+    SignalBitField _waitingSignals{ 0 };
+    SignalBitField _signals{ 0 };
+    uint32_t _wakeAt{ 0UL };
+    bool _timed{ false };
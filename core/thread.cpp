@@ -27,6 +27,11 @@
 #include "debug.h"
 #include "gpio.h"
 #include "list.h"
+#include "timerwheel.h"
+#include "timer.h"
+#include "deferred.h"
+#include "watchdog.h"
+#include "trace.h"
 #include "time.h"
 #include "util.h"
 #include "attrs.h"
@@ -34,17 +39,26 @@
 
 using namespace zero;
 
+// older parts have a single timer interrupt flag register
+#ifndef TIFR0
+    #define TIFR0 TIFR
+#endif
+
 // Ready list helpers, to make list accessing and swapping easy and QUICK
-#define ACTIVE_LIST_NUM     ( _activeListNum )
-#define EXPIRED_LIST_NUM    ( _activeListNum ^ 1 )
-#define SWAP_LISTS          _activeListNum ^= 1;
+#define ACTIVE_LIST_NUM( p )    ( _activeListNum[ p ] )
+#define EXPIRED_LIST_NUM( p )   ( _activeListNum[ p ] ^ 1 )
+#define SWAP_LISTS( p )         _activeListNum[ p ] ^= 1;
 
-#define ACTIVE_LIST         _readyLists[ ACTIVE_LIST_NUM ]
-#define EXPIRED_LIST        _readyLists[ EXPIRED_LIST_NUM ]
+#define ACTIVE_LIST( p )        _readyLists[ p ][ ACTIVE_LIST_NUM( p ) ]
+#define EXPIRED_LIST( p )       _readyLists[ p ][ EXPIRED_LIST_NUM( p ) ]
 
 
 static void yield();
 
+#ifdef ZERO_SWITCH_ON_WAKE
+    static void reschedule();
+#endif
+
 // these ones are inline because we specifically don't want
 // any stack/register shenanigans because that's what these
 // functions are here to do, but in our own controlled way
@@ -56,19 +70,66 @@ static void INLINE restoreInitialRegisters();
 
 namespace {
 
+    static_assert( PRIORITY_LEVELS >= 1 and PRIORITY_LEVELS <= 8, "PRIORITY_LEVELS must be 1 to 8" );
+
     // globals
-    List<Thread> _readyLists[ 2 ];                      // the Threads that will run
+    List<Thread> _readyLists[ PRIORITY_LEVELS ][ 2 ];   // the Threads that will run, per priority level
     List<Thread> _poolThreadList;                       // the Threads waiting for code to run
-    OffsetList<Thread> _timeoutList;                    // the list of Threads wanting to sleep for a time
+    #ifdef ZERO_TIMER_WHEEL
+        TimerWheel<Thread, TIMER_WHEEL_SLOTS> _timeoutList; // the Threads wanting to sleep, hashed by deadline
+    #else
+        OffsetList<Thread> _timeoutList;                // the list of Threads wanting to sleep for a time
+    #endif
     Thread* _currentThread{ nullptr };                  // the currently executing thread
     Thread* _idleThread{ nullptr };                     // to run when there's nothing else to do, and only then
     uint16_t _nextId{ 0 };                              // ID to use for the next Thread
-    volatile uint8_t _activeListNum{ 0 };               // which of the two ready lists are we using as the active list?
+    volatile uint8_t _activeListNum[ PRIORITY_LEVELS ]; // which of each level's two ready lists is the active list?
+    volatile uint8_t _readyBitmap{ 0 };                 // bit n set when priority level n has Threads ready to run
     volatile uint32_t _milliseconds{ 0UL };             // 49 day millisecond counter
     volatile bool _switchingEnabled{ true };            // context switching ISR enabled?
 
+    #ifdef ZERO_SWITCH_BENCH
+        SwitchBench _switchBench[ 3 ];                  // cycle counts, per SwitchPath
+        volatile uint16_t _switchBenchStart;            // Timer1 count at the start of the current switch
+    #endif
+
+    #ifdef ZERO_JOB_QUEUE
+        static_assert( JOB_QUEUE_ITEMS >= 1 and JOB_QUEUE_ITEMS <= 255, "JOB_QUEUE_ITEMS must be 1 to 255" );
+
+        struct Job {
+            const char* name;
+            JobEntry entry;
+            void* arg;
+            const Synapse* termSyn;
+            int* exitCode;
+        };
+
+        Job _jobs[ JOB_QUEUE_ITEMS ];                   // jobs waiting for a pool Thread, in FIFO order
+        uint8_t _jobHead{ 0 };                          // index of the oldest waiting job
+        uint8_t _jobCount{ 0 };                         // number of waiting jobs
+        uint8_t _jobRunners{ 0 };                       // number of pool Threads running jobs
+    #endif
+
+    #ifdef ZERO_THREAD_STATS
+        Thread* _threadRegistry{ nullptr };             // every Thread in the system, for forEach()
+    #endif
+
+    #ifdef ZERO_SWITCH_ON_WAKE
+        volatile bool _switchPending{ false };          // has signal() brought the next pre-emption check forward?
+    #endif
+
+    #ifdef ZERO_TICKLESS_IDLE
+        volatile bool _ticklessActive{ false };         // is the heartbeat currently stretched out?
+        uint16_t _ticklessCarry{ 0 };                   // CPU cycles not yet accounted for as a whole ms
+    #endif
+
     // constants
     const uint8_t SIGNAL_BITS{ sizeof( SignalBitField ) * 8 };
+
+    #ifdef ZERO_STACK_PAINT
+        const uint8_t STACK_PAINT{ 0xA5 };              // what unused stack looks like
+        const uint16_t STACK_CANARY{ 0xA5A5 };          // the bottom two bytes, while they're untouched
+    #endif
     const uint16_t REGISTER_COUNT{ 32 };
 
     #ifdef RAMPZ
@@ -79,6 +140,15 @@ namespace {
 
     #define MIN_STACK_BYTES 128
 
+    #ifdef ZERO_TICKLESS_IDLE
+        // While tickless, Timer0 runs from the /1024 prescalar, so each timer
+        // tick is 1024 CPU cycles, and the longest stretch is 256 timer ticks
+        // (16ms at 16MHz).
+        const uint16_t CYCLES_PER_MS{ F_CPU / 1000UL };
+        const uint16_t TICKLESS_MAX_TICKS{ 256 };
+        const uint16_t TICKLESS_MAX_MS{ ( TICKLESS_MAX_TICKS * 1024UL ) / CYCLES_PER_MS };
+    #endif
+
 
     // the offsets from the stack top (as seen AFTER all the registers have been pushed onto
     // the stack already) of each of the nine (9) parameters that are register-passed by GCC
@@ -96,26 +166,209 @@ namespace {
     }
 
 
-    // Chooses the next Thread to run. This is the head of the active list,
-    // unless there are no Threads ready to run, in which case this will
-    // choose the idle Thread.
-    Thread* selectNextThread()
+    #ifdef ZERO_TICKLESS_IDLE
+        void enterTickless();
+    #endif
+
+
+    #if PRIORITY_LEVELS > 1
+        // the highest set bit in each nibble value, for O(1) priority lookups
+        const uint8_t PROGMEM _highestBit[ 16 ] = { 0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+    #endif
+
+
+    // Determines the highest priority level with Threads ready to run.
+    // Only meaningful when _readyBitmap is non-zero.
+    uint8_t getHighestReadyPriority()
     {
-        Thread* rc{ ACTIVE_LIST.getHead() };
+        #if PRIORITY_LEVELS > 4
+            if ( _readyBitmap & 0xF0 ) {
+                return 4 + pgm_read_byte( &_highestBit[ _readyBitmap >> 4 ] );
+            }
+        #endif
 
-        if ( !rc ) {
-            SWAP_LISTS;
-            rc = ACTIVE_LIST.getHead();
+        #if PRIORITY_LEVELS > 1
+            return pgm_read_byte( &_highestBit[ _readyBitmap & 0x0F ] );
+        #else
+            return 0;
+        #endif
+    }
+
+
+    // Keeps the ready bitmap in step with a priority level's lists
+    void updateReadyBit( const uint8_t p )
+    {
+        if ( ACTIVE_LIST( p ).getHead() or EXPIRED_LIST( p ).getHead() ) {
+            _readyBitmap |= ( 1 << p );
+        }
+        else {
+            _readyBitmap &= ~( 1 << p );
+        }
+    }
+
+
+    // Puts a Thread at the front of the active list for its priority
+    void prependReady( Thread& t )
+    {
+        ACTIVE_LIST( t._priority ).prepend( t );
+        _readyBitmap |= ( 1 << t._priority );
+    }
+
+
+    // Puts a Thread at the end of the active list for its priority
+    void appendReady( Thread& t )
+    {
+        ACTIVE_LIST( t._priority ).append( t );
+        _readyBitmap |= ( 1 << t._priority );
+    }
+
+
+    // Takes a Thread out of the active list for its priority
+    void removeReady( Thread& t )
+    {
+        ACTIVE_LIST( t._priority ).remove( t );
+        updateReadyBit( t._priority );
+    }
+
+
+    // Moves a Thread that has used up its quantum to the expired list
+    void expireThread( Thread& t )
+    {
+        ACTIVE_LIST( t._priority ).remove( t );
+        EXPIRED_LIST( t._priority ).append( t );
+    }
+
+
+    // Puts a Thread to sleep for its _timeoutOffset milliseconds
+    void addSleeper( Thread& t )
+    {
+        #ifdef ZERO_TIMER_WHEEL
+            _timeoutList.insertByOffset( t, _milliseconds, t._timeoutOffset );
+        #else
+            _timeoutList.insertByOffset( t, t._timeoutOffset );
+        #endif
+    }
 
-            if ( !rc ) {
-                rc = _idleThread;
+
+    // Wakes the sleepers whose time is up, once the clock has
+    // been moved forward by a millisecond
+    void wakeSleepers()
+    {
+        #ifdef ZERO_TIMER_WHEEL
+            // only the sleepers due right now are taken out of the wheel
+            while ( Thread* const curSleeper = _timeoutList.popExpired( _milliseconds ) ) {
+                curSleeper->signal( SIG_TIMEOUT );
+            }
+        #else
+            if ( Thread* curSleeper = _timeoutList.getHead() ) {
+                if ( curSleeper->_timeoutOffset ) {
+                    curSleeper->_timeoutOffset--;
+                }
+
+                while ( curSleeper and !curSleeper->_timeoutOffset ) {
+                    _timeoutList.remove( *curSleeper );
+                    curSleeper->signal( SIG_TIMEOUT );
+
+                    curSleeper = _timeoutList.getHead();
+                }
             }
+        #endif
+    }
+
+
+    // Determines if a Thread would be chosen again straight after being
+    // expired, because there's nothing else ready at its level (or above)
+    bool isOnlyReadyThread( const Thread& t )
+    {
+        if ( &t == _idleThread or t._priority != getHighestReadyPriority() ) {
+            return false;
+        }
+
+        return ACTIVE_LIST( t._priority ).getHead() == &t and
+               ACTIVE_LIST( t._priority ).getTail() == &t and
+               !EXPIRED_LIST( t._priority ).getHead();
+    }
+
+
+    // Determines which Thread selectNextThread() would choose, without
+    // actually swapping any lists
+    Thread* peekNextThread()
+    {
+        if ( !_readyBitmap ) {
+            return _idleThread;
+        }
+
+        const uint8_t p{ getHighestReadyPriority() };
+        Thread* const rc{ ACTIVE_LIST( p ).getHead() };
+
+        return rc ? rc : EXPIRED_LIST( p ).getHead();
+    }
+
+
+    // Chooses the next Thread to run. This is the head of the active list
+    // of the highest priority level that has Threads ready to run, unless
+    // there are no Threads ready to run, in which case this will choose
+    // the idle Thread.
+    Thread* selectNextThread()
+    {
+        #ifdef ZERO_TICKLESS_IDLE
+            // nobody else wants to run, so nobody needs the 1ms heartbeat
+            // (unless catching up on a tick wakes somebody)
+            if ( !_readyBitmap ) {
+                enterTickless();
+            }
+        #endif
+
+        if ( !_readyBitmap ) {
+            return _idleThread;
+        }
+
+        const uint8_t p{ getHighestReadyPriority() };
+        Thread* rc{ ACTIVE_LIST( p ).getHead() };
+
+        if ( !rc ) {
+            SWAP_LISTS( p );
+            rc = ACTIVE_LIST( p ).getHead();
         }
 
         return rc;
     }
 
 
+#ifdef ZERO_SWITCH_BENCH
+
+    // Starts Timer1 free-running at the CPU clock, as the benchmark's stopwatch
+    void initSwitchBench()
+    {
+        power_timer1_enable();
+        TCCR1A = 0;
+        TCCR1B = ( 1 << CS10 );                         // no prescaling
+        Thread::resetSwitchBench();
+    }
+
+
+    // Notes the time at the start of a switch path
+    void INLINE switchBenchStart()
+    {
+        _switchBenchStart = TCNT1;
+    }
+
+
+    // Records how many cycles a switch path took
+    void INLINE switchBenchStop( const SwitchPath path )
+    {
+        const uint16_t cycles{ (uint16_t) ( TCNT1 - _switchBenchStart ) };
+        SwitchBench& b{ _switchBench[ (uint8_t) path ] };
+
+        b.count++;
+        b.totalCycles += cycles;
+        b.minCycles = MIN( b.minCycles, cycles );
+        b.maxCycles = MAX( b.maxCycles, cycles );
+    }
+
+#endif
+
+
     uint16_t getNewThreadId()
     {
         ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
@@ -124,8 +377,8 @@ namespace {
     }
 
 
-    // zero's heartbeat
-    void initTimer0()
+    // (re)starts the regular 1ms heartbeat
+    void startHeartbeat()
     {
         #define SCALE( x )      ( ( F_CPU_MHZ * ( x ) ) / 16U )
 
@@ -133,12 +386,6 @@ namespace {
             #define TIMSK0 TIMSK
         #endif
 
-        static_assert( QUANTUM_TICKS > 1, "QUANTUM_TICKS must be two (2) or more" );
-        static_assert( F_CPU >=  4'000'000, "Must use a 4MHz clock or faster" );
-        static_assert( F_CPU <= 24'000'000, "Must use a 24MHz clock or slower" );
-
-        // 8-bit Timer/Counter0
-        power_timer0_enable();                          // switch it on
         TCCR0B = 0;                                     // stop the clock
         TCNT0 = 0;                                      // reset counter to 0
         TCCR0A = ( 1 << WGM01 );                        // CTC
@@ -151,6 +398,178 @@ namespace {
         TIMSK0 |= ( 1 << OCIE0B );                      // enable ISR
     }
 
+
+    // zero's heartbeat
+    void initTimer0()
+    {
+        static_assert( QUANTUM_TICKS > 1, "QUANTUM_TICKS must be two (2) or more" );
+        static_assert( F_CPU >=  4'000'000, "Must use a 4MHz clock or faster" );
+        static_assert( F_CPU <= 24'000'000, "Must use a 24MHz clock or slower" );
+
+        // 8-bit Timer/Counter0
+        power_timer0_enable();                          // switch it on
+        startHeartbeat();
+    }
+
+
+#ifdef ZERO_SWITCH_ON_WAKE
+
+    // Brings the next pre-emption check forward to the very next Timer0 tick
+    // or two (16-32us at 16MHz), rather than waiting for the end of the current
+    // millisecond. Used when a Thread is woken while interrupts are off, which
+    // is usually from within an ISR.
+    void requestEarlySwitch()
+    {
+        const uint8_t soon{ (uint8_t) ( TCNT0 + 2 ) };
+
+        // if the regular tick is closer than that anyway, let it do the job
+        if ( soon < OCR0A ) {
+            _switchPending = true;
+            OCR0B = soon;
+        }
+    }
+
+#endif
+
+
+#ifdef ZERO_TICKLESS_IDLE
+
+
+    // Moves the clock forward by a number of milliseconds at once,
+    // waking any sleepers whose deadlines have now passed
+    void advanceClock( uint32_t elapsedMs )
+    {
+        #ifdef ZERO_THREAD_STATS
+            // the whole stretch was spent idle
+            _idleThread->_stats.runTicks += elapsedMs;
+        #endif
+
+        #ifdef ZERO_TIMER_WHEEL
+            // visit each slot that went by in turn
+            while ( elapsedMs-- ) {
+                _milliseconds++;
+                wakeSleepers();
+            }
+        #else
+            _milliseconds += elapsedMs;
+
+            while ( Thread* curSleeper = _timeoutList.getHead() ) {
+                if ( curSleeper->_timeoutOffset > elapsedMs ) {
+                    curSleeper->_timeoutOffset -= elapsedMs;
+                    break;
+                }
+
+                elapsedMs -= curSleeper->_timeoutOffset;
+                curSleeper->_timeoutOffset = 0UL;
+
+                _timeoutList.remove( *curSleeper );
+                curSleeper->signal( SIG_TIMEOUT );
+            }
+        #endif
+    }
+
+
+    // Converts a number of /1024 timer ticks into elapsed time
+    void accountTicks( const uint16_t ticks )
+    {
+        const uint32_t cycles{ ( ticks * 1024UL ) + _ticklessCarry };
+
+        _ticklessCarry = cycles % CYCLES_PER_MS;
+        advanceClock( cycles / CYCLES_PER_MS );
+    }
+
+
+    // Programs Timer0 to fire once, at the next sleeper's deadline (or as
+    // far out as the 8-bit timer allows, if that's sooner)
+    void armTickless()
+    {
+        uint16_t ticks{ TICKLESS_MAX_TICKS };
+
+        #ifdef ZERO_TIMER_WHEEL
+            const uint32_t nextOffset{ _timeoutList.getNextOffset( _milliseconds, TICKLESS_MAX_MS ) };
+        #else
+            const Thread* const nextSleeper{ _timeoutList.getHead() };
+            const uint32_t nextOffset{ nextSleeper ? nextSleeper->_timeoutOffset : 0UL };
+        #endif
+
+        if ( nextOffset ) {
+            if ( nextOffset <= TICKLESS_MAX_MS ) {
+                uint32_t cycles{ nextOffset * CYCLES_PER_MS };
+
+                cycles = ( cycles > _ticklessCarry ) ? ( cycles - _ticklessCarry ) : 0UL;
+                ticks = cycles / 1024UL;
+
+                // wake early rather than late - the remainder gets picked
+                // up by one more (very short) stretch
+                if ( !ticks ) {
+                    ticks = 1;
+                }
+            }
+        }
+
+        TCCR0B = 0;                                     // stop the clock
+        TCNT0 = 0;                                      // reset counter to 0
+        OCR0A = ticks - 1;                              // next deadline
+        TIFR0 = ( 1 << OCF0A ) | ( 1 << OCF0B );        // forget anything pending
+        TCCR0B = ( 1 << CS02 ) | ( 1 << CS00 );         // /1024 prescalar
+
+        _ticklessActive = true;
+    }
+
+
+    // Stretches the heartbeat out to the next sleeper's deadline. Only the
+    // idle Thread is running, so there's nothing to pre-empt either.
+    void enterTickless()
+    {
+        if ( _ticklessActive ) {
+            return;
+        }
+
+        // the 1ms compare may have matched without the ISR having run yet,
+        // and re-arming the timer would forget it
+        if ( TIFR0 & ( 1 << OCF0A ) ) {
+            TIFR0 = ( 1 << OCF0A );
+            _milliseconds++;
+            wakeSleepers();
+
+            #ifdef ZERO_DRIVERS_WDT
+                Watchdog::onTick();
+            #endif
+
+            // someone woke, so the heartbeat is still needed
+            if ( _readyBitmap ) {
+                return;
+            }
+        }
+
+        // keep the part of the current millisecond that has already gone by
+        _ticklessCarry += TCNT0 * 256U;
+
+        TIMSK0 &= ~( 1 << OCIE0B );
+        armTickless();
+    }
+
+
+    // Returns to the regular 1ms heartbeat, bringing the clock up to date
+    // with however much of the stretch has gone by
+    void exitTickless()
+    {
+        uint16_t ticks{ TCNT0 };
+
+        // the compare may have matched without the ISR having run yet
+        if ( TIFR0 & ( 1 << OCF0A ) ) {
+            ticks += OCR0A + 1;
+        }
+
+        _ticklessActive = false;
+
+        startHeartbeat();
+        TIFR0 = ( 1 << OCF0A ) | ( 1 << OCF0B );
+        accountTicks( ticks );
+    }
+
+#endif
+
 }    // namespace
 
 
@@ -163,26 +582,77 @@ void WEAK onThrexit( Thread&, const int )
 
 /// @brief Default stack overflow handler. Called when a Thread uses more stack space than
 /// is available.
-void WEAK onStackOverflow( Thread& )
+/// @note With debug output enabled, this reports the Thread's name using the blocking
+/// debug path, as the debug drain Thread might not get to run again.
+void WEAK onStackOverflow( Thread& t )
 {
-    // empty
+    #ifdef DEBUG_ENABLED
+        const char* const tName{ t.getName() };
+
+        if ( tName ) {
+            debug::printBlocking( tName, true );
+            debug::printBlocking( PSTR( " - " ), true );
+        }
+
+        debug::printBlocking( PSTR( "stack overflow\r\n" ), true );
+    #else
+        // nowhere to report it
+        (void) t;
+    #endif
 }
 
 
+#ifdef ZERO_IDLE_GOVERNOR
+
+// Determines if any Thread is waiting on a deadline
+static bool hasSleepers()
+{
+    #ifdef ZERO_TIMER_WHEEL
+        return !_timeoutList.isEmpty();
+    #else
+        return _timeoutList.getHead() != nullptr;
+    #endif
+}
+
+#endif
+
+
 /// @brief Default idle thread. Called when there are no Threads wanting to run.
 /// @details You can implement your own idle thread by providing your own replacement for
-/// this function.
+/// this function. With `IDLE_GOVERNOR` enabled in the `makefile`, the default sleeps in
+/// the deepest mode that the running peripherals and pending deadlines allow (see
+/// Power::getIdleSleepMode()).
 /// @note Do **not** block in the idle Thread. That means do not call any function that
 /// directly or indirectly calls Thread::wait() or Thread::delay(). Always be busy, or
 /// send the MCU to sleep.
 int WEAK idleThreadEntry()
 {
     while ( true ) {
-        Power::sleep( SLEEP_MODE_IDLE );
+        #ifdef ZERO_IDLE_GOVERNOR
+            // decide and sleep with interrupts off, so no deadline can sneak in
+            cli();
+            Power::idle( hasSleepers() );
+        #else
+            Power::sleep( SLEEP_MODE_IDLE );
+        #endif
     }
 }
 
 
+// Determines if a Thread has run off the bottom of its stack
+static bool INLINE isStackOverflowed( const Thread& t )
+{
+    #ifdef ZERO_STACK_PAINT
+        // catches overflows that happened, and unwound, between switches
+        if ( *( (const uint16_t*) t._stackBottom ) != STACK_CANARY ) {
+            return true;
+        }
+    #endif
+
+    return t._lowSp < (uint16_t) t._stackBottom;
+}
+
+
 static void callStackOverflowHandler()
 {
     const uint16_t oldSp = SP;
@@ -234,8 +704,22 @@ void Thread::globalThreadEntry(
         notifySyn->signal();
     }
 
+    #ifdef ZERO_JOB_QUEUE
+        // A job may have turned up after the last runner gave up looking, while
+        // this Thread wasn't yet back in the pool for submit() to start. It can't
+        // be reanimated while it's still running on its own stack, so it runs the
+        // jobs itself. Interrupts stay off from the last check until the Thread is
+        // back in the pool, so nothing can slip in between.
+        while ( ( flags & TF_POOL_THREAD ) and _jobCount and !_jobRunners ) {
+            _jobRunners++;
+            sei();
+            runJobs();
+            cli();
+        }
+    #endif
+
     // remove from the list of Threads
-    ACTIVE_LIST.remove( t );
+    removeReady( t );
 
     // forget us so that no context is remembered
     // superfluously in the yield() below
@@ -270,6 +754,8 @@ Thread& Thread::getCurrent()
 /// @brief Gets the number of milliseconds since the MCU started
 /// @returns The number milliseconds since the last reset event.
 /// @note Wraps around after approximately 49 continuous days.
+/// @note With `TICKLESS_IDLE` enabled in the `makefile`, the count is brought up to date
+/// when a Thread wakes, so code running in the idle Thread may see a slightly stale value.
 uint32_t Thread::now()
 {
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
@@ -278,6 +764,67 @@ uint32_t Thread::now()
 }
 
 
+#ifdef ZERO_SWITCH_BENCH
+
+/// @brief Gets the cycle counts recorded for a context switch path
+/// @param path The path of interest.
+/// @returns A snapshot of the counts for the path.
+/// @note Only available when `SWITCH_BENCH` is enabled in the `makefile`, which uses
+/// Timer1 as a stopwatch.
+SwitchBench Thread::getSwitchBench( const SwitchPath path )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _switchBench[ (uint8_t) path ];
+    }
+}
+
+
+/// @brief Clears the cycle counts for all context switch paths
+/// @note Only available when `SWITCH_BENCH` is enabled in the `makefile`.
+void Thread::resetSwitchBench()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        for ( auto& b : _switchBench ) {
+            b = SwitchBench{ 0UL, 0UL, 0xFFFF, 0 };
+        }
+    }
+}
+
+#endif
+
+
+#ifdef ZERO_THREAD_STATS
+
+/// @brief Gets the number of 1ms ticks spent running the idle Thread
+/// @details Comparing this against now() over an interval gives the overall CPU
+/// utilisation for that interval.
+/// @note Only available when `THREAD_STATS` is enabled in the `makefile`.
+uint32_t Thread::getIdleTicks()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _idleThread ? _idleThread->_stats.runTicks : 0UL;
+    }
+}
+
+
+/// @brief Calls a function for every Thread in the system
+/// @details This includes the idle Thread, and any pool Threads. Context switching is
+/// disabled while the Threads are being visited (interrupts remain enabled), so keep
+/// the callback short, and do not block in it.
+/// @param v The function to call for each Thread.
+/// @note Only available when `THREAD_STATS` is enabled in the `makefile`.
+void Thread::forEach( const ThreadVisitor v )
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        for ( Thread* cur = _threadRegistry; cur; cur = cur->_nextInRegistry ) {
+            v( *cur );
+        }
+    }
+}
+
+#endif
+
+
 /// @brief Switches context switching off
 /// @see permit(), isSwitchingEnabled()
 void Thread::forbid()
@@ -318,6 +865,12 @@ void Thread::reanimate(
 
     _id = getNewThreadId();
     _name = name;
+    _priority = TP_DEFAULT;
+    _quantumTicks = QUANTUM_TICKS;
+
+    #ifdef ZERO_THREAD_STATS
+        _stats = ThreadStats{ 0UL, 0UL, 0UL };
+    #endif
 
     // little helper for stack manipulation - yes, we're
     // going to deliberately index through a null pointer!
@@ -362,11 +915,26 @@ void Thread::reanimate(
     _sp = newStackTop;
     _lowSp = _sp;
 
+    #ifdef ZERO_STACK_PAINT
+        // paint everything below the prepared frame, so we can see how far the
+        // Thread really gets - this includes the canary at the very bottom
+        for ( uint16_t addr = (uint16_t) _stackBottom; addr <= newStackTop; addr++ ) {
+            SRAM[ addr ] = STACK_PAINT;
+        }
+    #endif
+
     // signal defaults
     _allocatedSignals = SIG_ALL_RESERVED;
     _waitingSignals = 0;
     _currentSignals = 0;
 
+    #if TLS_SLOTS > 0
+        // a recycled pool Thread mustn't see its last job's pointers
+        for ( uint8_t i = 0; i < TLS_SLOTS; i++ ) {
+            _locals[ i ] = nullptr;
+        }
+    #endif
+
     // sleeping time
     _timeoutOffset = 0UL;
 }
@@ -406,7 +974,7 @@ Thread* Thread::fromPool(
                 exitCode );
 
             // make sure it gets to run
-            ACTIVE_LIST.prepend( *rc );
+            prependReady( *rc );
         }
 
         return rc;
@@ -414,6 +982,90 @@ Thread* Thread::fromPool(
 }
 
 
+#ifdef ZERO_JOB_QUEUE
+
+/// @brief Queues a job to be run on a pool Thread
+/// @details If a pool Thread is free, it starts on the job straight away. Otherwise the
+/// job waits in a FIFO, and is picked up by the first pool Thread to finish the job it
+/// is running, without that Thread going back to the pool first.
+/// @param name Name of the job (is a pointer into Flash memory, not SRAM).
+/// @param entry The job's entry point.
+/// @param arg Optional. Default: `nullptr`. The argument to pass to `entry`.
+/// @param termSyn Optional. Default: `nullptr`. A pointer to the Synapse to signal
+/// when the job completes.
+/// @param exitCode Optional. Default: `nullptr`. A pointer to an `int` to store the
+/// job's return code.
+/// @returns `true` if the job was accepted, `false` if the queue is full.
+/// @note The size of the queue is set by `JOB_QUEUE_ITEMS` in the `makefile`. Jobs need
+/// `NUM_POOL_THREADS` to be at least 1 to ever run.
+bool Thread::submit(
+    const char* const name,
+    const JobEntry entry,
+    void* const arg,
+    const Synapse* const termSyn,
+    int* const exitCode )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _jobCount == JOB_QUEUE_ITEMS ) {
+            return false;
+        }
+
+        _jobs[ ( _jobHead + _jobCount ) % JOB_QUEUE_ITEMS ] = Job{ name, entry, arg, termSyn, exitCode };
+        _jobCount++;
+
+        // put another pool Thread on the job, if one's free
+        startJobRunner();
+    }
+
+    return true;
+}
+
+
+// The entry point of a pool Thread running jobs. Keeps taking jobs
+// from the queue until there are none left.
+int Thread::runJobs()
+{
+    while ( true ) {
+        Job job;
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            if ( !_jobCount ) {
+                // back to the pool
+                _jobRunners--;
+                return 0;
+            }
+
+            job = _jobs[ _jobHead ];
+            _jobHead = ( _jobHead + 1 ) % JOB_QUEUE_ITEMS;
+            _jobCount--;
+
+            _currentThread->_name = job.name;
+        }
+
+        const int ec{ job.entry( job.arg ) };
+
+        if ( job.exitCode ) {
+            *job.exitCode = ec;
+        }
+
+        if ( job.termSyn ) {
+            job.termSyn->signal();
+        }
+    }
+}
+
+
+// Starts a free pool Thread (if there is one) running jobs
+void Thread::startJobRunner()
+{
+    if ( fromPool( PSTR( "job" ), runJobs ) ) {
+        _jobRunners++;
+    }
+}
+
+#endif
+
+
 /// @brief Creates a new Thread.
 /// @par Example
 /// @code
@@ -451,6 +1103,12 @@ Thread::Thread(
     dbg_assert( _stackBottom and _stackSize, "No stack memory" );
 
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        #ifdef ZERO_THREAD_STATS
+            // make sure forEach() can find us
+            _nextInRegistry = _threadRegistry;
+            _threadRegistry = this;
+        #endif
+
         // Pool Threads get stored away, ready for use
         if ( flags & TF_POOL_THREAD ) {
             _poolThreadList.append( *this );
@@ -462,7 +1120,7 @@ Thread::Thread(
             // ready to run?
             if ( flags & TF_READY ) {
                 // add the Thread into the ready list
-                ACTIVE_LIST.append( *this );
+                appendReady( *this );
             }
         }        
     }
@@ -472,6 +1130,21 @@ Thread::Thread(
 // dtor
 Thread::~Thread()
 {
+    #ifdef ZERO_THREAD_STATS
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            // unhook from the registry
+            Thread** cur{ &_threadRegistry };
+
+            while ( *cur and *cur != this ) {
+                cur = &( *cur )->_nextInRegistry;
+            }
+
+            if ( *cur ) {
+                *cur = _nextInRegistry;
+            }
+        }
+    #endif
+
     // deallocate the stack
     memory::free( _stackBottom, _stackSize );
 }
@@ -541,6 +1214,137 @@ ThreadStatus Thread::getStatus() const
 }
 
 
+/// @brief Gets the Thread's scheduling priority
+/// @returns The priority, from TP_LOWEST to TP_HIGHEST.
+/// @see setPriority()
+ThreadPriority Thread::getPriority() const
+{
+    return _priority;
+}
+
+
+/// @brief Sets the Thread's scheduling priority
+/// @details Threads of a higher priority always run in preference to Threads of a lower
+/// priority. Threads of equal priority are time-sliced round-robin, as usual.
+/// @param p The new priority. Values above TP_HIGHEST are treated as TP_HIGHEST.
+/// @note The number of priority levels is set in the `makefile`, search for
+/// `PRIORITY_LEVELS`.
+/// @see getPriority()
+void Thread::setPriority( const ThreadPriority p )
+{
+    const ThreadPriority newPriority{ MIN( p, TP_HIGHEST ) };
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( newPriority == _priority or this == _idleThread ) {
+            return;
+        }
+
+        List<Thread>& activeList{ ACTIVE_LIST( _priority ) };
+        List<Thread>& expiredList{ EXPIRED_LIST( _priority ) };
+
+        // Threads that are waiting or pooled aren't in a ready list,
+        // so there's nothing to move
+        if ( activeList.contains( *this ) ) {
+            activeList.remove( *this );
+        }
+        else if ( expiredList.contains( *this ) ) {
+            expiredList.remove( *this );
+        }
+        else {
+            _priority = newPriority;
+            return;
+        }
+
+        updateReadyBit( _priority );
+        _priority = newPriority;
+
+        // the running Thread stays at the head of its (new) active list, so
+        // that the next tick can decide if it should give way to someone else
+        if ( this == _currentThread ) {
+            prependReady( *this );
+        }
+        else {
+            appendReady( *this );
+        }
+    }
+}
+
+
+/// @brief Gets the Thread's time slice
+/// @returns The number of 1ms ticks the Thread may run for before being pre-empted by
+/// another Thread of the same priority.
+/// @see setQuantum()
+uint8_t Thread::getQuantum() const
+{
+    return _quantumTicks;
+}
+
+
+/// @brief Sets the Thread's time slice
+/// @details Short slices make a Thread more responsive to its peers, at the cost of more
+/// context switches. Long slices suit number-crunching Threads that would rather not be
+/// interrupted. The new slice takes effect the next time the Thread's quantum is topped
+/// up.
+/// @param ticks The number of 1ms ticks the Thread may run for before being pre-empted.
+/// Zero (0) is treated as one (1).
+/// @note The default for every Thread is set in the `makefile`, search for
+/// `QUANTUM_TICKS`.
+/// @see getQuantum()
+void Thread::setQuantum( const uint8_t ticks )
+{
+    _quantumTicks = ticks ? ticks : 1;
+}
+
+
+#ifdef ZERO_THREAD_STATS
+
+/// @brief Gets the Thread's scheduling statistics
+/// @returns A snapshot of the Thread's context switch counts and run time.
+/// @note Only available when `THREAD_STATS` is enabled in the `makefile`.
+ThreadStats Thread::getStats() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _stats;
+    }
+}
+
+#endif
+
+
+#if TLS_SLOTS > 0
+
+/// @brief Gets one of the Thread's local storage slots
+/// @param slot The slot number, from `0` to `TLS_SLOTS - 1`.
+/// @returns The pointer last stored in the slot by setLocal(), or `nullptr` if there
+/// isn't one or the slot number is out of range.
+/// @note Only available when `TLS_SLOTS` in the `makefile` is more than zero. Slots are
+/// cleared when the Thread starts (including each time a pool Thread is reused).
+/// @see setLocal()
+void* Thread::getLocal( const uint8_t slot ) const
+{
+    return ( slot < TLS_SLOTS ) ? _locals[ slot ] : nullptr;
+}
+
+
+/// @brief Sets one of the Thread's local storage slots
+/// @details Each Thread has `TLS_SLOTS` pointers of its own, so per-Thread state - a
+/// parser, an arena - can be found straight from `me.getLocal( n )`, without a table to
+/// search by Thread ID.
+/// @param slot The slot number, from `0` to `TLS_SLOTS - 1`. Out of range slots are
+/// ignored.
+/// @param value The pointer to store. What it points to belongs to the caller.
+/// @note Only available when `TLS_SLOTS` in the `makefile` is more than zero.
+/// @see getLocal()
+void Thread::setLocal( const uint8_t slot, void* const value )
+{
+    if ( slot < TLS_SLOTS ) {
+        _locals[ slot ] = value;
+    }
+}
+
+#endif
+
+
 /// @brief Gets the size of the stack, in bytes
 uint16_t Thread::getStackSizeBytes() const
 {
@@ -549,9 +1353,26 @@ uint16_t Thread::getStackSizeBytes() const
 
 
 /// @brief Gets the peak recorded stack usage, in bytes
+/// @note With `STACK_PAINT` enabled in the `makefile`, this scans the stack for the
+/// deepest byte ever written, so it includes calls made between context switches.
+/// Otherwise, only the stack depth at each context switch is recorded.
 uint16_t Thread::getStackPeakUsageBytes() const
 {
-    return ( _stackSize - ( _lowSp - (uint16_t) _stackBottom ) );
+    const uint16_t atSwitches{ (uint16_t) ( _stackSize - ( _lowSp - (uint16_t) _stackBottom ) ) };
+
+    #ifdef ZERO_STACK_PAINT
+        uint16_t untouched{ 0 };
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            while ( untouched < _stackSize and _stackBottom[ untouched ] == STACK_PAINT ) {
+                untouched++;
+            }
+        }
+
+        return MAX( atSwitches, (uint16_t) ( _stackSize - untouched ) );
+    #else
+        return atSwitches;
+    #endif
 }
 
 
@@ -667,6 +1488,11 @@ static void yield()
     if ( _currentThread ) {
         // save current context for when we unblock
         saveInitialRegisters();
+
+        #ifdef ZERO_SWITCH_BENCH
+            switchBenchStart();
+        #endif
+
         saveExtendedRegisters();
         _currentThread->_sp = SP;
 
@@ -674,21 +1500,30 @@ static void yield()
         _currentThread->_lowSp = MIN( _currentThread->_lowSp, _currentThread->_sp );
 
         // check for stack overflow
-        if ( _currentThread->_lowSp < (uint16_t) _currentThread->_stackBottom ) {
+        if ( isStackOverflowed( *_currentThread ) ) {
             callStackOverflowHandler();
         }
 
+        #ifdef ZERO_THREAD_STATS
+            _currentThread->_stats.voluntarySwitches++;
+        #endif
+
         // take it out of the running
-        ACTIVE_LIST.remove( *_currentThread );
+        removeReady( *_currentThread );
 
         // see if it wanted to sleep
         if ( _currentThread->_timeoutOffset ) {
-            _timeoutList.insertByOffset( *_currentThread, _currentThread->_timeoutOffset );
+            addSleeper( *_currentThread );
         }
     }
 
     // select the next thread to run
     _currentThread = selectNextThread();
+    trace_event( TraceEvent::Switch, (uint16_t) SwitchPath::Yield, _currentThread->getThreadId() );
+
+    #ifdef ZERO_SWITCH_BENCH
+        switchBenchStop( SwitchPath::Yield );
+    #endif
 
     // restore it's context
     SP = _currentThread->_sp;
@@ -698,25 +1533,91 @@ static void yield()
 }
 
 
+#ifdef ZERO_SWITCH_ON_WAKE
+
+// Hands control of the MCU to a Thread that signal() has just made more
+// deserving, while the current Thread stays in the ready list, keeping the
+// rest of its quantum. Called only by signal(), from Thread context.
+static void reschedule()
+{
+    // DND
+    cli();
+
+    // save current context for when we get to run again
+    saveInitialRegisters();
+    saveExtendedRegisters();
+    _currentThread->_sp = SP;
+
+    #ifdef ZERO_THREAD_STATS
+        _currentThread->_stats.involuntarySwitches++;
+    #endif
+
+    // track stack usage at switch point
+    _currentThread->_lowSp = MIN( _currentThread->_lowSp, _currentThread->_sp );
+
+    // check for stack overflow
+    if ( isStackOverflowed( *_currentThread ) ) {
+        callStackOverflowHandler();
+    }
+
+    // select the next thread to run
+    _currentThread = selectNextThread();
+    trace_event( TraceEvent::Switch, (uint16_t) SwitchPath::Preempt, _currentThread->getThreadId() );
+
+    // make sure it gets a full go
+    if ( !_currentThread->_ticksRemaining ) {
+        _currentThread->_ticksRemaining = _currentThread->_quantumTicks;
+    }
+
+    // restore it's context
+    SP = _currentThread->_sp;
+    restoreExtendedRegisters();
+    restoreInitialRegisters();
+    reti();
+}
+
+#endif
+
+
 /// @private
 /// @brief Millisecond timer and timeout controller
 ISR( TIMER0_COMPA_vect )
 {
-    _milliseconds++;
+    #ifdef ZERO_TICKLESS_IDLE
+        if ( _ticklessActive ) {
+            // a whole stretch has gone by, plus however long it took to get here
+            _ticklessActive = false;
+            accountTicks( OCR0A + 1 + TCNT0 );
+
+            // if waking the sleepers gave someone something to do, the
+            // heartbeat is needed again - otherwise stretch out once more
+            if ( _readyBitmap ) {
+                startHeartbeat();
+            }
+            else {
+                armTickless();
+            }
 
-    // check sleepers
-    if ( Thread* curSleeper = _timeoutList.getHead() ) {
-        if ( curSleeper->_timeoutOffset ) {
-            curSleeper->_timeoutOffset--;
+            #ifdef ZERO_DRIVERS_WDT
+                // once per stretch rather than per millisecond - the deadlines
+                // are measured against the clock, so a miss is still caught,
+                // just up to a stretch late
+                Watchdog::onTick();
+            #endif
+
+            return;
         }
+    #endif
 
-        while ( curSleeper and !curSleeper->_timeoutOffset ) {
-            _timeoutList.remove( *curSleeper );
-            curSleeper->signal( SIG_TIMEOUT );
+    _milliseconds++;
 
-            curSleeper = _timeoutList.getHead();
-        }
-    }
+    // check sleepers
+    wakeSleepers();
+
+    #ifdef ZERO_DRIVERS_WDT
+        // ... and the Watchdog participants with deadlines of their own
+        Watchdog::onTick();
+    #endif
 }
 
 
@@ -727,58 +1628,112 @@ ISR( TIMER0_COMPB_vect, ISR_NAKED )
     // save registers enough to do basic checking
     saveInitialRegisters();
 
+    #ifdef ZERO_SWITCH_BENCH
+        switchBenchStart();
+    #endif
+
     // let's figure out switching
     if ( _currentThread ) {
+        #ifdef ZERO_SWITCH_ON_WAKE
+            // an early tick asked for by signal() - put the regular tick
+            // back, and don't charge the Thread for the extra tick
+            const bool earlyTick{ _switchPending };
+
+            if ( earlyTick ) {
+                _switchPending = false;
+                OCR0B = OCR0A;
+            }
+        #else
+            const bool earlyTick{ false };
+        #endif
+
         // only subtract time if there's time to subtract
-        if ( _currentThread->_ticksRemaining ) {
+        if ( _currentThread->_ticksRemaining and !earlyTick ) {
             _currentThread->_ticksRemaining--;
         }
 
-        // faux priorities - if we're not the head of the active list, then
-        // a switch is required so that we run the current head instead
-        if ( _switchingEnabled and _currentThread != ACTIVE_LIST.getHead() ) {
-            _currentThread->_ticksRemaining = 0;
-        }
+        #ifdef ZERO_THREAD_STATS
+            if ( !earlyTick ) {
+                _currentThread->_stats.runTicks++;
+            }
+        #endif
 
-        // if the Thread has more time to run, or switching is disabled, bail
-        if ( _currentThread->_ticksRemaining or !_switchingEnabled ) {
+        // if switching is disabled, bail
+        if ( !_switchingEnabled ) {
             // strategic goto to save undue additional
             // expansion of inline restoreInitialRegisters()
             goto exit;
         }
 
+        // If we're not the Thread the scheduler would choose right now (either a
+        // signalled Thread was put at the head of the list, or a higher priority
+        // Thread became ready), then a switch is required so that it runs instead.
+        // If the Thread has more time to run and hasn't been displaced, bail.
+        if ( _currentThread->_ticksRemaining and _currentThread == peekNextThread() ) {
+            goto exit;
+        }
+
+        #ifdef ZERO_FAST_SWITCH
+            // The quantum is used up, but if nobody else at this level (or above) is
+            // ready to run, expiring the Thread would only swap the lists around and
+            // pick it straight back again - so just give it a fresh quantum instead.
+            if ( isOnlyReadyThread( *_currentThread ) ) {
+                _currentThread->_ticksRemaining = _currentThread->_quantumTicks;
+                goto exit;
+            }
+        #endif
+
         // we're switching, so we need to save the rest
         saveExtendedRegisters();
         _currentThread->_sp = SP;
 
+        #ifdef ZERO_THREAD_STATS
+            _currentThread->_stats.involuntarySwitches++;
+        #endif
+
         // track peak stack usage at switch point
         _currentThread->_lowSp = MIN( _currentThread->_lowSp, _currentThread->_sp );
 
-        if ( _currentThread->_lowSp < (uint16_t) _currentThread->_stackBottom ) {
+        if ( isStackOverflowed( *_currentThread ) ) {
             callStackOverflowHandler();
         }
 
-        // send it to the expired list
-        if ( _currentThread != _idleThread ) {
-            ACTIVE_LIST.remove( *_currentThread );
-            EXPIRED_LIST.append( *_currentThread );
+        // send it to the expired list if it used up its quantum - a displaced
+        // Thread keeps its place in the active list, and its remaining time
+        if ( _currentThread != _idleThread and !_currentThread->_ticksRemaining ) {
+            expireThread( *_currentThread );
         }
     }
 
     // choose the next thread
     _currentThread = selectNextThread();
+    trace_event( TraceEvent::Switch, (uint16_t) SwitchPath::Preempt, _currentThread->getThreadId() );
 
     // top up the Thread's quantum if it has none left
     if ( !_currentThread->_ticksRemaining ) {
-        _currentThread->_ticksRemaining = QUANTUM_TICKS;
+        _currentThread->_ticksRemaining = _currentThread->_quantumTicks;
     }
 
+    #ifdef ZERO_SWITCH_BENCH
+        switchBenchStop( SwitchPath::Preempt );
+    #endif
+
     // bring the new thread online
     SP = _currentThread->_sp;
     restoreExtendedRegisters();
 
+    #ifdef ZERO_SWITCH_BENCH
+        // don't count a pre-emption as a tick as well
+        goto done;
+    #endif
+
 exit:
 
+    #ifdef ZERO_SWITCH_BENCH
+        switchBenchStop( SwitchPath::Tick );
+    done:
+    #endif
+
     restoreInitialRegisters();
     reti();
 }
@@ -789,7 +1744,7 @@ bool Thread::tryAllocateSignal( const uint16_t signalNumber )
 {
     if ( signalNumber >= SIGNAL_BITS ) return false;
 
-    const SignalBitField m{ 1U << signalNumber };
+    const SignalBitField m{ (SignalBitField) 1 << signalNumber };
 
     if ( !( _allocatedSignals & m ) ) {
         _allocatedSignals |= m;
@@ -809,14 +1764,14 @@ SignalBitField Thread::allocateSignal( const uint16_t reqdSignalNumber )
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
         if ( reqdSignalNumber < SIGNAL_BITS ) {
             if ( tryAllocateSignal( reqdSignalNumber ) ) {
-                return 1U << reqdSignalNumber;
+                return (SignalBitField) 1 << reqdSignalNumber;
             }
         }
         else {
             // start checking after the reserved signals, for speed
             for ( auto i = NUM_RESERVED_SIGS; i < SIGNAL_BITS; i++ ) {
                 if ( tryAllocateSignal( i ) ) {
-                    return 1U << i;
+                    return (SignalBitField) 1 << i;
                 }
             }
         }
@@ -890,6 +1845,70 @@ SignalBitField Thread::clearSignals( const SignalBitField sigs )
 }
 
 
+/// @brief Gets the number of microseconds since the MCU started
+/// @returns The number of microseconds since the last reset event.
+/// @note The resolution is one Timer0 tick (16us at 16MHz, or 64us while the idle Thread
+/// is running tickless).
+/// @note Wraps around after approximately 71 continuous minutes, so only use it to
+/// measure intervals, by subtracting one reading from another.
+/// @note May be called from within an ISR.
+uint32_t Thread::nowMicros()
+{
+    uint32_t ms;
+    uint32_t cycles;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        ms = _milliseconds;
+        const uint8_t ticks{ TCNT0 };
+
+        // the counter may have wrapped without the ISR having run yet, in
+        // which case the count is small, but the millisecond hasn't been added
+        const bool pending{ ( TIFR0 & ( 1 << OCF0A ) ) and ticks < ( OCR0A / 2 ) };
+
+        #ifdef ZERO_TICKLESS_IDLE
+            // the part of a millisecond that the clock hasn't caught up with yet
+            cycles = _ticklessCarry;
+
+            if ( _ticklessActive ) {
+                cycles += ( pending ? ( OCR0A + 1UL ) + ticks : ticks ) * 1024UL;
+            }
+            else {
+                cycles += ticks * 256UL;
+                ms += pending;
+            }
+        #else
+            cycles = ticks * 256UL;
+            ms += pending;
+        #endif
+    }
+
+    return ( ms * 1000UL ) + ( cycles / F_CPU_MHZ );
+}
+
+
+/// @brief Sleeps the Thread for a given number of microseconds
+/// @details Whole milliseconds are slept through, as per delay( Duration ), and the
+/// rest is spun out on nowMicros(), with interrupts and context switching left on.
+/// @param dur MicroDuration specifying how long the Thread should sleep.
+/// @note The Thread may be pre-empted during the final spin, so this is a minimum,
+/// not an exact, delay.
+void Thread::delay( const MicroDuration dur )
+{
+    const uint32_t us{ (uint32_t) dur };
+    const uint32_t start{ nowMicros() };
+
+    // a sleep of n ticks can end up to a tick early, so leave
+    // at least a millisecond for the spin
+    if ( us >= 2000UL ) {
+        delay( Duration{ ( us / 1000UL ) - 1 } );
+    }
+
+    while ( nowMicros() - start < us ) {
+        // spin
+    }
+}
+
+
 /// @brief Sleeps the Thread for a given number of milliseconds
 /// @param dur Duration specifying how long the Thread should sleep.
 /// @see wait()
@@ -949,6 +1968,8 @@ SignalBitField Thread::wait( const SignalBitField sigs, const Duration timeout )
 
         // if there aren't any, block to wait for them
         if ( !rc ) {
+            trace_event( TraceEvent::Wait, _waitingSignals, _id );
+
             // this will block until at least one signal is
             // received that we are waiting for. Execution
             // will resume immediately following the yield()
@@ -981,8 +2002,21 @@ SignalBitField Thread::wait( const SignalBitField sigs, const Duration timeout )
 /// @brief Sends signals to a Thread, potentially waking it up
 /// @param sigs The signals to send to the Thread.
 /// @note Signalling a Thread may be done from within an ISR.
+/// @note With `SWITCH_ON_WAKE` enabled in the `makefile`, a woken Thread that deserves
+/// to run more than the current Thread runs straight away when signalled from a Thread,
+/// or within a couple of Timer0 ticks (tens of microseconds) when signalled from an ISR.
 void Thread::signal( const SignalBitField sigs )
 {
+    #ifdef ZERO_SWITCH_ON_WAKE
+        // If interrupts are on, we're being called from a Thread and can hand
+        // over the MCU straight away. If they're off, we're (most likely) in an
+        // ISR, and the switch has to wait until interrupts are back on.
+        const bool fromThread{ !!( SREG & ( 1 << SREG_I ) ) };
+        bool switchNow{ false };
+    #endif
+
+    trace_event( TraceEvent::Signal, sigs, _id );
+
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
         const bool alreadySignalled{ getActiveSignals() };
 
@@ -996,17 +2030,42 @@ void Thread::signal( const SignalBitField sigs )
         {
             // ... then move it to the active list ready to run
 
+            #ifdef ZERO_TICKLESS_IDLE
+                // the idle Thread is about to have company
+                if ( _ticklessActive ) {
+                    exitTickless();
+                }
+            #endif
+
             // if it's on the timeout list, take it off
             if ( _timeoutOffset ) {
                 _timeoutList.remove( *this );
                 this->_timeoutOffset = 0UL;
             }
 
-            // put it at the top of the active list, ready to go
-            ACTIVE_LIST.remove( *this );
-            ACTIVE_LIST.prepend( *this );
+            // put it at the top of its active list, ready to go
+            removeReady( *this );
+            prependReady( *this );
+
+            #ifdef ZERO_SWITCH_ON_WAKE
+                // only switch if the woken Thread is now the one that deserves to run
+                if ( _currentThread and _switchingEnabled and _currentThread != peekNextThread() ) {
+                    if ( fromThread ) {
+                        switchNow = true;
+                    }
+                    else {
+                        requestEarlySwitch();
+                    }
+                }
+            #endif
         }
     }
+
+    #ifdef ZERO_SWITCH_ON_WAKE
+        if ( switchNow ) {
+            reschedule();
+        }
+    #endif
 }
 
 
@@ -1069,12 +2128,40 @@ static void CTOR preMain()
         }
     }
     else {
+        #ifdef ZERO_ISR_POOL
+            // set aside the ISR buffers before anything else takes the heap
+            memory::initIsrPool();
+        #endif
+
+        #ifdef ZERO_BLOCK_POOLS
+            // ... and the blocks for small objects
+            memory::initBlockPools();
+        #endif
+
         // create the system Threads
         _idleThread = new Thread{ PSTR( "idle" ), 0, idleThreadEntry, TF_NONE };
         createPoolThreads();
 
+        #ifdef ZERO_DEFERRED_WORK
+            deferred::init();
+        #endif
+
+        #ifdef ZERO_SOFT_TIMERS
+            Timer::init();
+        #endif
+
+        #ifdef ZERO_DRIVERS_GPIO
+            // start draining the debug ring, if it's buffered
+            debug::startDrain();
+        #endif
+
         // claim the main timer before anyone else does
         resource::obtain( resource::ResourceId::Timer0 );
+
+        #ifdef ZERO_SWITCH_BENCH
+            // ... and the benchmark's stopwatch
+            resource::obtain( resource::ResourceId::Timer1 );
+        #endif
     }
 
     // main() will now run, where the developer will set up the system, including
@@ -1089,6 +2176,10 @@ static void DTOR postMain()
     // start Timer0 (does not enable global ints)
     initTimer0();
 
+    #ifdef ZERO_SWITCH_BENCH
+        initSwitchBench();
+    #endif
+
     // Go!
     yield();
 }
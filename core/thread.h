@@ -19,6 +19,10 @@ namespace zero {
 
     typedef int ( *ThreadEntry )();
 
+    /// @brief The entry function of a job submitted to the Thread pool
+    /// @param arg The argument given to Thread::submit().
+    typedef int ( *JobEntry )( void* const arg );
+
     enum class ThreadStatus {
         /// Ready to run
         Ready = 0,
@@ -34,8 +38,60 @@ namespace zero {
     };
 
 
+    /// @brief Scheduling statistics for a Thread
+    /// @note Only available when `THREAD_STATS` is enabled in the `makefile`.
+    struct ThreadStats {
+        /// Number of times the Thread gave up the MCU by waiting or sleeping
+        uint32_t voluntarySwitches;
+
+        /// Number of times the Thread was pre-empted
+        uint32_t involuntarySwitches;
+
+        /// Number of 1ms ticks during which the Thread was running
+        uint32_t runTicks;
+    };
+
+
+    /// @brief The context switch paths measured by the switch benchmark
+    /// @note Only available when `SWITCH_BENCH` is enabled in the `makefile`.
+    enum class SwitchPath : uint8_t {
+        /// A Thread giving up the MCU, in `yield()`
+        Yield = 0,
+
+        /// A `TIMER0_COMPB_vect` tick that didn't switch Threads
+        Tick,
+
+        /// A `TIMER0_COMPB_vect` tick that pre-empted the running Thread
+        Preempt,
+    };
+
+
+    /// @brief Cycle counts for one context switch path
+    /// @note The cycles spent in saving and restoring the first few registers (which
+    /// is a fixed cost), and in `reti`, are not included.
+    /// @note Only available when `SWITCH_BENCH` is enabled in the `makefile`.
+    struct SwitchBench {
+        /// Number of times the path was taken
+        uint32_t count;
+
+        /// Total CPU cycles spent in the path
+        uint32_t totalCycles;
+
+        /// Fewest CPU cycles spent in the path
+        uint16_t minCycles;
+
+        /// Most CPU cycles spent in the path
+        uint16_t maxCycles;
+    };
+
+
     /// A bit field representing one or more signals.
-    typedef uint16_t SignalBitField;
+    /// @note 16 bits wide, or 32 with `WIDE_SIGNALS` in the `makefile`.
+    #ifdef ZERO_WIDE_SIGNALS
+        typedef uint32_t SignalBitField;
+    #else
+        typedef uint16_t SignalBitField;
+    #endif
 
     /// The flags controlling a Thread's behavior.
     typedef uint16_t ThreadFlags;
@@ -50,6 +106,19 @@ namespace zero {
     const ThreadFlags TF_POOL_THREAD{ 1 << 1 };
 
 
+    /// The scheduling priority of a Thread. Higher numbers run first.
+    typedef uint8_t ThreadPriority;
+
+    /// The lowest priority a Thread can have (idle runs below even this)
+    const ThreadPriority TP_LOWEST{ 0 };
+
+    /// The highest priority a Thread can have
+    const ThreadPriority TP_HIGHEST{ PRIORITY_LEVELS - 1 };
+
+    /// The priority given to new Threads
+    const ThreadPriority TP_DEFAULT{ ( PRIORITY_LEVELS - 1 ) / 2 };
+
+
     /// @private
     /// reserved signals
     const auto NUM_RESERVED_SIGS = 3;
@@ -71,6 +140,10 @@ namespace zero {
     // forward decl because chicken/egg
     class Thread;
 
+    /// @brief Callback function for visiting each Thread in the system
+    /// @param t The Thread being visited.
+    typedef void ( *ThreadVisitor )( Thread& t );
+
 
     /// @brief Used to provide signalling services to Threads
     class Synapse {
@@ -95,16 +168,36 @@ namespace zero {
         // meta
         static Thread& getCurrent();                    // Returns the current Thread
         static uint32_t now();                          // Elapsed milliseconds since boot
+        static uint32_t nowMicros();                    // Elapsed microseconds since boot (wraps)
 
         static void forbid();                           // Disable context switching
         static void permit();                           // Enable context switching
         static bool isSwitchingEnabled();               // Determines if switching is on
 
+        #ifdef ZERO_SWITCH_BENCH
+            static SwitchBench getSwitchBench( const SwitchPath path );  // cycle counts for a switch path
+            static void resetSwitchBench();             // starts the cycle counts again
+        #endif
+
+        #ifdef ZERO_THREAD_STATS
+            static uint32_t getIdleTicks();             // Number of 1ms ticks spent in the idle Thread
+            static void forEach( const ThreadVisitor v );   // Calls v for every Thread in the system
+        #endif
+
         static Thread* fromPool(
             const char* const name,                     // name of the Thread (pointer to Flash, not SRAM)
             const ThreadEntry entry,                    // the Thread's entry function
             const Synapse* const termSyn = nullptr,     // Synapse to signal when Thread terminates
             int* const exitCode = nullptr );            // Place to put Thread's return code
+
+        #ifdef ZERO_JOB_QUEUE
+            static bool submit(
+                const char* const name,                 // name of the job (pointer to Flash, not SRAM)
+                const JobEntry entry,                   // the job's entry function
+                void* const arg = nullptr,              // argument to pass to the entry function
+                const Synapse* const termSyn = nullptr, // Synapse to signal when the job completes
+                int* const exitCode = nullptr );        // Place to put the job's return code
+        #endif
         
         // ctor
         Thread(
@@ -127,6 +220,22 @@ namespace zero {
         void stop();                                    // stops the Thread
         ThreadStatus getStatus() const;                 // gets the Thread's status
 
+        // Scheduling
+        ThreadPriority getPriority() const;             // gets the Thread's priority
+        void setPriority( const ThreadPriority p );     // sets the Thread's priority
+        uint8_t getQuantum() const;                     // gets the Thread's time slice, in ms ticks
+        void setQuantum( const uint8_t ticks );         // sets the Thread's time slice, in ms ticks
+
+        #ifdef ZERO_THREAD_STATS
+            ThreadStats getStats() const;               // gets the Thread's scheduling statistics
+        #endif
+
+        #if TLS_SLOTS > 0
+            // Thread-local storage
+            void* getLocal( const uint8_t slot ) const; // gets a Thread-local pointer
+            void setLocal( const uint8_t slot, void* const value );  // sets a Thread-local pointer
+        #endif
+
         // Stack information
         uint16_t getStackSizeBytes() const;
         uint16_t getStackPeakUsageBytes() const;
@@ -136,6 +245,7 @@ namespace zero {
         SignalBitField clearSignals( const SignalBitField sigs );
 
         void delay( const Duration dur );
+        void delay( const MicroDuration dur );
         SignalBitField wait( const SignalBitField sigs, const Duration timeout = 0_ms );
         void signal( const SignalBitField sigs );
 
@@ -149,11 +259,22 @@ namespace zero {
         uint8_t* const _stackBottom;
 
         uint8_t _ticksRemaining;
+        uint8_t _quantumTicks{ QUANTUM_TICKS };
         uint32_t _timeoutOffset;
+        ThreadPriority _priority{ TP_DEFAULT };
 
         Thread* _prev;
         Thread* _next;
 
+        #ifdef ZERO_THREAD_STATS
+            ThreadStats _stats{ 0UL, 0UL, 0UL };
+            Thread* _nextInRegistry{ nullptr };
+        #endif
+
+        #if TLS_SLOTS > 0
+            void* _locals[ TLS_SLOTS ];
+        #endif
+
     private:
         friend class Synapse;
 
@@ -167,6 +288,11 @@ namespace zero {
             const Synapse* const notifySyn,
             int* const exitCode );
 
+        #ifdef ZERO_JOB_QUEUE
+            static int runJobs();
+            static void startJobRunner();
+        #endif
+
         void reanimate(
             const char* const newName,                      // name of Thread, points to Flash memory
             const ThreadEntry newEntry,                     // the Thread's entry function
@@ -0,0 +1,213 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_SOFT_TIMERS
+
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "timer.h"
+#include "thread.h"
+#include "debug.h"
+#include "list.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    // globals
+    OffsetList<Timer> _timerList;                       // running Timers, in expiry order
+    uint32_t _timerEpoch{ 0UL };                        // the time the head Timer's offset is relative to
+    const Synapse* _timersChangedSyn{ nullptr };        // wakes the service Thread when the list changes
+
+}    // namespace
+
+
+/// @brief Creates a new Timer that calls a function when it expires
+/// @param cb The function to call. It runs on the timer service Thread, so should be
+/// short and never block for long - every other Timer waits for it.
+Timer::Timer( const TimerCallback cb )
+:
+    _callback{ cb }
+{
+    // empty
+}
+
+
+/// @brief Creates a new Timer that signals a Synapse when it expires
+/// @param syn The Synapse to signal.
+Timer::Timer( const Synapse& syn )
+:
+    _synapse{ &syn }
+{
+    // empty
+}
+
+
+// dtor
+Timer::~Timer()
+{
+    stop();
+}
+
+
+/// @brief Starts (or restarts) the Timer
+/// @param interval How long until the Timer expires.
+/// @param periodic Optional. Default: `false`. If `true`, the Timer keeps expiring every
+/// `interval` until it is stopped, without drifting.
+/// @returns `true` if the Timer was started, `false` otherwise.
+bool Timer::start( const Duration interval, const bool periodic )
+{
+    if ( !(uint32_t) interval ) {
+        return false;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _running ) {
+            _timerList.remove( *this );
+        }
+
+        const uint32_t now{ Thread::now() };
+
+        // with nothing running, the epoch can be brought up to date
+        if ( !_timerList.getHead() ) {
+            _timerEpoch = now;
+        }
+
+        _interval = (uint32_t) interval;
+        _periodic = periodic;
+        _running = true;
+
+        _timerList.insertByOffset( *this, ( now - _timerEpoch ) + _interval );
+    }
+
+    // let the service Thread rethink how long to sleep for
+    if ( _timersChangedSyn ) {
+        _timersChangedSyn->signal();
+    }
+
+    return true;
+}
+
+
+/// @brief Stops the Timer
+/// @note A Timer that is stopped after it has expired, but before its callback has
+/// run, will still have its callback called.
+void Timer::stop()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _running ) {
+            _timerList.remove( *this );
+            _timeoutOffset = 0UL;
+            _running = false;
+        }
+    }
+}
+
+
+/// @brief Determines if the Timer is running
+/// @returns `true` if the Timer is running, `false` otherwise.
+bool Timer::isRunning() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _running;
+    }
+}
+
+
+/// @private
+/// @brief Creates the timer service Thread
+void Timer::init()
+{
+    Thread* const t{ new Thread{ PSTR( "timers" ), TIMER_THREAD_STACK_BYTES, serviceEntry } };
+    dbg_assert( t, "Timer thread init fail" );
+
+    // Timers are expected to be on time
+    if ( t ) {
+        t->setPriority( TP_HIGHEST );
+    }
+}
+
+
+// The timer service Thread. Sleeps until the next Timer expires (or the
+// list of Timers changes), then runs everything that is due.
+int Timer::serviceEntry()
+{
+    Synapse changed;
+    _timersChangedSyn = &changed;
+
+    while ( true ) {
+        uint32_t sleepMs;
+
+        if ( Timer* const t = popExpired( sleepMs ) ) {
+            t->fire();
+            continue;
+        }
+
+        // no timeout means until something changes
+        changed.wait( Duration{ sleepMs } );
+    }
+}
+
+
+// Takes the next expired Timer off the list, re-arming it if it's periodic.
+// If nothing has expired, sleepMs is set to how long until the next Timer is
+// due (never 0), or to 0 if there are no Timers at all - worked out under the
+// same lock as the due check, so the two can't disagree.
+Timer* Timer::popExpired( uint32_t& sleepMs )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        Timer* const head{ _timerList.getHead() };
+        sleepMs = 0UL;
+
+        if ( !head ) {
+            return nullptr;
+        }
+
+        const uint32_t elapsed{ Thread::now() - _timerEpoch };
+
+        if ( head->_timeoutOffset > elapsed ) {
+            sleepMs = head->_timeoutOffset - elapsed;
+            return nullptr;
+        }
+
+        // the epoch moves up to when this Timer was due, which is
+        // what the next Timer's offset is relative to
+        _timerEpoch += head->_timeoutOffset;
+        head->_timeoutOffset = 0UL;
+        _timerList.remove( *head );
+
+        if ( head->_periodic ) {
+            _timerList.insertByOffset( *head, head->_interval );
+        }
+        else {
+            head->_running = false;
+        }
+
+        return head;
+    }
+}
+
+
+// Lets the world know the Timer expired
+void Timer::fire()
+{
+    if ( _synapse ) {
+        _synapse->signal();
+    }
+
+    if ( _callback ) {
+        _callback( *this );
+    }
+}
+
+
+#endif
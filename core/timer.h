@@ -0,0 +1,51 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_TIMER_H
+#define TCRI_ZERO_TIMER_H
+
+
+#ifdef ZERO_SOFT_TIMERS
+
+
+#include <stdint.h>
+#include "thread.h"
+#include "time.h"
+
+
+namespace zero {
+
+    // forward decl because chicken/egg
+    class Timer;
+
+    /// @brief Callback function for Timer expiry
+    /// @param t The Timer that expired.
+    typedef void ( *TimerCallback )( Timer& t );
+
+    /// @brief Lightweight software timer, run from the kernel's timer service Thread
+    class Timer {
+    public:
+        Timer( const TimerCallback cb );                // calls cb when the Timer expires
+        Timer( const Synapse& syn );                    // signals syn when the Timer expires
+
+        bool start(
+            const Duration interval,                    // how long until the Timer expires
+            const bool periodic = false );              // keep going, every interval?
+
+        void stop();                                    // stops the Timer, if it's running
+        bool isRunning() const;                         // determines if the Timer is running
+
+        #include "timer_private.h"
+    };
+
+}    // namespace zero
+
+
+#endif
+
+#endif
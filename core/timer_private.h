@@ -0,0 +1,31 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    ~Timer();
+
+    static void init();
+
+    Timer* _prev{ nullptr };
+    Timer* _next{ nullptr };
+    uint32_t _timeoutOffset{ 0UL };
+
+private:
+    Timer( const Timer& t ) = delete;
+    void operator=( const Timer& t ) = delete;
+
+    static int serviceEntry();
+    static Timer* popExpired( uint32_t& sleepMs );
+    void fire();
+
+    const TimerCallback _callback{ nullptr };
+    const Synapse* const _synapse{ nullptr };
+    uint32_t _interval{ 0UL };
+    bool _periodic{ false };
+    bool _running{ false };
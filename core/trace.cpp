@@ -0,0 +1,157 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_TRACE
+
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "trace.h"
+#include "thread.h"
+#include "debug.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    static_assert( TRACE_EVENTS >= 2 and TRACE_EVENTS <= 256 and
+        !( TRACE_EVENTS & ( TRACE_EVENTS - 1 ) ),
+        "TRACE_EVENTS must be a power of 2, from 2 to 256" );
+
+    const uint8_t TRACE_MASK{ TRACE_EVENTS - 1 };
+
+    // globals
+    TraceRecord _records[ TRACE_EVENTS ];               // the circular buffer of events
+    uint8_t _head{ 0 };                                 // where the next event goes
+    uint16_t _numRecords{ 0 };                          // how many of the records are valid
+    uint16_t _lostRecords{ 0 };                         // how many were overwritten (saturates)
+    uint16_t _currentId{ 0 };                           // the running Thread, as of the last Switch event
+    bool _paused{ false };                              // set while dumping
+
+
+    // Sends dump data out of the debug pin, when no other writer was given
+    void debugWriter( const void* const data, const uint16_t numBytes )
+    {
+        debug::writeBlocking( data, numBytes );
+    }
+
+}    // namespace
+
+
+/// @brief Records an event in the trace buffer
+/// @param event The kind of event.
+/// @param payload Optional. Default: `0`. Event-specific data.
+/// @param subject Optional. Default: `TRACE_CURRENT`. The ID of the Thread the event
+/// concerns.
+/// @note May be called from within an ISR. Events are not recorded during a dump().
+void trace::record( const TraceEvent event, const uint16_t payload, const uint16_t subject )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _paused ) {
+            return;
+        }
+
+        // context switches tell us who's running, so no need to ask the scheduler
+        if ( event == TraceEvent::Switch ) {
+            _currentId = subject;
+        }
+
+        TraceRecord& r{ _records[ _head ] };
+
+        r.ms = (uint16_t) Thread::now();
+        r.ticks = TCNT0;
+        r.event = (uint8_t) event;
+        r.subject = ( subject == TRACE_CURRENT ) ? _currentId : subject;
+        r.payload = payload;
+
+        _head = ( _head + 1 ) & TRACE_MASK;
+
+        if ( _numRecords < TRACE_EVENTS ) {
+            _numRecords++;
+        }
+        else if ( _lostRecords < 0xFFFF ) {
+            _lostRecords++;
+        }
+    }
+}
+
+
+/// @brief Copies the recorded events out of the trace buffer
+/// @param records The place to put the events, oldest first.
+/// @param maxRecords The most events to copy.
+/// @returns The number of events copied. The newest events are the ones left out if
+/// `maxRecords` is too small to hold them all.
+uint16_t trace::copy( TraceRecord* const records, const uint16_t maxRecords )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        const uint16_t rc{ ( _numRecords < maxRecords ) ? _numRecords : maxRecords };
+        uint8_t index{ (uint8_t) ( ( _head - _numRecords ) & TRACE_MASK ) };
+
+        for ( uint16_t i = 0; i < rc; i++ ) {
+            records[ i ] = _records[ index ];
+            index = ( index + 1 ) & TRACE_MASK;
+        }
+
+        return rc;
+    }
+}
+
+
+/// @brief Sends a TraceHeader followed by every recorded event, oldest first
+/// @param out Optional. Default: `nullptr`. The function to send the dump through. If
+/// `nullptr`, the dump is sent out of the debug pin, blocking.
+/// @note Recording is paused until the dump is complete, but interrupts and context
+/// switching carry on as normal in between writes.
+void trace::dump( const TraceWriter out )
+{
+    const TraceWriter writer{ out ? out : debugWriter };
+    TraceHeader header;
+    uint8_t index;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _paused = true;
+
+        header = TraceHeader{ { 'Z', 'T' }, 1, F_CPU_MHZ, _numRecords, _lostRecords };
+        index = ( _head - _numRecords ) & TRACE_MASK;
+    }
+
+    writer( &header, sizeof( header ) );
+
+    // nothing moves while paused, so the records can be sent straight from
+    // the buffer - in (at most) two runs around the end of it
+    const uint16_t firstRun{ ( header.numRecords < (uint16_t) ( TRACE_EVENTS - index ) ) ?
+        header.numRecords : (uint16_t) ( TRACE_EVENTS - index ) };
+
+    if ( firstRun ) {
+        writer( &_records[ index ], firstRun * sizeof( TraceRecord ) );
+    }
+
+    if ( header.numRecords > firstRun ) {
+        writer( &_records[ 0 ], ( header.numRecords - firstRun ) * sizeof( TraceRecord ) );
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _paused = false;
+    }
+}
+
+
+/// @brief Discards every event in the trace buffer, and the count of lost events
+void trace::clear()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _numRecords = 0;
+        _lostRecords = 0;
+    }
+}
+
+
+#endif
@@ -0,0 +1,164 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_TRACE_H
+#define TCRI_ZERO_TRACE_H
+
+
+#include <stdint.h>
+
+
+#ifdef ZERO_TRACE
+
+
+namespace zero {
+
+    /// @brief The kinds of event recorded in the trace buffer
+    /// @note Your own events may be recorded too, using IDs from `User` upwards.
+    enum class TraceEvent : uint8_t {
+        /// A context switch. Subject: the Thread switched to. Payload: the `SwitchPath`.
+        Switch = 1,
+
+        /// A Thread was signalled. Subject: the signalled Thread. Payload: the signals (the
+        /// low 16, with `WIDE_SIGNALS`).
+        Signal,
+
+        /// A Thread blocked in `wait()`. Subject: the Thread. Payload: the signals it waits on
+        /// (the low 16, with `WIDE_SIGNALS`).
+        Wait,
+
+        /// An ISR started. Payload: the interrupt vector number (for example, `ADC_vect_num`).
+        IsrEnter,
+
+        /// An ISR finished. Payload: the interrupt vector number.
+        IsrExit,
+
+        /// Memory was allocated. Payload: the number of bytes allocated.
+        Allocate,
+
+        /// An allocation failed. Payload: the number of bytes asked for.
+        AllocateFail,
+
+        /// Memory was freed. Payload: the number of bytes freed.
+        Free,
+
+        /// A Pipe was full when written to. Payload: the Pipe's address.
+        PipeFull,
+
+        /// A Pipe was empty when read from. Payload: the Pipe's address.
+        PipeEmpty,
+
+        /// The first ID available for your own events
+        User = 0x80,
+    };
+
+
+    /// @brief One event in the trace buffer, exactly as dumped
+    /// @details The time of the event is `ms` milliseconds since boot (the low 16 bits of
+    /// `Thread::now()`), plus `ticks` counts of Timer0, each of which is 256 CPU cycles.
+    struct TraceRecord {
+        /// Low 16 bits of the millisecond counter
+        uint16_t ms;
+
+        /// Timer0 count within the millisecond
+        uint8_t ticks;
+
+        /// The `TraceEvent`
+        uint8_t event;
+
+        /// The ID of the Thread the event concerns (`0` before the first Thread runs)
+        uint16_t subject;
+
+        /// Event-specific data
+        uint16_t payload;
+    };
+
+
+    /// @brief Leads a trace dump, so that a host can find the start and decode the rest
+    struct TraceHeader {
+        /// Always `'Z'`, `'T'`
+        uint8_t magic[ 2 ];
+
+        /// The dump format version (currently `1`)
+        uint8_t version;
+
+        /// The CPU clock, in MHz, for converting `TraceRecord::ticks` to time
+        uint8_t cpuMhz;
+
+        /// The number of TraceRecords that follow, oldest first
+        uint16_t numRecords;
+
+        /// The number of older records overwritten since the buffer was last cleared
+        uint16_t lostRecords;
+    };
+
+
+    /// @brief Used as the subject of an event, to mean whichever Thread is running
+    const uint16_t TRACE_CURRENT{ 0xFFFF };
+
+
+    /// @brief Something to send a trace dump to, for example a `UsartTx`
+    /// @param data The bytes to send.
+    /// @param numBytes The number of bytes to send.
+    /// @note The data may be reused as soon as this returns, so it must block until the
+    /// bytes have been sent (or copied somewhere else).
+    typedef void ( *TraceWriter )( const void* const data, const uint16_t numBytes );
+
+
+    /// @brief Records compact binary kernel events for decoding on a host
+    /// @details Events go into a circular buffer in SRAM (`TRACE_EVENTS` in the `makefile`),
+    /// overwriting the oldest when it fills. Recording an event costs a few microseconds
+    /// with interrupts off, rather than the milliseconds a line of debug text takes, so
+    /// the trace shows scheduling as it really happens.
+    /// @note Only available when `TRACE` is enabled in the `makefile`. Use the `trace_event()`
+    /// and `trace_isr()` macros, which disappear when it isn't.
+
+    namespace trace {
+        void record(
+            const TraceEvent event,
+            const uint16_t payload = 0,
+            const uint16_t subject = TRACE_CURRENT );
+
+        uint16_t copy( TraceRecord* const records, const uint16_t maxRecords );
+        void dump( const TraceWriter out = nullptr );
+        void clear();
+
+
+        /// @brief Records the entry to, and exit from, the ISR it's declared in
+        /// @note Use the `trace_isr()` macro rather than declaring one directly.
+        class IsrScope {
+        public:
+            explicit IsrScope( const uint8_t vectorNum ) : _vectorNum{ vectorNum }
+            {
+                record( TraceEvent::IsrEnter, _vectorNum );
+            }
+
+            ~IsrScope()
+            {
+                record( TraceEvent::IsrExit, _vectorNum );
+            }
+
+        private:
+            const uint8_t _vectorNum;
+        };
+    }
+
+}    // namespace zero
+
+#define trace_event( ... ) zero::trace::record( __VA_ARGS__ )
+#define trace_isr( n ) zero::trace::IsrScope __traceIsrScope{ (uint8_t) ( n ) }
+
+#else
+
+#define trace_event( ... ) ;
+#define trace_isr( n ) ;
+
+#endif
+
+
+#endif
@@ -10,10 +10,13 @@
 
 
 #include <avr/interrupt.h>
+#include <avr/power.h>
 #include <util/atomic.h>
 
 #include "adc.h"
 #include "resource.h"
+#include "util.h"
+#include "trace.h"
 
 
 using namespace zero;
@@ -48,6 +51,10 @@ Adc::~Adc()
 {
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
         if ( _currentAdc == this ) {
+            #ifdef ZERO_ADC_SCAN
+                endScan();
+            #endif
+
             disable();
             _readySyn.clearSignals();
             resource::release( resource::ResourceId::Adc );
@@ -84,15 +91,31 @@ void Adc::disable()
 
 /// @brief Begins an ADC conversion on a given channel
 /// @param channel The channel number to sample.
-void Adc::beginConversion( const uint8_t channel )
+/// @param oversampleBits Optional. Default: `0`. Takes `4^n` conversions for the reading,
+/// back to back, and combines them in the ISR - the Synapse is only signalled once, when
+/// the reading is ready. From `0` (a single conversion) to `6` (4096 conversions).
+/// @param decimation Optional. Default: `AdcDecimation::Oversample`. How the conversions
+/// are combined - for `10 + n` bits of resolution, or for a 10-bit average.
+/// @note Does nothing while a scan is running.
+void Adc::beginConversion(
+    const uint8_t channel,
+    const uint8_t oversampleBits,
+    const AdcDecimation decimation )
 {
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        #ifdef ZERO_ADC_SCAN
+            if ( _numScanChannels ) {
+                return;
+            }
+        #endif
+
         // wait for previous conversion to  finish
         while ( ADCSRA & ( 1 << ADSC ) )
             ;
 
         // we're no longer ready
         _readySyn.clearSignals();
+        setOversampling( oversampleBits, decimation );
 
         // select the correct pin
         ADMUX = ( ADMUX & 0b11111000 ) | ( channel & 0b111 );
@@ -113,7 +136,8 @@ void Adc::setLastConversion( const uint16_t v )
 
 
 /// @brief Gets the value of the last conversion
-/// @returns A `uint16_t` that holds the 10-bit value of the last conversion.
+/// @returns A `uint16_t` that holds the value of the last conversion - 10 bits, or
+/// `10 + n` bits when oversampled with `AdcDecimation::Oversample`.
 uint16_t Adc::getLastConversion() const
 {
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
@@ -122,12 +146,263 @@ uint16_t Adc::getLastConversion() const
 }
 
 
+// Adds a conversion to the accumulator - called from the ISR
+bool Adc::accumulate( const uint16_t v, uint16_t& reading )
+{
+    _accumulator += v;
+
+    if ( --_conversionsLeft ) {
+        return false;
+    }
+
+    reading = (uint16_t) ( _accumulator >> _shift );
+
+    _accumulator = 0;
+    _conversionsLeft = _conversionsPerReading;
+
+    return true;
+}
+
+
+// Sets up the accumulator for a new run of conversions
+void Adc::setOversampling( const uint8_t oversampleBits, const AdcDecimation decimation )
+{
+    const uint8_t bits{ MIN( oversampleBits, (uint8_t) 6 ) };
+
+    _accumulator = 0;
+    _conversionsPerReading = 1 << ( bits * 2 );
+    _conversionsLeft = _conversionsPerReading;
+    _shift = ( decimation == AdcDecimation::Average ) ? bits * 2 : bits;
+}
+
+
+#ifdef ZERO_ADC_SCAN
+
+/// @brief Starts converting a list of channels, one after another, on a Timer1 trigger
+/// @param channels The channels to convert, in order. The list is copied.
+/// @param numChannels The number of channels in the list, from 1 to 8.
+/// @param conversionsPerSec The number of conversions per second, across all channels -
+/// each channel is converted `conversionsPerSec / numChannels` times a second. At 16MHz,
+/// the ADC can manage a little over 9,000.
+/// @param watermark Optional. Default: `ADC_SCAN_SAMPLES / 2`. The Synapse given to the
+/// constructor is signalled when this many samples are waiting to be read.
+/// @param oversampleBits Optional. Default: `0`. Converts each channel `4^n` times in a
+/// row (one conversion per trigger) and combines them in the ISR, so only one sample per
+/// `4^n` conversions reaches the ring. From `0` to `6`.
+/// @param decimation Optional. Default: `AdcDecimation::Oversample`. How the conversions
+/// are combined into a sample.
+/// @returns `true` if the scan started, `false` if Timer1 is in use, a scan is already
+/// running, or the arguments are out of range.
+/// @details Conversions are started by the Timer1 hardware, not by software, so the
+/// sample rate doesn't jitter with Thread scheduling. The ADC ISR stores each sample in
+/// a ring (`ADC_SCAN_SAMPLES` in the `makefile`) and moves on to the next channel; no
+/// Thread runs until the watermark is reached. Samples arriving while the ring is full
+/// are dropped and counted.
+/// @note Enables the ADC, if it isn't already.
+bool Adc::beginScan(
+    const uint8_t* const channels,
+    const uint8_t numChannels,
+    const uint16_t conversionsPerSec,
+    const uint16_t watermark,
+    const uint8_t oversampleBits,
+    const AdcDecimation decimation )
+{
+    if ( !*this or !channels or !numChannels or numChannels > 8 or !conversionsPerSec ) {
+        return false;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _numScanChannels or !resource::obtain( resource::ResourceId::Timer1 ) ) {
+            return false;
+        }
+
+        // wait for any single conversion to finish
+        while ( ADCSRA & ( 1 << ADSC ) )
+            ;
+
+        for ( uint8_t i = 0; i < numChannels; i++ ) {
+            _scanChannels[ i ] = channels[ i ] & 0b111;
+        }
+
+        _numScanChannels = numChannels;
+        _scanIndex = 0;
+        _watermark = watermark ? MIN( watermark, ADC_SCAN_SAMPLES ) : 1;
+        _droppedSamples = 0;
+        _samples.clear();
+        _readySyn.clearSignals();
+        setOversampling( oversampleBits, decimation );
+
+        // the slowest prescaler that still fits the period in 16 bits
+        uint32_t ticks{ F_CPU / conversionsPerSec };
+        uint8_t prescaleBits{ 1 << CS10 };
+
+        if ( ticks > 0x10000UL ) {
+            ticks /= 8;
+            prescaleBits = ( 1 << CS11 );
+        }
+
+        if ( ticks > 0x10000UL ) {
+            ticks /= 8;
+            prescaleBits = ( 1 << CS11 ) | ( 1 << CS10 );
+        }
+
+        if ( ticks > 0x10000UL ) {
+            ticks /= 4;
+            prescaleBits = ( 1 << CS12 );
+        }
+
+        if ( ticks > 0x10000UL ) {
+            ticks = 0x10000UL;
+        }
+
+        if ( !( ADCSRA & ( 1 << ADEN ) ) ) {
+            enable();
+        }
+
+        ADMUX = ( ADMUX & 0b11111000 ) | _scanChannels[ 0 ];
+
+        // Timer1 in CTC mode, with compare match B firing once per period to trigger the ADC
+        power_timer1_enable();
+        TCCR1B = 0;
+        TCCR1A = 0;
+        TCNT1 = 0;
+        OCR1A = (uint16_t) ( ticks - 1 );
+        OCR1B = (uint16_t) ( ticks - 1 );
+        TIFR1 = ( 1 << OCF1B );
+
+        ADCSRB = ( ADCSRB & ~( 0b111 << ADTS0 ) ) | ( 1 << ADTS2 ) | ( 1 << ADTS0 );
+        ADCSRA |= ( 1 << ADATE );
+
+        TCCR1B = ( 1 << WGM12 ) | prescaleBits;
+    }
+
+    return true;
+}
+
+
+/// @brief Stops a scan started with beginScan()
+/// @note Samples already in the ring can still be read.
+void Adc::endScan()
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _numScanChannels ) {
+            TCCR1B = 0;
+            power_timer1_disable();
+
+            ADCSRA &= ~( 1 << ADATE );
+            ADCSRB &= ~( 0b111 << ADTS0 );
+
+            _numScanChannels = 0;
+            resource::release( resource::ResourceId::Timer1 );
+        }
+    }
+}
+
+
+/// @brief Determines if a scan is running
+/// @returns `true` if beginScan() has started a scan that hasn't been stopped.
+bool Adc::isScanning() const
+{
+    return _numScanChannels != 0;
+}
+
+
+/// @brief Takes samples from the scan ring, oldest first
+/// @param samples The place to put the samples.
+/// @param maxSamples The most samples to take.
+/// @returns The number of samples taken.
+/// @note The Synapse is only signalled again when the ring next fills to the watermark,
+/// so keep reading until this returns fewer than `maxSamples`.
+uint16_t Adc::readSamples( AdcSample* const samples, const uint16_t maxSamples )
+{
+    uint16_t rc{ 0 };
+
+    while ( rc < maxSamples and _samples.pop( samples[ rc ] ) ) {
+        rc++;
+    }
+
+    return rc;
+}
+
+
+/// @brief Gets the number of samples waiting in the scan ring
+/// @returns The number of samples readSamples() could take right now.
+uint16_t Adc::getSampleCount() const
+{
+    return _samples.getCount();
+}
+
+
+/// @brief Gets the number of samples dropped because the scan ring was full
+/// @returns The count since the scan began, saturating at 65535.
+uint16_t Adc::getDroppedCount() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _droppedSamples;
+    }
+}
+
+
+// Stores a scanned sample and moves the ADC on to the next channel - called from the ISR
+void Adc::setScanConversion( const uint16_t v )
+{
+    // clear the compare flag, so that the next match is a fresh trigger
+    TIFR1 = ( 1 << OCF1B );
+
+    // stay on this channel until it has its 4^n conversions
+    uint16_t reading;
+
+    if ( !accumulate( v, reading ) ) {
+        return;
+    }
+
+    const AdcSample sample{ reading, _scanChannels[ _scanIndex ] };
+
+    // the multiplexer is latched when a conversion starts, so it's safe to
+    // switch it now, ready for the next trigger
+    if ( ++_scanIndex == _numScanChannels ) {
+        _scanIndex = 0;
+    }
+
+    ADMUX = ( ADMUX & 0b11111000 ) | _scanChannels[ _scanIndex ];
+
+    if ( !_samples.push( sample ) ) {
+        if ( _droppedSamples < 0xFFFF ) {
+            _droppedSamples++;
+        }
+    }
+    else if ( _samples.getCount() == _watermark ) {
+        _readySyn.signal();
+    }
+}
+
+#endif
+
+
 ISR( ADC_vect )
 {
+    trace_isr( ADC_vect_num );
+
     if ( _currentAdc ) {
         // set the read value into the current ADC object
         const volatile uint16_t reading{ ADC };
-        _currentAdc->setLastConversion( reading );
+
+        #ifdef ZERO_ADC_SCAN
+            if ( _currentAdc->_numScanChannels ) {
+                _currentAdc->setScanConversion( reading );
+                return;
+            }
+        #endif
+
+        uint16_t value;
+
+        if ( _currentAdc->accumulate( reading, value ) ) {
+            _currentAdc->setLastConversion( value );
+        }
+        else {
+            // straight on to the next conversion for this reading
+            ADCSRA |= ( 1 << ADSC );
+        }
     }
 }
 
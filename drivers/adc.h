@@ -17,9 +17,38 @@
 #include "gpio.h"
 #include "thread.h"
 
+#ifdef ZERO_ADC_SCAN
+    #include "spscring.h"
+#endif
+
 
 namespace zero {
 
+    /// @brief How the conversions behind each oversampled reading are combined
+    enum class AdcDecimation : uint8_t {
+        /// Sum `4^n` conversions and shift right by `n`, for `10 + n` bits of resolution
+        Oversample = 0,
+
+        /// Sum `4^n` conversions and shift right by `2n` - a boxcar average, still 10 bits
+        Average,
+    };
+
+
+    #ifdef ZERO_ADC_SCAN
+
+        /// @brief One conversion taken during a scan
+        struct AdcSample {
+            /// The reading. With `n` oversample bits it is `10 + n` bits wide for
+            /// AdcDecimation::Oversample, and still 10 bits for AdcDecimation::Average.
+            uint16_t value;
+
+            /// The channel the reading was taken from
+            uint8_t channel;
+        };
+
+    #endif
+
+
     /// @brief Provides asychronous ADC sampling services
     class Adc {
     public:
@@ -29,9 +58,29 @@ namespace zero {
         void enable();
         void disable();
 
-        void beginConversion( const uint8_t channel );
+        void beginConversion(
+            const uint8_t channel,                      // the channel to convert
+            const uint8_t oversampleBits = 0,           // take 4^n conversions per reading (0 to 6)
+            const AdcDecimation decimation = AdcDecimation::Oversample );
         uint16_t getLastConversion() const;
 
+        #ifdef ZERO_ADC_SCAN
+            bool beginScan(
+                const uint8_t* const channels,          // the channels to convert, in order
+                const uint8_t numChannels,              // how many channels (1 to 8)
+                const uint16_t conversionsPerSec,       // the trigger rate, across all channels
+                const uint16_t watermark = ADC_SCAN_SAMPLES / 2,    // samples before signalling
+                const uint8_t oversampleBits = 0,       // take 4^n conversions per sample (0 to 6)
+                const AdcDecimation decimation = AdcDecimation::Oversample );
+
+            void endScan();
+            bool isScanning() const;
+
+            uint16_t readSamples( AdcSample* const samples, const uint16_t maxSamples );
+            uint16_t getSampleCount() const;
+            uint16_t getDroppedCount() const;
+        #endif
+
         #include "adc_private.h"
     };
 
@@ -10,6 +10,13 @@ public:
     /// @privatesection
     ~Adc();
     void setLastConversion( const uint16_t v );
+    bool accumulate( const uint16_t v, uint16_t& reading );
+    void setOversampling( const uint8_t oversampleBits, const AdcDecimation decimation );
+
+    #ifdef ZERO_ADC_SCAN
+        void setScanConversion( const uint16_t v );
+        uint8_t _numScanChannels{ 0 };                  // 0 when not scanning
+    #endif
 
 private:
     Adc( const Adc& s ) = delete;
@@ -17,3 +24,17 @@ private:
 
     const Synapse& _readySyn;
     uint16_t _lastConversion;
+
+    // oversampling
+    uint32_t _accumulator{ 0 };
+    uint16_t _conversionsPerReading{ 1 };
+    uint16_t _conversionsLeft{ 1 };
+    uint8_t _shift{ 0 };
+
+    #ifdef ZERO_ADC_SCAN
+        SpscRing<AdcSample, ADC_SCAN_SAMPLES> _samples;
+        uint8_t _scanChannels[ 8 ];
+        uint8_t _scanIndex{ 0 };                        // the channel being converted
+        uint16_t _watermark{ 0 };
+        volatile uint16_t _droppedSamples{ 0 };
+    #endif
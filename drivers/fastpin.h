@@ -0,0 +1,192 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_GPIO
+
+
+#ifndef TCRI_ZERO_FASTPIN_H
+#define TCRI_ZERO_FASTPIN_H
+
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "gpio.h"
+
+
+namespace zero {
+
+    /// @private
+    // finds the bit number of the lowest pin in a PinField
+    constexpr uint8_t pinBitNumber( const PinField pin )
+    {
+        uint8_t rc{ 0 };
+
+        while ( rc < 31 and !( pin & ( 1UL << rc ) ) ) {
+            rc++;
+        }
+
+        return rc;
+    }
+
+
+    /// @brief A single GPIO pin, resolved to its registers at compile time
+    /// @details Ownership of the pin is taken through a Gpio when the FastPin is created,
+    /// exactly as for any other Gpio, but from then on switchOn(), switchOff(), toggle(),
+    /// write() and isHigh() go straight to the pin's registers. Each compiles down to a
+    /// single `sbi`, `cbi` or `sbic`/`sbis` - two cycles, rather than the dozens a Gpio
+    /// takes to mask every port at runtime - which makes it suitable for bit-banging.
+    /// @tparam PIN The pin, for example `ZERO_PINB5`. Must be exactly one pin.
+    /// @note The fast calls trust the ownership check made at construction, so check the
+    /// FastPin with `operator bool()` before using it. They also ignore
+    /// `GpioAspect::Io` locks - use getGpio() where those matter.
+    /// @note Everything lives in this header, so that each call can be inlined.
+    /// @par Example
+    /// @code
+    /// FastPin<ZERO_PINB5> led;
+    ///
+    /// if ( led ) {
+    ///     led.setAsOutput();
+    ///
+    ///     while ( true ) {
+    ///         led.toggle();
+    ///         me.delay( 500_ms );
+    ///     }
+    /// }
+    /// @endcode
+    template <PinField PIN>
+    class FastPin {
+
+        static_assert( PIN and !( PIN & ( PIN - 1 ) ), "FastPin takes exactly one pin" );
+
+        static constexpr uint8_t PORT{ (uint8_t) ( pinBitNumber( PIN ) >> 3 ) };
+        static constexpr uint8_t MASK{ (uint8_t) ( 1 << ( pinBitNumber( PIN ) & 7 ) ) };
+
+    public:
+        /// @brief Gains exclusive access to the pin
+        /// @note Initialization will fail if another Gpio is using the pin.
+        FastPin() : _gpio{ PIN }
+        {
+            // empty
+        }
+
+        /// @brief Determines if the FastPin initialized correctly
+        /// @returns `true` if the pin is owned by this FastPin, `false` otherwise.
+        explicit operator bool() const
+        {
+            return (bool) _gpio;
+        }
+
+        /// @brief Gets the Gpio that owns the pin, for anything that needs one
+        /// @returns A reference to the Gpio.
+        Gpio& getGpio()
+        {
+            return _gpio;
+        }
+
+        /// @brief Sets the pin as an input
+        /// @note Goes via the Gpio, so `GpioAspect::Direction` locks are honoured.
+        void setAsInput()
+        {
+            _gpio.setAsInput();
+        }
+
+        /// @brief Sets the pin as an output
+        /// @note Goes via the Gpio, so `GpioAspect::Direction` locks are honoured.
+        void setAsOutput()
+        {
+            _gpio.setAsOutput();
+        }
+
+        /// @brief Sets the pin high (or enables its pull-up, if it's an input)
+        void switchOn() const
+        {
+            port() |= MASK;
+        }
+
+        /// @brief Sets the pin low (or disables its pull-up, if it's an input)
+        void switchOff() const
+        {
+            port() &= ~MASK;
+        }
+
+        /// @brief Sets the pin high or low
+        /// @param high `true` to set the pin high, `false` to set it low.
+        void write( const bool high ) const
+        {
+            if ( high ) {
+                switchOn();
+            }
+            else {
+                switchOff();
+            }
+        }
+
+        /// @brief Toggles the pin
+        /// @note Writing a one to the PINx register toggles the output.
+        void toggle() const
+        {
+            pin() = MASK;
+        }
+
+        /// @brief Reads the pin
+        /// @returns `true` if the pin is high, `false` if it's low.
+        bool isHigh() const
+        {
+            return pin() & MASK;
+        }
+
+    private:
+        // the switches fold away, leaving a constant I/O address
+        static volatile uint8_t& port()
+        {
+            switch ( PORT ) {
+                #ifdef PORTA
+                    case 0: return PORTA;
+                #endif
+
+                #ifdef PORTB
+                    case 1: return PORTB;
+                #endif
+
+                #ifdef PORTC
+                    case 2: return PORTC;
+                #endif
+
+                default: return PORTD;
+            }
+        }
+
+        static volatile uint8_t& pin()
+        {
+            switch ( PORT ) {
+                #ifdef PINA
+                    case 0: return PINA;
+                #endif
+
+                #ifdef PINB
+                    case 1: return PINB;
+                #endif
+
+                #ifdef PINC
+                    case 2: return PINC;
+                #endif
+
+                default: return PIND;
+            }
+        }
+
+        Gpio _gpio;
+    };
+
+}    // namespace zero
+
+
+#endif
+
+
+#endif
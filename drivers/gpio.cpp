@@ -16,6 +16,8 @@
 
 #include "list.h"
 #include "gpio.h"
+#include "memory.h"
+#include "trace.h"
 
 
 using namespace zero;
@@ -244,6 +246,10 @@ Gpio::~Gpio()
         _allocatedPins &= ~_pins;
         _gpioList.remove( *this );
     }
+
+    #ifdef ZERO_GPIO_EVENTS
+        memory::free( _events, _allocatedBytes );
+    #endif
 }
 
 
@@ -686,6 +692,147 @@ PinField Gpio::gatherAllInputPins()
 }
 
 
+#ifdef ZERO_GPIO_EVENTS
+
+/// @brief Sets a debounce window for the Gpio's input pins
+/// @param ms The window, in milliseconds. After an edge has been passed on (to the
+/// callback, the Synapse and the event queue), any more edges on the Gpio's pins within
+/// this many milliseconds are ignored. `0` passes on every edge.
+/// @note The filtering happens in the pin change ISR, so contact bounce doesn't wake any
+/// Threads. The final level after a bouncy edge can always be read with getInputState().
+/// @note Only available when `GPIO_EVENTS` is enabled in the `makefile`.
+void Gpio::setDebounce( const uint8_t ms )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _debounceMs = ms;
+
+        // so that the very next edge is never mistaken for a bounce
+        _lastEdgeMs = (uint16_t) Thread::now() - ms;
+    }
+}
+
+
+/// @brief Starts queueing a timestamped GpioEvent for every edge on the Gpio's pins
+/// @param numEvents The size of the queue, as a power of 2, up to 128. Taken from the heap.
+/// @returns `true` if the queue was created, `false` if it couldn't be (or already was).
+/// @details With the queue enabled, the Synapse given to the constructor is signalled
+/// only when an event arrives in an empty queue, so a consumer can wake once and drain a
+/// whole batch of edges (for example, from a quadrature encoder) with readEvents().
+/// Edges arriving while the queue is full are dropped and counted.
+/// @note Only available when `GPIO_EVENTS` is enabled in the `makefile`.
+bool Gpio::enableEvents( const uint8_t numEvents )
+{
+    if ( !*this or !numEvents or numEvents > 128 or ( numEvents & ( numEvents - 1 ) ) ) {
+        return false;
+    }
+
+    if ( _events ) {
+        return false;
+    }
+
+    uint16_t allocatedBytes;
+    GpioEvent* const events{ (GpioEvent*) memory::allocate( numEvents * sizeof( GpioEvent ), &allocatedBytes ) };
+
+    if ( !events ) {
+        return false;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _allocatedBytes = allocatedBytes;
+        _eventMask = numEvents - 1;
+        _eventHead = 0;
+        _eventTail = 0;
+        _droppedEvents = 0;
+        _events = events;
+    }
+
+    return true;
+}
+
+
+/// @brief Takes queued edges, oldest first
+/// @param events The place to put the events.
+/// @param maxEvents The most events to take.
+/// @returns The number of events taken.
+/// @note The Synapse is only signalled again once the queue has been emptied, so keep
+/// reading until this returns fewer than `maxEvents`.
+/// @note Only available when `GPIO_EVENTS` is enabled in the `makefile`.
+uint8_t Gpio::readEvents( GpioEvent* const events, const uint8_t maxEvents )
+{
+    uint8_t rc{ 0 };
+
+    if ( !_events ) {
+        return 0;
+    }
+
+    while ( rc < maxEvents ) {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            if ( _eventTail == _eventHead ) {
+                return rc;
+            }
+
+            events[ rc++ ] = _events[ _eventTail & _eventMask ];
+            _eventTail++;
+        }
+    }
+
+    return rc;
+}
+
+
+/// @brief Gets the number of edges lost because the event queue was full
+/// @returns The count since enableEvents(), saturating at 65535.
+/// @note Only available when `GPIO_EVENTS` is enabled in the `makefile`.
+uint16_t Gpio::getDroppedEventCount() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _droppedEvents;
+    }
+}
+
+
+// Debounces an edge and queues it - returns false if it's a bounce to be ignored
+bool Gpio::onEdge(
+    const PinField changed,
+    const uint16_t ms,
+    const uint32_t micros,
+    const PinField levels,
+    bool& wake )
+{
+    if ( _debounceMs ) {
+        if ( (uint16_t) ( ms - _lastEdgeMs ) < _debounceMs ) {
+            return false;
+        }
+
+        _lastEdgeMs = ms;
+    }
+
+    wake = true;
+
+    if ( _events ) {
+        const uint8_t head{ _eventHead };
+        const uint8_t queued{ (uint8_t) ( head - _eventTail ) };
+
+        if ( queued > _eventMask ) {
+            if ( _droppedEvents < 0xFFFF ) {
+                _droppedEvents++;
+            }
+        }
+        else {
+            _events[ head & _eventMask ] = GpioEvent{ micros, changed, sanitize( levels ) };
+            _eventHead = head + 1;
+        }
+
+        // the consumer drains in batches, so only wake it for the first
+        wake = !queued;
+    }
+
+    return true;
+}
+
+#endif
+
+
 // Dispatches the pin change interrupt to the correct Gpio objects
 void Gpio::handlePinChange( const uint8_t portNumber, const uint8_t newValue )
 {
@@ -695,6 +842,21 @@ void Gpio::handlePinChange( const uint8_t portNumber, const uint8_t newValue )
 
     _lastKnownInputs[ portNumber ] = newValue;
 
+    #ifdef ZERO_GPIO_EVENTS
+        if ( !changedField ) {
+            return;
+        }
+
+        // one timestamp and snapshot for everyone
+        const uint16_t ms{ (uint16_t) Thread::now() };
+        const uint32_t micros{ Thread::nowMicros() };
+        const PinField levels{
+            ( (PinField) _lastKnownInputs[ 0 ] << 0 ) |
+            ( (PinField) _lastKnownInputs[ 1 ] << 8 ) |
+            ( (PinField) _lastKnownInputs[ 2 ] << 16 ) |
+            ( (PinField) _lastKnownInputs[ 3 ] << 24 ) };
+    #endif
+
     // find out who we need to notify
     Gpio* cur{ _gpioList.getHead() };
     PinField remaining{ changedField };
@@ -703,15 +865,27 @@ void Gpio::handlePinChange( const uint8_t portNumber, const uint8_t newValue )
         const PinField curPins{ cur->getAllocatedPins() };
 
         if ( curPins & remaining ) {
+            bool wake{ true };
+
+            #ifdef ZERO_GPIO_EVENTS
+                const PinField changedPins{ curPins & remaining };
+            #endif
+
             remaining &= ~curPins;
 
+            #ifdef ZERO_GPIO_EVENTS
+                if ( !cur->onEdge( changedPins, ms, micros, levels, wake ) ) {
+                    continue;
+                }
+            #endif
+
             // always call the callback first
             if ( cur->_inputCallback ) {
                 cur->_inputCallback( *cur );
             }
 
             // .. and only then the Synapse
-            if ( cur->_inputSynapse ) {
+            if ( wake and cur->_inputSynapse ) {
                 cur->_inputSynapse->signal();
             }
         }
@@ -725,6 +899,8 @@ void Gpio::handlePinChange( const uint8_t portNumber, const uint8_t newValue )
 #ifdef PC_PORTA_vect
 ISR( PC_PORTA_vect )
 {
+    trace_isr( PCINT0_vect_num + PCPA );
+
     Gpio::handlePinChange( 0, PINA );
 }
 #endif
@@ -733,6 +909,8 @@ ISR( PC_PORTA_vect )
 #ifdef PC_PORTB_vect
 ISR( PC_PORTB_vect )
 {
+    trace_isr( PCINT0_vect_num + PCPB );
+
     Gpio::handlePinChange( 1, PINB );
 }
 #endif
@@ -741,6 +919,8 @@ ISR( PC_PORTB_vect )
 #ifdef PC_PORTC_vect
 ISR( PC_PORTC_vect )
 {
+    trace_isr( PCINT0_vect_num + PCPC );
+
     Gpio::handlePinChange( 2, PINC );
 }
 #endif
@@ -749,6 +929,8 @@ ISR( PC_PORTC_vect )
 #ifdef PC_PORTD_vect
 ISR( PC_PORTD_vect )
 {
+    trace_isr( PCINT0_vect_num + PCPD );
+
     Gpio::handlePinChange( 3, PIND );
 }
 #endif
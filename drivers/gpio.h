@@ -114,6 +114,24 @@ namespace zero {
     };
 
 
+    #ifdef ZERO_GPIO_EVENTS
+
+        /// @brief One debounced edge on a Gpio's input pins
+        /// @note Only available when `GPIO_EVENTS` is enabled in the `makefile`.
+        struct GpioEvent {
+            /// When the edge was seen, from `Thread::nowMicros()`
+            uint32_t micros;
+
+            /// The pins that changed
+            PinField changed;
+
+            /// The input levels of all of the Gpio's pins, just after the change
+            PinField levels;
+        };
+
+    #endif
+
+
     /// @brief Provides protected access to GPIO pins
     class Gpio {
     public:
@@ -157,6 +175,17 @@ namespace zero {
 
         void lock( const GpioAspect a );                // prevents further changes to some aspect of the Gpio
 
+        #ifdef ZERO_GPIO_EVENTS
+            void setDebounce( const uint8_t ms );       // ignores edges within ms of the last one
+
+            bool enableEvents( const uint8_t numEvents );   // queues timestamped edges (power of 2, up to 128)
+            uint8_t readEvents(
+                GpioEvent* const events,                // place to put the events, oldest first
+                const uint8_t maxEvents );              // the most events to take
+
+            uint16_t getDroppedEventCount() const;      // edges lost because the queue was full
+        #endif
+
         #include "gpio_private.h"
     };
 
@@ -32,9 +32,30 @@ private:
 
     inline PinField sanitize( const PinField pins ) const;
 
+    #ifdef ZERO_GPIO_EVENTS
+        bool onEdge(
+            const PinField changed,                     // the pins of this Gpio that changed
+            const uint16_t ms,                          // low bits of Thread::now()
+            const uint32_t micros,                      // Thread::nowMicros()
+            const PinField levels,                      // the input levels across all ports
+            bool& wake );                               // set if the Synapse should be signalled
+    #endif
+
     const InputCallback _inputCallback;                 // called when an input pin changes state
     const Synapse* _inputSynapse;                       // signalled when an input pin changes state
     const PinField _pins;                               // pins owned by this object
 
     PinControl _directionControl;                       // Determines if changes to the direction are allowed
     PinControl _outputControl;                          // Determines if changes to the high/low state are allowed
+
+    #ifdef ZERO_GPIO_EVENTS
+        uint8_t _debounceMs{ 0 };                       // edges this soon after the last are ignored
+        uint16_t _lastEdgeMs{ 0 };                      // low bits of Thread::now() at the last edge kept
+
+        uint16_t _allocatedBytes{ 0 };
+        GpioEvent* _events{ nullptr };                  // ring of edges, if enabled
+        uint8_t _eventMask{ 0 };
+        volatile uint8_t _eventHead{ 0 };               // written by the ISR only
+        volatile uint8_t _eventTail{ 0 };               // written by readEvents() only
+        uint16_t _droppedEvents{ 0 };
+    #endif
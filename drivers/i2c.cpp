@@ -0,0 +1,402 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_I2C
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <util/atomic.h>
+#include <util/twi.h>
+
+#include "i2c.h"
+#include "thread.h"
+#include "resource.h"
+#include "trace.h"
+
+
+#if I2C_CFG == 1
+    #define I2C_PORT    PORTC
+    #define I2C_DDR     DDRC
+    #define SDA         ( 1 << PINC4 )
+    #define SCL         ( 1 << PINC5 )
+
+#elif I2C_CFG == 2
+    #define I2C_PORT    PORTC
+    #define I2C_DDR     DDRC
+    #define SDA         ( 1 << PINC1 )
+    #define SCL         ( 1 << PINC0 )
+#endif
+
+
+using namespace zero;
+
+
+namespace {
+
+    // TWCR values - each clears TWINT, which is what sets the hardware going again
+    const uint8_t TWCR_IDLE{ 1 << TWEN };
+    const uint8_t TWCR_NEXT{ ( 1 << TWINT ) | ( 1 << TWEN ) | ( 1 << TWIE ) };
+    const uint8_t TWCR_ACK{ TWCR_NEXT | ( 1 << TWEA ) };
+    const uint8_t TWCR_START{ TWCR_NEXT | ( 1 << TWSTA ) };
+    const uint8_t TWCR_STOP{ ( 1 << TWINT ) | ( 1 << TWEN ) | ( 1 << TWSTO ) };
+
+    volatile const uint8_t* _txCursor{ nullptr };
+    volatile uint8_t* _rxCursor{ nullptr };
+    volatile uint16_t _txRemaining{ 0 };
+    volatile uint16_t _rxRemaining{ 0 };
+
+    I2cTransaction* _curXfer{ nullptr };                // the transaction on the bus right now
+    I2cTransaction* _queueHead{ nullptr };              // transactions waiting for the bus
+    I2cTransaction* _queueTail{ nullptr };
+
+}    // namespace
+
+
+/// @brief Claims the I2C bus, as its master
+/// @param busHz Optional. Default: `100000UL`. The SCL clock, in Hz. Most devices
+/// manage `400000UL`.
+/// @param pullUps Optional. Default: `true`. If `true`, the internal pull-ups on SDA and
+/// SCL are enabled. They're weak, so anything but a short, slow bus wants external ones.
+/// @note Claims the TWI peripheral (`ResourceId::I2c`), so only one I2c can exist at a time.
+I2c::I2c( const uint32_t busHz, const bool pullUps )
+{
+    if ( !resource::obtain( resource::ResourceId::I2c ) ) {
+        return;
+    }
+
+    I2C_DDR &= ~( SDA | SCL );
+
+    if ( pullUps ) {
+        I2C_PORT |= ( SDA | SCL );
+    }
+
+    // SCL = F_CPU / ( 16 + 2 * TWBR * 4^TWPS ), so slow buses need the prescaler
+    const uint32_t cycles{ F_CPU / ( busHz ? busHz : 1 ) };
+    uint32_t bitRate{ ( cycles > 16 ) ? ( cycles - 16 ) / 2 : 0 };
+    uint8_t prescaler{ 0 };
+
+    while ( bitRate > 255 and prescaler < 3 ) {
+        bitRate = ( bitRate + 3 ) / 4;
+        prescaler++;
+    }
+
+    TWBR = ( bitRate > 255 ) ? 255 : bitRate;
+    TWSR = prescaler;
+    TWCR = TWCR_IDLE;
+
+    _isValid = true;
+}
+
+
+// dtor
+I2c::~I2c()
+{
+    if ( *this ) {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            // nobody's left to run them
+            while ( _curXfer ) {
+                cancel( *_curXfer );
+            }
+
+            TWCR = 0;
+            TWBR = 0;
+            TWSR = 0;
+
+            // return the lines to floating
+            I2C_PORT &= ~( SDA | SCL );
+        }
+
+        // free the resource
+        resource::release( resource::ResourceId::I2c );
+    }
+}
+
+
+/// @brief Determines if the I2c initialized correctly
+/// @returns `true` if the I2c correctly initialized, `false` otherwise.
+I2c::operator bool() const
+{
+    return _isValid;
+}
+
+
+/// @brief Queues a transaction, behind any others already waiting for the I2C bus
+/// @param t The transaction to queue.
+/// @returns `true` if the transaction was queued, `false` if its address is more than
+/// 7 bits, a buffer is missing, or it's already queued.
+/// @note Never blocks. The transaction's Synapse is signalled once it is complete, and
+/// its `status` says how it went.
+/// @note May be called from within an ISR.
+bool I2c::queue( I2cTransaction& t )
+{
+    if ( !*this or t.address > 0x7F or ( t.txBytes and !t.txBuffer ) or ( t.rxBytes and !t.rxBuffer ) ) {
+        return false;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( t.pending ) {
+            return false;
+        }
+
+        t.status = I2cStatus::Pending;
+        t.pending = true;
+        t.next = nullptr;
+
+        if ( _curXfer ) {
+            // the ISR will get to it
+            if ( _queueTail ) {
+                _queueTail->next = &t;
+            }
+            else {
+                _queueHead = &t;
+            }
+
+            _queueTail = &t;
+        }
+        else {
+            startTransaction( t, false );
+        }
+    }
+
+    return true;
+}
+
+
+/// @brief Takes a transaction back, whether it's still in the queue or already on the bus
+/// @param t The transaction to cancel.
+/// @returns `true` if the transaction was cancelled, `false` if it wasn't pending.
+/// @note A cancelled transaction finishes with `I2cStatus::Timeout`, and its Synapse is
+/// signalled as usual. If it was on the bus, the TWI hardware is reset to let go of the
+/// lines, and the next transaction starts afresh.
+/// @note May be called from within an ISR.
+bool I2c::cancel( I2cTransaction& t )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( !t.pending ) {
+            return false;
+        }
+
+        if ( &t == _curXfer ) {
+            resetBus();
+            transferComplete( I2cStatus::Timeout, false );
+            return true;
+        }
+
+        // still queued, so just unlink it
+        I2cTransaction* prev{ nullptr };
+
+        for ( I2cTransaction* cur = _queueHead; cur; prev = cur, cur = cur->next ) {
+            if ( cur == &t ) {
+                if ( prev ) {
+                    prev->next = t.next;
+                }
+                else {
+                    _queueHead = t.next;
+                }
+
+                if ( _queueTail == &t ) {
+                    _queueTail = prev;
+                }
+
+                break;
+            }
+        }
+
+        t.status = I2cStatus::Timeout;
+        t.pending = false;
+
+        if ( t.doneSyn ) {
+            t.doneSyn->signal();
+        }
+    }
+
+    return true;
+}
+
+
+/// @brief Writes to a device, then reads from it, blocking until done
+/// @param address The 7-bit address of the device.
+/// @param txBuffer The data to write to the device.
+/// @param txBytes The number of bytes to write.
+/// @param rxBuffer The place to store the data read from the device.
+/// @param rxBytes The number of bytes to read, after a repeated start.
+/// @param timeout Optional. Default: `0_ms`. The maximum length of time to wait. `0_ms`
+/// waits forever.
+/// @returns How the transaction ended. `I2cStatus::Timeout` if it took too long (it is
+/// cancelled) or no signal could be allocated to wait on. `I2cStatus::BusError` if it
+/// couldn't be queued at all.
+/// @note Other Threads may run while the transaction is on the bus. Only call this from
+/// a Thread, not an ISR.
+I2cStatus I2c::transfer(
+    const uint8_t address,
+    const void* const txBuffer,
+    const uint16_t txBytes,
+    void* const rxBuffer,
+    const uint16_t rxBytes,
+    const Duration timeout )
+{
+    // a signal to be woken with when it's done
+    Synapse syn;
+
+    if ( !syn ) {
+        return I2cStatus::Timeout;
+    }
+
+    I2cTransaction t{ address, txBuffer, txBytes, rxBuffer, rxBytes, &syn, I2cStatus::Ok, false, nullptr };
+
+    if ( !queue( t ) ) {
+        return I2cStatus::BusError;
+    }
+
+    syn.wait( timeout );
+
+    // if it's finished meanwhile, this does nothing
+    cancel( t );
+
+    return t.status;
+}
+
+
+// Puts a transaction on the bus, by sending a START - the ISR does the rest.
+// A STOP goes out first if the previous transaction left us holding the bus.
+// Interrupts must already be off.
+void I2c::startTransaction( I2cTransaction& t, const bool releaseBus )
+{
+    _curXfer = &t;
+
+    // set up the housekeeping
+    _txCursor = (const uint8_t*) t.txBuffer;
+    _txRemaining = t.txBytes;
+    _rxCursor = (uint8_t*) t.rxBuffer;
+    _rxRemaining = t.rxBytes;
+
+    // a STOP on its own may still be going out, and sends no interrupt when it's done
+    while ( TWCR & ( 1 << TWSTO ) ) {
+        // empty
+    }
+
+    TWCR = releaseBus ? ( TWCR_START | ( 1 << TWSTO ) ) : TWCR_START;
+}
+
+
+// Disables and re-enables the TWI hardware, which lets go of SDA and SCL
+// mid-byte and forgets any state. Interrupts must already be off.
+void I2c::resetBus()
+{
+    TWCR = 0;
+    TWCR = TWCR_IDLE;
+}
+
+
+// Finishes with the transaction that's just completed, and chains straight
+// into the next one (if there is one). If releaseBus is true, we still hold
+// the bus and a STOP is sent. Called by the ISR, and with interrupts off.
+void I2c::transferComplete( const I2cStatus status, const bool releaseBus )
+{
+    I2cTransaction* const done{ _curXfer };
+
+    done->status = status;
+    done->pending = false;
+    _curXfer = nullptr;
+
+    if ( done->doneSyn ) {
+        done->doneSyn->signal();
+    }
+
+    if ( I2cTransaction* const t = _queueHead ) {
+        _queueHead = t->next;
+
+        if ( !_queueHead ) {
+            _queueTail = nullptr;
+        }
+
+        startTransaction( *t, releaseBus );
+    }
+    else {
+        TWCR = releaseBus ? TWCR_STOP : ( TWCR_IDLE | ( 1 << TWINT ) );
+    }
+}
+
+
+// This ISR is run whenever the TWI hardware finishes a step on the bus - a
+// START, an address, or a byte - and waits, holding SCL low, to be told what next
+ISR( TWI_vect )
+{
+    trace_isr( TWI_vect_num );
+
+    switch ( TW_STATUS ) {
+        case TW_START:
+        case TW_REP_START:
+            // write first, unless there's only reading to do
+            TWDR = ( _curXfer->address << 1 ) | ( ( _txRemaining or !_rxRemaining ) ? TW_WRITE : TW_READ );
+            TWCR = TWCR_NEXT;
+            break;
+
+        case TW_MT_DATA_NACK:
+            // devices may refuse the last byte, but not any before it
+            if ( _txRemaining ) {
+                I2c::transferComplete( I2cStatus::DataNack, true );
+                break;
+            }
+
+            // fall through
+
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if ( _txRemaining ) {
+                TWDR = *_txCursor++;
+                _txRemaining--;
+                TWCR = TWCR_NEXT;
+            }
+            else if ( _rxRemaining ) {
+                // turn the bus around without letting go of it
+                TWCR = TWCR_START;
+            }
+            else {
+                I2c::transferComplete( I2cStatus::Ok, true );
+            }
+            break;
+
+        case TW_MR_DATA_ACK:
+            *_rxCursor++ = TWDR;
+            _rxRemaining--;
+
+            // fall through
+
+        case TW_MR_SLA_ACK:
+            // acknowledge every byte but the last, which tells the device to stop
+            TWCR = ( _rxRemaining > 1 ) ? TWCR_ACK : TWCR_NEXT;
+            break;
+
+        case TW_MR_DATA_NACK:
+            *_rxCursor++ = TWDR;
+            _rxRemaining--;
+            I2c::transferComplete( I2cStatus::Ok, true );
+            break;
+
+        case TW_MT_SLA_NACK:
+        case TW_MR_SLA_NACK:
+            I2c::transferComplete( I2cStatus::AddressNack, true );
+            break;
+
+        case TW_MT_ARB_LOST:
+            // the hardware has already let go of the bus
+            I2c::transferComplete( I2cStatus::ArbitrationLost, false );
+            break;
+
+        default:
+            // a STOP is how the hardware gets over a bus error
+            I2c::transferComplete( I2cStatus::BusError, true );
+            break;
+    }
+}
+
+
+#endif
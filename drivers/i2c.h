@@ -0,0 +1,131 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_I2C
+
+
+#ifndef TCRI_ZERO_I2C_H
+#define TCRI_ZERO_I2C_H
+
+
+#include <stdint.h>
+
+#include "thread.h"
+#include "time.h"
+
+
+namespace zero {
+
+    /// @brief How an I2cTransaction ended
+    enum class I2cStatus : uint8_t {
+        /// Every byte was sent and received
+        Ok = 0,
+
+        /// Still queued, or on the bus
+        Pending,
+
+        /// Nobody acknowledged the address
+        AddressNack,
+
+        /// The device refused a byte before all of them were sent
+        DataNack,
+
+        /// Another master won the bus
+        ArbitrationLost,
+
+        /// An illegal START or STOP was seen on the bus
+        BusError,
+
+        /// The transaction was cancelled, or didn't finish in time
+        Timeout,
+    };
+
+
+    /// @brief One exchange with a device on the I2C bus, waiting in the queue for it
+    /// @details `txBytes` are written to the device first, then - after a repeated
+    /// start, so that nobody else can get in between - `rxBytes` are read back from it.
+    /// Either may be zero, so the same transaction covers plain writes, plain reads and
+    /// the usual "write a register number, read its value" exchange. A transaction with
+    /// neither just checks that the device acknowledges its address.
+    /// @note The transaction, and the buffers it points to, belong to the caller and
+    /// must stay put until the transaction's Synapse is signalled.
+    struct I2cTransaction {
+        /// The 7-bit address of the device
+        uint8_t address;
+
+        /// The data to write to the device
+        const void* txBuffer;
+
+        /// The number of bytes to write
+        uint16_t txBytes;
+
+        /// The place to store the data read from the device
+        void* rxBuffer;
+
+        /// The number of bytes to read
+        uint16_t rxBytes;
+
+        /// Optional. The Synapse to signal once the transaction is complete
+        const Synapse* doneSyn;
+
+        /// How the transaction ended, or `I2cStatus::Pending` until it has
+        volatile I2cStatus status;
+
+        /// @private
+        volatile bool pending;
+
+        /// @private
+        I2cTransaction* next;
+    };
+
+
+    /// @brief The hardware I2C (TWI) bus, as a master
+    /// @details Transactions go into a queue, and the TWI ISR runs each one a byte at a
+    /// time - between bytes the bus clocks along on its own, and the CPU is free. When one
+    /// finishes, the ISR starts the next straight away, so the bus stays busy and nobody
+    /// spins waiting for it.
+    /// @code
+    /// I2c i2c{ 400000UL };
+    ///
+    /// const uint8_t reg{ 0x75 };
+    /// uint8_t whoAmI;
+    ///
+    /// if ( i2c.transfer( 0x68, &reg, 1, &whoAmI, 1, 10_ms ) == I2cStatus::Ok ) {
+    ///     ...
+    /// }
+    /// @endcode
+    class I2c {
+    public:
+        I2c(
+            const uint32_t busHz = 100000UL,            // the SCL clock, in Hz
+            const bool pullUps = true );                // enable the internal pull-ups on SDA and SCL?
+        ~I2c();
+
+        bool queue( I2cTransaction& t );                // queues a transaction, never blocks
+        bool cancel( I2cTransaction& t );               // takes a transaction back, finished or not
+
+        I2cStatus transfer(                             // runs a transaction, and waits for it
+            const uint8_t address,
+            const void* const txBuffer,
+            const uint16_t txBytes,
+            void* const rxBuffer,
+            const uint16_t rxBytes,
+            const Duration timeout = 0_ms );
+
+        explicit operator bool() const;
+
+        #include "i2c_private.h"
+    };
+
+}    // namespace zero
+
+
+#endif
+
+
+#endif
@@ -0,0 +1,20 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    static void transferComplete( const I2cStatus status, const bool releaseBus );
+
+private:
+    I2c( const I2c& i ) = delete;
+    void operator=( const I2c& i ) = delete;
+
+    static void startTransaction( I2cTransaction& t, const bool releaseBus );
+    static void resetBus();
+
+    bool _isValid{ false };
@@ -9,11 +9,15 @@
 #ifdef ZERO_DRIVERS_PIPE
 
 
+#include <string.h>
+#include <avr/pgmspace.h>
 #include <util/atomic.h>
 
 #include "pipe.h"
 #include "memory.h"
 #include "thread.h"
+#include "trace.h"
+#include "util.h"
 
 
 using namespace zero;
@@ -83,10 +87,7 @@ bool Pipe::read( uint8_t& data )
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
         bool rc{ false };
 
-        while ( isEmpty() and _dataAvailSyn ) {
-            _dataAvailSyn->wait();
-            cli();
-        }
+        waitForData();
 
         // select the byte and invoke the filter
         bool doIt{ true };
@@ -105,9 +106,7 @@ bool Pipe::read( uint8_t& data )
                 _startIndex = 0;
             }
 
-            if ( _roomAvailSyn ) {
-                _roomAvailSyn->signal();
-            }
+            roomAdded();
 
             rc = true;
         }
@@ -123,13 +122,32 @@ bool Pipe::read( uint8_t& data )
 bool Pipe::write( const uint8_t data )
 {
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
-        bool rc{ false };
-
         while ( isFull() and _roomAvailSyn ) {
+            trace_event( TraceEvent::PipeFull, (uint16_t) this );
             _roomAvailSyn->wait();
             cli();
         }
 
+        return tryWrite( data );
+    }
+}
+
+
+/// @brief Writes a byte to the Pipe, but only if there's room for it
+/// @param data The byte to write to the Pipe.
+/// @returns `true` if the data was successfully written, `false` if the Pipe was full
+/// (or the write filter rejected the byte).
+/// @note Never waits, so may be called from within an ISR.
+bool Pipe::tryWrite( const uint8_t data )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        bool rc{ false };
+
+        if ( isFull() ) {
+            trace_event( TraceEvent::PipeFull, (uint16_t) this );
+            return rc;
+        }
+
         // invoke the filter
         bool doIt{ true };
         uint8_t dataToWrite{ data };
@@ -149,9 +167,7 @@ bool Pipe::write( const uint8_t data )
             _buffer[ index ] = dataToWrite;
             _length++;
 
-            if ( _dataAvailSyn ) {
-                _dataAvailSyn->signal();
-            }
+            dataAdded( _length - 1 );
 
             rc = true;
         }
@@ -161,6 +177,252 @@ bool Pipe::write( const uint8_t data )
 }
 
 
+/// @brief Reads as many bytes as are available from the Pipe, up to a limit
+/// @param buffer The place to store the bytes read from the Pipe.
+/// @param maxLen The most bytes to read.
+/// @returns The number of bytes read into `buffer`.
+/// @note If a data available Synapse has been set, this waits until the data watermark
+/// is reached or the Pipe goes quiet (see setWatermarks()), but not for `maxLen` bytes.
+/// @note Without a read filter, the bytes are copied in (at most) two runs around the
+/// end of the buffer, and the room available Synapse is signalled once for the lot.
+/// With a read filter, the filter sees each byte in turn, and reading stops at the
+/// first byte it rejects.
+uint16_t Pipe::read( uint8_t* const buffer, const uint16_t maxLen )
+{
+    uint16_t rc{ 0 };
+
+    if ( !maxLen ) {
+        return rc;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        waitForData();
+
+        if ( _readFilter ) {
+            // the filter has to see every byte
+            while ( rc < maxLen and _length ) {
+                uint8_t dataToRead{ _buffer[ _startIndex ] };
+
+                if ( !_readFilter( dataToRead ) ) {
+                    break;
+                }
+
+                buffer[ rc++ ] = dataToRead;
+                _length--;
+
+                if ( ++_startIndex == _bufferSize ) {
+                    _startIndex = 0;
+                }
+            }
+        }
+        else {
+            rc = MIN( _length, maxLen );
+
+            // from the start index up to the end of the buffer, then whatever's wrapped around
+            const uint16_t firstRun{ MIN( rc, (uint16_t) ( _bufferSize - _startIndex ) ) };
+
+            memcpy( buffer, _buffer + _startIndex, firstRun );
+            memcpy( buffer + firstRun, _buffer, rc - firstRun );
+
+            _startIndex += rc;
+            _length -= rc;
+
+            if ( _startIndex >= _bufferSize ) {
+                _startIndex -= _bufferSize;
+            }
+        }
+
+        if ( rc ) {
+            roomAdded();
+        }
+    }
+
+    return rc;
+}
+
+
+/// @brief Writes a number of bytes to the Pipe
+/// @param buffer The bytes to write.
+/// @param len The number of bytes to write.
+/// @param fromFlash Optional. Default: `false`. If `true`, `buffer` points to an address
+/// in Flash memory instead of SRAM, and is copied straight from there.
+/// @returns The number of bytes taken from `buffer` - including any that the write
+/// filter discarded.
+/// @note If a room available Synapse has been set, this waits for room as often as
+/// needed until all `len` bytes are written. Otherwise it writes what fits.
+/// @note Without a write filter, the bytes are copied in (at most) two runs around the
+/// end of the buffer, and the data available Synapse is signalled once per batch.
+uint16_t Pipe::write( const uint8_t* const buffer, const uint16_t len, const bool fromFlash )
+{
+    uint16_t rc{ 0 };
+
+    while ( rc < len ) {
+        uint16_t taken{ 0 };
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            while ( isFull() and _roomAvailSyn ) {
+                trace_event( TraceEvent::PipeFull, (uint16_t) this );
+                _roomAvailSyn->wait();
+                cli();
+            }
+
+            // work out where the incoming bytes go
+            uint16_t index{ (uint16_t) ( _startIndex + _length ) };
+
+            if ( index >= _bufferSize ) {
+                index -= _bufferSize;
+            }
+
+            const uint16_t lengthBefore{ _length };
+
+            if ( _writeFilter ) {
+                // the filter has to see every byte
+                while ( rc + taken < len and _length < _bufferSize ) {
+                    const uint8_t* const src{ buffer + rc + taken++ };
+                    uint8_t dataToWrite{ fromFlash ? pgm_read_byte( src ) : *src };
+
+                    if ( _writeFilter( dataToWrite ) ) {
+                        _buffer[ index ] = dataToWrite;
+                        _length++;
+
+                        if ( ++index == _bufferSize ) {
+                            index = 0;
+                        }
+                    }
+                }
+            }
+            else {
+                taken = MIN( (uint16_t) ( len - rc ), (uint16_t) ( _bufferSize - _length ) );
+
+                // from the index up to the end of the buffer, then the rest at the start
+                const uint16_t firstRun{ MIN( taken, (uint16_t) ( _bufferSize - index ) ) };
+
+                if ( fromFlash ) {
+                    memcpy_P( _buffer + index, buffer + rc, firstRun );
+                    memcpy_P( _buffer, buffer + rc + firstRun, taken - firstRun );
+                }
+                else {
+                    memcpy( _buffer + index, buffer + rc, firstRun );
+                    memcpy( _buffer, buffer + rc + firstRun, taken - firstRun );
+                }
+
+                _length += taken;
+            }
+
+            if ( _length != lengthBefore ) {
+                dataAdded( lengthBefore );
+            }
+        }
+
+        if ( !taken ) {
+            // full, and nobody to tell us when it isn't
+            trace_event( TraceEvent::PipeFull, (uint16_t) this );
+            break;
+        }
+
+        rc += taken;
+    }
+
+    return rc;
+}
+
+
+/// @brief Gets the next run of free space in the Pipe, to be written to in place
+/// @param region A reference to the place to store a pointer to the free space.
+/// @returns The number of bytes that may be written at `region`, or `0` if the Pipe is full.
+/// @note If a room available Synapse has been set, this waits until there is some room.
+/// @note The run stops at the end of the Pipe's buffer, so there may be more room at the
+/// start - commit() what was written and call reserve() again.
+/// @note Nothing is visible to readers until commit() is called. Filters are not applied,
+/// and only one writer at a time should reserve.
+uint16_t Pipe::reserve( uint8_t*& region )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        while ( isFull() and _roomAvailSyn ) {
+            trace_event( TraceEvent::PipeFull, (uint16_t) this );
+            _roomAvailSyn->wait();
+            cli();
+        }
+
+        uint16_t index{ (uint16_t) ( _startIndex + _length ) };
+
+        if ( index >= _bufferSize ) {
+            index -= _bufferSize;
+        }
+
+        region = _buffer + index;
+
+        if ( isFull() ) {
+            return 0;
+        }
+
+        // free space runs to the end of the buffer, or up to the unread data if that's in the way
+        return ( index >= _startIndex ) ? _bufferSize - index : _startIndex - index;
+    }
+}
+
+
+/// @brief Publishes bytes written in place after a call to reserve()
+/// @param numBytes The number of bytes written, no more than reserve() returned.
+void Pipe::commit( const uint16_t numBytes )
+{
+    if ( !numBytes ) {
+        return;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        const uint16_t lengthBefore{ _length };
+        _length += MIN( numBytes, (uint16_t) ( _bufferSize - _length ) );
+
+        dataAdded( lengthBefore );
+    }
+}
+
+
+/// @brief Gets the next run of data in the Pipe, to be read in place
+/// @param region A reference to the place to store a pointer to the data.
+/// @returns The number of bytes that may be read at `region`, or `0` if the Pipe is empty.
+/// @note If a data available Synapse has been set, this waits until the data watermark
+/// is reached or the Pipe goes quiet (see setWatermarks()).
+/// @note The run stops at the end of the Pipe's buffer, so there may be more data at the
+/// start - consume() what was read and call peek() again.
+/// @note The data stays in the Pipe until consume() is called. Filters are not applied,
+/// and only one reader at a time should peek.
+uint16_t Pipe::peek( const uint8_t*& region )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        waitForData();
+
+        region = _buffer + _startIndex;
+
+        return MIN( _length, (uint16_t) ( _bufferSize - _startIndex ) );
+    }
+}
+
+
+/// @brief Removes bytes read in place after a call to peek()
+/// @param numBytes The number of bytes read, no more than peek() returned.
+void Pipe::consume( const uint16_t numBytes )
+{
+    if ( !numBytes ) {
+        return;
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        const uint16_t n{ MIN( numBytes, _length ) };
+
+        _startIndex += n;
+        _length -= n;
+
+        if ( _startIndex >= _bufferSize ) {
+            _startIndex -= _bufferSize;
+        }
+
+        roomAdded();
+    }
+}
+
+
 /// @brief Empties the Pipe
 void Pipe::flush()
 {
@@ -178,6 +440,94 @@ void Pipe::flush()
 }
 
 
+/// @brief Sets how much data or room there must be before waiting Threads are woken
+/// @param dataWatermark The number of bytes that must be in the Pipe before the data
+/// available Synapse is signalled. A new Pipe uses `1`, waking readers for every byte.
+/// @param roomWatermark Optional. Default: `1`. The number of free bytes there must be
+/// before the room available Synapse is signalled.
+/// @note With a data watermark above `1`, set an idle timeout too (see setIdleTimeout())
+/// so that the tail end of a burst doesn't sit in the Pipe unread.
+void Pipe::setWatermarks( const uint16_t dataWatermark, const uint16_t roomWatermark )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _dataWatermark = MIN( MAX( dataWatermark, (uint16_t) 1 ), _bufferSize );
+        _roomWatermark = MIN( MAX( roomWatermark, (uint16_t) 1 ), _bufferSize );
+    }
+}
+
+
+/// @brief Sets how long the Pipe must go without a write before readers take what's there
+/// @param timeout The length of the quiet period, or `0_ms` (the default) to only ever
+/// wake readers at the data watermark.
+/// @note Only readers blocked in the Pipe's own read(), peek() etc. notice the quiet period.
+void Pipe::setIdleTimeout( const Duration timeout )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _idleMs = (uint16_t) (uint32_t) timeout;
+    }
+}
+
+
+// Blocks (if there's a data available Synapse) until there's enough data in the
+// Pipe, or there's some and there haven't been any writes for a while.
+// Interrupts must already be off.
+void Pipe::waitForData()
+{
+    while ( _dataAvailSyn ) {
+        if ( _length >= _dataWatermark ) {
+            return;
+        }
+
+        uint16_t timeout{ 0 };
+
+        if ( _length and _idleMs ) {
+            const uint16_t quietFor{ (uint16_t) ( (uint16_t) Thread::now() - _lastWriteMs ) };
+
+            if ( quietFor >= _idleMs ) {
+                return;
+            }
+
+            // wake up when the line would have been quiet long enough
+            timeout = _idleMs - quietFor;
+        }
+
+        if ( !_length ) {
+            trace_event( TraceEvent::PipeEmpty, (uint16_t) this );
+        }
+
+        _dataAvailSyn->wait( Duration{ timeout } );
+        cli();
+    }
+}
+
+
+// Wakes a reader if there's now enough data in the Pipe for it.
+// Interrupts must already be off.
+void Pipe::dataAdded( const uint16_t lengthBefore )
+{
+    if ( _idleMs ) {
+        _lastWriteMs = (uint16_t) Thread::now();
+    }
+
+    if ( _dataAvailSyn ) {
+        // the first byte of a burst starts the reader's idle clock
+        if ( _length >= _dataWatermark or ( _idleMs and !lengthBefore ) ) {
+            _dataAvailSyn->signal();
+        }
+    }
+}
+
+
+// Wakes a writer if there's now enough room in the Pipe for it.
+// Interrupts must already be off.
+void Pipe::roomAdded()
+{
+    if ( _roomAvailSyn and _bufferSize - _length >= _roomWatermark ) {
+        _roomAvailSyn->signal();
+    }
+}
+
+
 /// @brief Assigns a read filter to the Pipe
 /// @param f The callback function to use when data is about to read from the Pipe.
 void Pipe::setReadFilter( PipeFilter f )
@@ -14,6 +14,7 @@
 
 
 #include <stdint.h>
+#include <avr/pgmspace.h>
 #include "thread.h"
 
 
@@ -35,8 +36,23 @@ namespace zero {
 
         bool read( uint8_t& data );
         bool write( const uint8_t data );
+        bool tryWrite( const uint8_t data );
+        uint16_t read( uint8_t* const buffer, const uint16_t maxLen );
+        uint16_t write( const uint8_t* const buffer, const uint16_t len, const bool fromFlash = false );
         void flush();
 
+        // zero-copy access
+        uint16_t reserve( uint8_t*& region );
+        void commit( const uint16_t numBytes );
+        uint16_t peek( const uint8_t*& region );
+        void consume( const uint16_t numBytes );
+
+        // batching wakeups
+        void setWatermarks(
+            const uint16_t dataWatermark,               // bytes in the Pipe before readers are woken
+            const uint16_t roomWatermark = 1 );         // free bytes in the Pipe before writers are woken
+        void setIdleTimeout( const Duration timeout );  // quiet period after which readers take what's there
+
         void setReadFilter( PipeFilter p );
         void setWriteFilter( PipeFilter p );
 
@@ -49,8 +65,23 @@ namespace zero {
 }    // namespace zero
 
 
+namespace zero {
+
+    /// @brief A string in Flash memory, to be written to a Pipe with `<<`
+    /// @note Use the `FSTR()` macro rather than making one directly.
+    struct FlashString {
+        /// Pointer to Flash, not SRAM
+        const char* s;
+    };
+
+}    // namespace zero
+
+#define FSTR( s ) ( zero::FlashString{ PSTR( s ) } )
+
+
 zero::Pipe& operator<<( zero::Pipe& out, const char c );
 zero::Pipe& operator<<( zero::Pipe& out, const char* s );
+zero::Pipe& operator<<( zero::Pipe& out, const zero::FlashString s );
 
 
 #endif
@@ -9,6 +9,9 @@
 #ifdef ZERO_DRIVERS_PIPE
 
 
+#include <string.h>
+#include <avr/pgmspace.h>
+
 #include "pipe.h"
 
 
@@ -21,10 +24,15 @@ zero::Pipe& operator<<( zero::Pipe& out, const char c )
 
 zero::Pipe& operator<<( zero::Pipe& out, const char* s )
 {
-    while ( *s ) {
-        out.write( *s++ );
-    }
+    out.write( (const uint8_t*) s, strlen( s ) );
+    return out;
+}
 
+
+// writes a string straight from Flash, for example `pipe << FSTR( "Hello" )`
+zero::Pipe& operator<<( zero::Pipe& out, const zero::FlashString s )
+{
+    out.write( (const uint8_t*) s.s, strlen_P( s.s ), true );
     return out;
 }
 
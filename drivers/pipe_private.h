@@ -14,6 +14,10 @@ private:
     Pipe( const Pipe& p ) = delete;
     void operator=( const Pipe& p ) = delete;
 
+    void waitForData();
+    void dataAdded( const uint16_t lengthBefore );
+    void roomAdded();
+
     uint8_t* const _buffer{ nullptr };
     uint16_t _bufferSize;
     uint16_t _startIndex{ 0 };
@@ -24,3 +28,8 @@ private:
 
     PipeFilter _readFilter{ nullptr };
     PipeFilter _writeFilter{ nullptr };
+
+    uint16_t _dataWatermark{ 1 };
+    uint16_t _roomWatermark{ 1 };
+    uint16_t _idleMs{ 0 };
+    uint16_t _lastWriteMs{ 0 };                         // low 16 bits of Thread::now()
@@ -0,0 +1,385 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_SPI
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <util/atomic.h>
+
+#include "spi.h"
+#include "spibus.h"
+#include "thread.h"
+#include "resource.h"
+#include "trace.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    // SPR1:0 and SPI2X for each SpiClock
+    const uint8_t CLOCK_SPR[]{ 0, 0, 1, 1, 2, 2, 3 };
+    const bool CLOCK_2X[]{ true, false, true, false, true, false, false };
+
+    const uint8_t FILL_BYTE{ 0xFF };                    // sent when a transaction has nothing to send
+
+    volatile const uint8_t* _txCursor{ nullptr };
+    volatile uint8_t* _rxCursor{ nullptr };
+    volatile uint32_t _xferBytes{ 0UL };
+
+    uint8_t _numDevices{ 0 };                           // SpiDevice objects sharing the bus
+    const SpiDevice* _configuredFor{ nullptr };         // the device SPCR is set up for
+    SpiTransaction* _curXfer{ nullptr };                // the transaction on the bus right now
+    SpiTransaction* _queueHead{ nullptr };              // transactions waiting for the bus
+    SpiTransaction* _queueTail{ nullptr };
+
+
+    // switches the SPI transfer-complete ISR on and off
+    void setSpiIsrEnable( const bool en )
+    {
+        if ( en ) {
+            SPCR |= ( 1 << SPIE );
+        }
+        else {
+            SPCR &= ~( 1 << SPIE );
+        }
+    }
+
+
+    // busy-poll exchanges one byte over SPI
+    uint8_t spiXfer( const uint8_t c )
+    {
+        SPDR = c;
+
+        while ( !( SPSR & ( 1 << SPIF ) ) ) {
+            // empty
+        }
+
+        return SPDR;
+    }
+
+}    // namespace
+
+
+/// @brief Creates a new SpiDevice on the shared SPI bus
+/// @param chipSelect A Gpio object representing the chip select line of the device.
+/// @param clock Optional. Default: `SpiClock::Div2`. The SPI clock to use when talking
+/// to this device.
+/// @param mode Optional. Default: `SpiMode::Mode0`. The clock polarity and phase to use
+/// when talking to this device.
+/// @param lsbFirst Optional. Default: `false`. If `true`, bytes are sent least significant
+/// bit first.
+/// @note The first SpiDevice claims the SPI peripheral (`ResourceId::Spi`), and the last
+/// one to be destroyed gives it back.
+SpiDevice::SpiDevice(
+    Gpio& chipSelect,
+    const SpiClock clock,
+    const SpiMode mode,
+    const bool lsbFirst )
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        // the first device claims the bus, the rest share it
+        if ( !_numDevices and !resource::obtain( resource::ResourceId::Spi ) ) {
+            return;
+        }
+
+        _chipSelectPin = &chipSelect;
+        _chipSelectPin->setAsOutput();
+
+        // make sure it's not selected
+        deselect();
+
+        // work out the registers for when it's this device's turn
+        const uint8_t modeBits{ (uint8_t) mode };
+
+        _spcr = ( 1 << SPE ) | ( 1 << MSTR ) | CLOCK_SPR[ (uint8_t) clock ];
+        _spcr |= ( modeBits & 1 ) ? ( 1 << CPHA ) : 0;
+        _spcr |= ( modeBits & 2 ) ? ( 1 << CPOL ) : 0;
+        _spcr |= lsbFirst ? ( 1 << DORD ) : 0;
+        _spsr = CLOCK_2X[ (uint8_t) clock ] ? ( 1 << SPI2X ) : 0;
+
+        if ( !_numDevices ) {
+            // setup the SPI GPIO
+            SPI_DDR |= ( SCLK | MOSI );
+            SPI_DDR &= ~MISO;
+
+            // make sure ISRs for SPI are off
+            setSpiIsrEnable( false );
+        }
+
+        _numDevices++;
+    }
+}
+
+
+// dtor
+SpiDevice::~SpiDevice()
+{
+    if ( *this ) {
+        ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+            if ( _configuredFor == this ) {
+                _configuredFor = nullptr;
+            }
+
+            // the last one out switches off the SPI hardware
+            if ( !--_numDevices ) {
+                // stop interrupting me!
+                setSpiIsrEnable( false );
+
+                SPCR = 0;
+                SPSR = 0;
+
+                // free the resource
+                resource::release( resource::ResourceId::Spi );
+            }
+
+            // return the CS line to floating
+            _chipSelectPin->reset();
+        }
+    }
+}
+
+
+/// @brief Determines if the SpiDevice initialized correctly
+/// @returns `true` if the SpiDevice correctly initialized, `false` otherwise.
+SpiDevice::operator bool() const
+{
+    return _chipSelectPin;
+}
+
+
+/// @brief Queues a transaction, behind any others already waiting for the SPI bus
+/// @param t The transaction to queue.
+/// @returns `true` if the transaction was queued, `false` if it was empty, too long a
+/// command, or already queued.
+/// @note Never blocks. The transaction's Synapse is signalled once it is complete.
+/// @note If the bus is idle, a Thread queueing a transaction of `SPI_POLL_MAX_BYTES` (see
+/// the `makefile`) or fewer runs it straight away in a polled loop, so it's complete
+/// by the time this returns. Interrupts stay on, and the Thread may be pre-empted.
+/// Longer transactions, and those queued from ISRs, run from the SPI ISR.
+/// @note May be called from within an ISR.
+bool SpiDevice::queue( SpiTransaction& t )
+{
+    if ( !*this or ( !t.numBytes and !t.commandBytes ) or t.commandBytes > SPI_MAX_COMMAND_BYTES ) {
+        return false;
+    }
+
+    // If interrupts are on, we're being called from a Thread, which can
+    // afford to run a short transaction itself.
+    const bool fromThread{ !!( SREG & ( 1 << SREG_I ) ) };
+    bool poll{ false };
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( t.pending ) {
+            return false;
+        }
+
+        t.device = this;
+        t.pending = true;
+        t.next = nullptr;
+
+        if ( _curXfer ) {
+            // the ISR will get to it
+            if ( _queueTail ) {
+                _queueTail->next = &t;
+            }
+            else {
+                _queueHead = &t;
+            }
+
+            _queueTail = &t;
+        }
+        else if ( fromThread and t.numBytes <= SPI_POLL_MAX_BYTES ) {
+            // claim the bus, so that anyone else queues up behind us
+            _curXfer = &t;
+            poll = true;
+        }
+        else if ( !startTransaction( t ) ) {
+            // nothing for the ISR to do, so it's done already
+            transferComplete();
+        }
+    }
+
+    if ( poll ) {
+        pollTransaction( t );
+    }
+
+    return true;
+}
+
+
+// select the chip, by pulling CS low
+void SpiDevice::select() const
+{
+    _chipSelectPin->switchOff();
+}
+
+
+// deselect the chip, by pulling CS high
+void SpiDevice::deselect() const
+{
+    _chipSelectPin->switchOn();
+}
+
+
+// Sets the bus up for this device, unless it already is. Leaves the ISR off.
+void SpiDevice::configureBus() const
+{
+    if ( _configuredFor != this ) {
+        SPCR = _spcr;
+        SPSR = _spsr;
+        _configuredFor = this;
+    }
+    else {
+        setSpiIsrEnable( false );
+    }
+}
+
+
+// Puts a transaction on the bus, sending its command straight away. Returns
+// true if there's data for the ISR to carry on with. Interrupts must already
+// be off.
+bool SpiDevice::startTransaction( SpiTransaction& t )
+{
+    _curXfer = &t;
+
+    // the command goes out polled, so keep the ISR out of it
+    t.device->configureBus();
+    t.device->select();
+
+    for ( uint8_t i = 0; i < t.commandBytes; i++ ) {
+        spiXfer( t.command[ i ] );
+    }
+
+    // set up the housekeeping
+    _txCursor = (const uint8_t*) t.txBuffer;
+    _rxCursor = (uint8_t*) t.rxBuffer;
+    _xferBytes = t.numBytes;
+
+    if ( !_xferBytes ) {
+        return false;
+    }
+
+    // enable the ISR
+    setSpiIsrEnable( true );
+
+    // push the first one out to kickstart it
+    SPDR = _txCursor ? *_txCursor++ : FILL_BYTE;
+
+    return true;
+}
+
+
+// Runs a whole transaction in a tight polled loop, with interrupts on
+// between bytes, then hands the bus on. The caller must already have
+// claimed the bus. Saves an ISR entry and exit (which at full speed
+// takes longer than the byte itself) for every byte.
+void SpiDevice::pollTransaction( SpiTransaction& t )
+{
+    const uint8_t* txCursor{ (const uint8_t*) t.txBuffer };
+    uint8_t* rxCursor{ (uint8_t*) t.rxBuffer };
+    uint32_t remaining{ t.numBytes };
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        t.device->configureBus();
+    }
+
+    t.device->select();
+
+    for ( uint8_t i = 0; i < t.commandBytes; i++ ) {
+        spiXfer( t.command[ i ] );
+    }
+
+    while ( remaining-- ) {
+        const uint8_t rxByte{ spiXfer( txCursor ? *txCursor++ : FILL_BYTE ) };
+
+        if ( rxCursor ) {
+            *rxCursor++ = rxByte;
+        }
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        transferComplete();
+    }
+}
+
+
+// Finishes with the transaction on the bus. Interrupts must already be off.
+void SpiDevice::finishTransaction()
+{
+    SpiTransaction* const done{ _curXfer };
+
+    done->device->deselect();
+    done->pending = false;
+    _curXfer = nullptr;
+
+    if ( done->doneSyn ) {
+        done->doneSyn->signal();
+    }
+}
+
+
+// Finishes with the transaction that's just completed, and chains straight
+// into the next one (if there is one). Called by the ISR, and with
+// interrupts off.
+void SpiDevice::transferComplete()
+{
+    finishTransaction();
+
+    while ( SpiTransaction* const t = _queueHead ) {
+        _queueHead = t->next;
+
+        if ( !_queueHead ) {
+            _queueTail = nullptr;
+        }
+
+        if ( startTransaction( *t ) ) {
+            return;
+        }
+
+        // a command with no data is over as soon as it's sent
+        finishTransaction();
+    }
+
+    setSpiIsrEnable( false );
+}
+
+
+// This ISR is run whenever the SPI hardware finishes exchanging a single byte
+ISR( SPI_STC_vect )
+{
+    trace_isr( SPI_STC_vect_num );
+
+    // capture the input
+    const uint8_t rxByte{ SPDR };
+
+    // another 1 bytes the dust
+    _xferBytes--;
+
+    // if there's more data to transfer, send the correct output
+    if ( _xferBytes ) {
+        SPDR = _txCursor ? *_txCursor++ : FILL_BYTE;
+    }
+
+    // remember the received byte
+    if ( _rxCursor ) {
+        *_rxCursor++ = rxByte;
+    }
+
+    // move on if we're done
+    if ( !_xferBytes ) {
+        SpiDevice::transferComplete();
+    }
+}
+
+
+#endif
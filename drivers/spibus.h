@@ -0,0 +1,133 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_SPI
+
+
+#ifndef TCRI_ZERO_SPIBUS_H
+#define TCRI_ZERO_SPIBUS_H
+
+
+#include <stdint.h>
+
+#include "thread.h"
+#include "gpio.h"
+
+
+namespace zero {
+
+    class SpiDevice;
+
+
+    /// @brief The SPI clock, as a fraction of the CPU clock
+    enum class SpiClock : uint8_t {
+        Div2 = 0,
+        Div4,
+        Div8,
+        Div16,
+        Div32,
+        Div64,
+        Div128,
+    };
+
+
+    /// @brief The SPI clock polarity and phase
+    enum class SpiMode : uint8_t {
+        /// Clock idles low, data sampled on the rising edge
+        Mode0 = 0,
+
+        /// Clock idles low, data sampled on the falling edge
+        Mode1,
+
+        /// Clock idles high, data sampled on the falling edge
+        Mode2,
+
+        /// Clock idles high, data sampled on the rising edge
+        Mode3,
+    };
+
+
+    /// @brief The most command bytes a SpiTransaction can carry
+    const uint8_t SPI_MAX_COMMAND_BYTES{ 5 };
+
+
+    /// @brief One exchange with a SpiDevice, waiting in the queue for the SPI bus
+    /// @details With the device selected, the command bytes go out first (anything
+    /// received meanwhile is discarded), then `numBytes` are exchanged - taken from
+    /// `txBuffer` and stored in `rxBuffer`.
+    /// @note The transaction, and the buffers it points to, belong to the caller and
+    /// must stay put until the transaction's Synapse is signalled.
+    struct SpiTransaction {
+        /// Bytes to send before the data, for example an opcode and an address
+        uint8_t command[ SPI_MAX_COMMAND_BYTES ];
+
+        /// The number of command bytes to send
+        uint8_t commandBytes;
+
+        /// The data to send, or `nullptr` to send `0xFF`s
+        const void* txBuffer;
+
+        /// The place to store the data received, or `nullptr` to discard it
+        void* rxBuffer;
+
+        /// The number of data bytes to exchange
+        uint32_t numBytes;
+
+        /// Optional. The Synapse to signal once the transaction is complete
+        const Synapse* doneSyn;
+
+        /// @private
+        SpiDevice* device;
+
+        /// @private
+        volatile bool pending;
+
+        /// @private
+        SpiTransaction* next;
+    };
+
+
+    /// @brief A chip on the shared SPI bus, with its own chip select, clock and mode
+    /// @details Every SpiDevice shares the one SPI peripheral. Transactions from all of
+    /// them go into a single queue, and when one finishes, the SPI ISR starts the next
+    /// straight away - so the bus stays busy and nobody spins waiting for it. The bus is
+    /// reconfigured only when the next transaction is for a different device.
+    /// @code
+    /// Gpio cs{ ZERO_PINB2 };
+    /// SpiDevice radio{ cs, SpiClock::Div8, SpiMode::Mode0 };
+    ///
+    /// Synapse doneSyn;
+    /// uint8_t status;
+    /// SpiTransaction t{ { 0x07 }, 1, nullptr, &status, 1, &doneSyn };
+    ///
+    /// if ( radio.queue( t ) ) {
+    ///     doneSyn.wait();
+    /// }
+    /// @endcode
+    class SpiDevice {
+    public:
+        SpiDevice(
+            Gpio& chipSelect,                           // Gpio object for the CS line
+            const SpiClock clock = SpiClock::Div2,      // the speed of the bus, for this device
+            const SpiMode mode = SpiMode::Mode0,        // the clock polarity and phase, for this device
+            const bool lsbFirst = false );              // send the least significant bit first?
+
+        bool queue( SpiTransaction& t );                // queues a transaction, never blocks
+
+        explicit operator bool() const;
+
+        #include "spibus_private.h"
+    };
+
+}    // namespace zero
+
+
+#endif
+
+
+#endif
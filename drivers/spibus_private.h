@@ -0,0 +1,28 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    ~SpiDevice();
+    static void transferComplete();
+
+private:
+    SpiDevice( const SpiDevice& d ) = delete;
+    void operator=( const SpiDevice& d ) = delete;
+
+    void select() const;
+    void deselect() const;
+    void configureBus() const;
+
+    static bool startTransaction( SpiTransaction& t );
+    static void pollTransaction( SpiTransaction& t );
+    static void finishTransaction();
+
+    Gpio* _chipSelectPin{ nullptr };
+    uint8_t _spcr{ 0 };                                 // SPCR for this device, less SPIE
+    uint8_t _spsr{ 0 };                                 // SPSR for this device (just SPI2X)
@@ -9,15 +9,16 @@
 #ifdef ZERO_DRIVERS_SPIMEM
 
 
-#include <avr/io.h>
-#include <avr/interrupt.h>
+#ifndef ZERO_DRIVERS_SPI
+    #error "ZERO_DRIVERS_SPIMEM needs ZERO_DRIVERS_SPI for the shared SPI bus"
+#endif
+
 
 #include <util/atomic.h>
 
-#include "spi.h"
 #include "sram.h"
+#include "spibus.h"
 #include "thread.h"
-#include "resource.h"
 
 
 using namespace zero;
@@ -25,48 +26,9 @@ using namespace zero;
 
 namespace {
 
-    enum class SpiXferMode {
-        Tx,
-        Rx,
-    };
-
-
     const uint8_t CMD_READ{ 3 };
     const uint8_t CMD_WRITE{ 2 };
 
-    auto _spiXferMode{ SpiXferMode::Tx };
-    volatile uint8_t* _txCursor{ nullptr };
-    volatile uint8_t* _rxCursor{ nullptr };
-    volatile uint32_t _xferBytes{ 0UL };
-
-    const Synapse* _spiReadySyn{ nullptr };
-    SpiMemory* _curController{ nullptr };
-
-
-    // switches the SPI transfer-complete ISR on and off
-    void setSpiIsrEnable( const bool en )
-    {
-        if ( en ) {
-            SPCR |= ( 1 << SPIE );
-        }
-        else {
-            SPCR &= ~( 1 << SPIE );
-        }
-    }
-
-
-    // busy-poll exchanges one byte over SPI
-    uint8_t spiXfer( const uint8_t c )
-    {
-        SPDR = c;
-
-        while ( !( SPSR & ( 1 << SPIF ) ) ) {
-            // empty
-        }
-
-        return SPDR;
-    }
-
 }    // namespace
 
 
@@ -74,65 +36,31 @@ namespace {
 /// @param capacityBytes The total size of the external memory chip, in bytes.
 /// @param chipSelect A Gpio object representing the chip select line of the memory chip.
 /// @param readySyn The Synapse to signal when a memory transfer is complete.
+/// @note Several SpiMemory objects (one per chip) may share the SPI bus, along with any
+/// other SpiDevice.
 SpiMemory::SpiMemory(
     const uint32_t capacityBytes,                       // how many bytes does the chip hold?
     Gpio& chipSelect,                                   // Gpio object for the CS line
     const Synapse& readySyn )                           // Synapse to fire when ready to transfer
 :
-    _capacityBytes{ capacityBytes }
+    _capacityBytes{ capacityBytes },
+    _device{ chipSelect }                               // full-speed, mode 0, kkplzthx
 {
-    if ( !resource::obtain( resource::ResourceId::Spi ) ) {
-        return;
+    if ( _device ) {
+        // signal the Synapse that we're ready to go
+        _readySyn = &readySyn;
+        _readySyn->signal();
     }
-
-    _chipSelectPin = &chipSelect;
-    _chipSelectPin->setAsOutput();
-
-    // setup the SPI GPIO
-    SPI_DDR |= ( SCLK | MOSI );
-    SPI_DDR &= ~MISO;
-
-    // make sure it's not selected
-    deselect();
-
-    // make sure ISRs for SPI are off
-    setSpiIsrEnable( false );
-
-    // full-speed MASTER mode SPI, kkplzthx
-    SPCR = ( 1 << SPE ) | ( 1 << MSTR );
-    SPSR |= ( 1 << SPI2X );
-
-    // signal the Synapse that we're ready to go
-    _spiReadySyn = &readySyn;
-    _spiReadySyn->signal();
 }
 
 
 // dtor
 SpiMemory::~SpiMemory()
 {
-    if ( *this ) {
-        // stop interrupting me!
-        setSpiIsrEnable( false );
-
-        // switch off the SPI hardware
-        SPCR = 0;
-        SPSR = 0;
-
-        // return the CS line to floating
-        if ( _chipSelectPin ) {
-            _chipSelectPin->reset();
-        }
-
-
-        // clear signals and forget
-        if ( _spiReadySyn ) {
-            _spiReadySyn->clearSignals();
-            _spiReadySyn = nullptr;
-        }
-
-        // free the resource
-        resource::release( resource::ResourceId::Spi );
+    // clear signals and forget
+    if ( _readySyn ) {
+        _readySyn->clearSignals();
+        _readySyn = nullptr;
     }
 }
 
@@ -141,21 +69,15 @@ SpiMemory::~SpiMemory()
 /// @returns `true` if the SpiMemory correctly initialized, `false` otherwise.
 SpiMemory::operator bool() const
 {
-    return _chipSelectPin;
-}
-
-
-// select the chip, by pulling CS low
-void SpiMemory::select() const
-{
-    _chipSelectPin->switchOff();
+    return (bool) _device;
 }
 
 
-// deselect the chip, by pulling CS high
-void SpiMemory::deselect() const
+/// @brief Gets the size of the external memory chip
+/// @returns The capacity given when the SpiMemory was created, in bytes.
+uint32_t SpiMemory::getCapacity() const
 {
-    _chipSelectPin->switchOn();
+    return _capacityBytes;
 }
 
 
@@ -163,43 +85,17 @@ void SpiMemory::deselect() const
 /// @param dest A pointer to local SRAM where the incoming should be placed.
 /// @param srcAddr The address in external memory for the source of the copy.
 /// @param numBytes The total number of bytes to transfer.
-void SpiMemory::read(
+/// @returns `true` if the transfer was queued, `false` if `dest` is `nullptr` or
+/// `numBytes` is zero (the ready Synapse is signalled straight away).
+/// @note Returns once the transfer is queued. The ready Synapse is signalled when it
+/// is complete. If this SpiMemory's previous read() or write() is still going, this
+/// waits for it (sleeping, not spinning) first.
+bool SpiMemory::read(
     void* dest,                                         // destination address, in local SRAM
     const uint32_t srcAddr,                             // source address for the data, in external SPI memory
     const uint32_t numBytes )                           // number of bytes to read
 {
-    // wait until there's no controller using the SPI
-    while ( _curController ) {
-        // empty
-    }
-
-    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
-        // tell the ISR who we are
-        _curController = this;
-
-        // make sure no-one falls through while we're working
-        if ( _spiReadySyn ) {
-            _spiReadySyn->clearSignals();
-        }
-
-        // set up the housekeeping
-        _txCursor = nullptr;                            // we are reading data, so no TX buffer
-        _rxCursor = (uint8_t*) dest;
-        _xferBytes = numBytes;
-        _spiXferMode = SpiXferMode::Rx;
-
-        // tell the SPI chip that we want to talk to it
-        select();
-
-        // tell it that we want to read data from srcAddress
-        sendReadCommand( srcAddr );
-
-        // enable the ISR
-        setSpiIsrEnable( true );
-
-        // push the first one out to kickstart it
-        SPDR = 0;
-    }
+    return transfer( SpiDirection::Read, dest, srcAddr, numBytes );
 }
 
 
@@ -207,120 +103,100 @@ void SpiMemory::read(
 /// @param src A pointer to local SRAM for the source of the copy.
 /// @param destAddr The address in external memory to which the data should be copied.
 /// @param numBytes The total number of bytes to transfer.
-void SpiMemory::write(
+/// @returns `true` if the transfer was queued, `false` if `src` is `nullptr` or
+/// `numBytes` is zero (the ready Synapse is signalled straight away).
+/// @note Returns once the transfer is queued. The ready Synapse is signalled when it
+/// is complete. If this SpiMemory's previous read() or write() is still going, this
+/// waits for it (sleeping, not spinning) first.
+bool SpiMemory::write(
     const void* src,                                    // source data address, in local SRAM
     const uint32_t destAddr,                            // destination address, in external SPI memory
     const uint32_t numBytes )                           // number of the bytes to write
 {
-    // wait until there's no controller using the SPI
-    while ( _curController ) {
-        // empty
-    }
+    return transfer( SpiDirection::Write, (void*) src, destAddr, numBytes );
+}
 
+
+// Queues the SpiMemory's own transaction, for read() and write(). If it
+// can't be queued, the ready Synapse is signalled again, so that nobody
+// waiting on it is left hanging.
+bool SpiMemory::transfer(
+    const SpiDirection direction,
+    void* const buffer,
+    const uint32_t address,
+    const uint32_t numBytes )
+{
     ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
-        // tell the ISR who we are
-        _curController = this;
+        // there's only one of these per SpiMemory, so wait for the last to be done with
+        while ( _xfer.bus.pending and _readySyn ) {
+            _readySyn->wait();
+            cli();
+        }
 
         // make sure no-one falls through while we're working
-        if ( _spiReadySyn ) {
-            _spiReadySyn->clearSignals();
+        if ( _readySyn ) {
+            _readySyn->clearSignals();
         }
 
-        // set up the housekeeping
-        _rxCursor = nullptr;                            // writing means no RX buffer
-        _txCursor = (uint8_t*) src;
-        _xferBytes = numBytes;
-        _spiXferMode = SpiXferMode::Tx;
-
-        // tell the SPI chip that we want to talk to it
-        select();
-
-        // tell it that we want to write data to destAddress
-        sendWriteCommand( destAddr );
-
-        // enable the ISR
-        setSpiIsrEnable( true );
-
-        // push the first one out to kickstart it
-        SPDR = *_txCursor++;
-    }
-}
-
-
-// This ISR is run whenever the SPI hardware finishes exchanging a single byte
-ISR( SPI_STC_vect )
-{
-    uint8_t rxByte{ 0 };
-    bool storeRxByte{ false };
-
-    // capture the input
-    if ( _spiXferMode == SpiXferMode::Rx ) {
-        rxByte = SPDR;
-        storeRxByte = true;
+        _xfer.buffer = buffer;
+        _xfer.address = address;
+        _xfer.numBytes = numBytes;
+        _xfer.direction = direction;
+        _xfer.doneSyn = _readySyn;
     }
 
-    // another 1 bytes the dust
-    _xferBytes--;
-
-    // if there's more data to transfer...
-    if ( _xferBytes ) {
-        // send the correct output
-        if ( _spiXferMode == SpiXferMode::Tx ) {
-            SPDR = *_txCursor++;
+    // outside the atomic block, so that short transfers can be polled
+    if ( !queue( _xfer ) ) {
+        if ( _readySyn ) {
+            _readySyn->signal();
         }
-        else {
-            SPDR = 0;
-        }
-    }
 
-    // remember the received byte
-    if ( storeRxByte ) {
-        *_rxCursor++ = rxByte;
+        return false;
     }
 
-    // disable things if we're done
-    if ( !_xferBytes ) {
-        setSpiIsrEnable( false );
+    return true;
+}
 
-        if ( _spiReadySyn ) {
-            _spiReadySyn->signal();
-        }
 
-        _curController->deselect();
-        _curController = nullptr;
+/// @brief Queues a transfer, behind any others already waiting for the SPI bus
+/// @param t The transaction to queue.
+/// @returns `true` if the transaction was queued, `false` if it was empty or already
+/// queued.
+/// @note Never blocks. The transaction's Synapse is signalled once the data has been
+/// transferred.
+/// @note Short transfers may be polled, and complete before this returns - see
+/// SpiDevice::queue().
+/// @note May be called from within an ISR.
+bool SpiMemory::queue( SpiMemoryTransaction& t )
+{
+    if ( !*this or !t.buffer or !t.numBytes or t.bus.pending ) {
+        return false;
     }
-}
 
+    SpiTransaction& b{ t.bus };
+    uint8_t n{ 0 };
+
+    // the command, and as many address bytes as the chip needs
+    b.command[ n++ ] = ( t.direction == SpiDirection::Read ) ? CMD_READ : CMD_WRITE;
 
-// sends an address to the memory chip
-void SpiMemory::sendAddress( const uint32_t addr ) const
-{
     if ( _capacityBytes > ( 1UL << 24 ) ) {
-        spiXfer( addr >> 24 );
+        b.command[ n++ ] = t.address >> 24;
     }
 
     if ( _capacityBytes > ( 1UL << 16 ) ) {
-        spiXfer( addr >> 16 );
+        b.command[ n++ ] = t.address >> 16;
     }
 
-    spiXfer( addr >> 8 );
-    spiXfer( addr >> 0 );
-}
+    b.command[ n++ ] = t.address >> 8;
+    b.command[ n++ ] = t.address >> 0;
+    b.commandBytes = n;
 
+    b.txBuffer = ( t.direction == SpiDirection::Write ) ? t.buffer : nullptr;
+    b.rxBuffer = ( t.direction == SpiDirection::Read ) ? t.buffer : nullptr;
+    b.numBytes = t.numBytes;
+    b.doneSyn = t.doneSyn;
 
-// sends a CMD_READ to the memory chip
-void SpiMemory::sendReadCommand( const uint32_t addr ) const
-{
-    spiXfer( CMD_READ );
-    sendAddress( addr );
-}
-
-
-// sends a CMD_WRITE to the memory chip
-void SpiMemory::sendWriteCommand( const uint32_t addr ) const
-{
-    spiXfer( CMD_WRITE );
-    sendAddress( addr );
+    return _device.queue( b );
 }
 
 
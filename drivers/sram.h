@@ -17,12 +17,58 @@
 
 #include "thread.h"
 #include "gpio.h"
+#include "spibus.h"
 
 
 namespace zero {
 
+    /// @brief Which way a SpiMemoryTransaction moves its data
+    enum class SpiDirection : uint8_t {
+        /// From the external SPI memory into local SRAM
+        Read = 0,
+
+        /// From local SRAM out to the external SPI memory
+        Write,
+    };
+
+
+    /// @brief One transfer in the queue of transfers waiting for the SPI bus
+    /// @note The transaction, and the buffer it points to, belong to the caller and must
+    /// stay put until the transaction's Synapse is signalled.
+    struct SpiMemoryTransaction {
+        /// The local SRAM to read into, or write from
+        void* buffer;
+
+        /// The address in the external SPI memory
+        uint32_t address;
+
+        /// The number of bytes to transfer
+        uint32_t numBytes;
+
+        /// Which way the data goes
+        SpiDirection direction;
+
+        /// Optional. The Synapse to signal once the transfer is complete
+        const Synapse* doneSyn;
+
+        /// @private
+        SpiTransaction bus;
+    };
+
 
     /// @brief Provdes asynchronous SPI memory services
+    /// @details Each SpiMemory is a SpiDevice on the shared SPI bus, so its transfers
+    /// queue up with those of every other chip (memory or otherwise). When a transfer
+    /// finishes, the SPI ISR starts the next one straight away, so the bus stays busy and
+    /// nobody has to spin waiting for it.
+    /// @code
+    /// Synapse doneSyn;
+    /// SpiMemoryTransaction t{ buffer, 0x1000, sizeof( buffer ), SpiDirection::Read, &doneSyn };
+    ///
+    /// if ( mem.queue( t ) ) {
+    ///     doneSyn.wait();
+    /// }
+    /// @endcode
     class SpiMemory {
     public:
         SpiMemory(
@@ -30,16 +76,19 @@ namespace zero {
             Gpio& chipSelect,                           // Gpio object for the CS line
             const Synapse& readySyn );                  // Synapse to fire when ready to transfer
 
-        void read(
+        bool read(
             void* dest,                                 // destination address, in local SRAM
             const uint32_t srcAddr,                     // source address for the data, in external SPI memory
             const uint32_t numBytes );                  // number of bytes to read
 
-        void write(
+        bool write(
             const void* src,                            // source data address, in local SRAM
             const uint32_t destAddress,                 // destination address, in external SPI memory
             const uint32_t numBytes );                  // number of the bytes to write
 
+        bool queue( SpiMemoryTransaction& t );          // queues a transfer, never blocks
+        uint32_t getCapacity() const;                   // size of the chip, in bytes
+
         explicit operator bool() const;
 
         #include "sram_private.h"
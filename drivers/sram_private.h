@@ -9,16 +9,18 @@
 public:
     /// @privatesection
     ~SpiMemory();
-    void select() const;
-    void deselect() const;
 
 private:
     SpiMemory( const SpiMemory& m ) = delete;
     void operator=( const SpiMemory& m ) = delete;
 
-    void sendAddress( const uint32_t addr ) const;
-    void sendReadCommand( const uint32_t addr ) const;
-    void sendWriteCommand( const uint32_t addr ) const;
+    bool transfer(
+        const SpiDirection direction,
+        void* const buffer,
+        const uint32_t address,
+        const uint32_t numBytes );
 
     const uint32_t _capacityBytes{ 0UL };
-    Gpio* _chipSelectPin{ nullptr };
+    SpiDevice _device;
+    const Synapse* _readySyn{ nullptr };
+    SpiMemoryTransaction _xfer{};                       // used by read() and write()
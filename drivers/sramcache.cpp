@@ -0,0 +1,293 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_SPIMEM
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sramcache.h"
+#include "memory.h"
+#include "util.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a cache in front of a SpiMemory, taking its lines from the heap
+/// @param mem The external memory to cache.
+/// @param lineBytes The size of each line. Must be a power of two. Lines start on
+/// addresses that are a multiple of this.
+/// @param numLines The number of lines to hold.
+/// @note Check the cache with `operator bool()` before using it.
+SpiMemoryCache::SpiMemoryCache(
+    SpiMemory& mem,
+    const uint16_t lineBytes,
+    const uint8_t numLines )
+:
+    _mem{ mem },
+    _lineBytes{ lineBytes },
+    _numLines{ numLines },
+    _lines{ ( lineBytes and !( lineBytes & ( lineBytes - 1 ) ) and numLines ) ?
+        (Line*) memory::allocate( numLines * ( sizeof( Line ) + lineBytes ), &_allocatedBytes ) :
+        nullptr }
+{
+    invalidate();
+}
+
+
+/// @brief Writes back every changed line, then gives the cache's memory back to the heap
+SpiMemoryCache::~SpiMemoryCache()
+{
+    if ( *this ) {
+        flush();
+        memory::free( _lines, _allocatedBytes );
+    }
+}
+
+
+/// @brief Determines if the cache got its memory from the heap
+/// @returns `true` if the cache can be used, `false` otherwise.
+SpiMemoryCache::operator bool() const
+{
+    return _lines != nullptr;
+}
+
+
+/// @brief Reads data from external memory, through the cache
+/// @param dest A pointer to local SRAM where the data should be placed.
+/// @param srcAddr The address in external memory to read from.
+/// @param numBytes The number of bytes to read. May span several lines.
+/// @returns `true` if the data was read, `false` otherwise.
+/// @note Blocks while lines are written back or filled.
+bool SpiMemoryCache::read( void* dest, const uint32_t srcAddr, const uint16_t numBytes )
+{
+    uint8_t* cursor{ (uint8_t*) dest };
+    uint32_t address{ srcAddr };
+    uint16_t remaining{ numBytes };
+
+    while ( remaining ) {
+        uint8_t* const line{ getLine( address, false ) };
+
+        if ( !line ) {
+            return false;
+        }
+
+        const uint16_t offset{ (uint16_t) ( address & ( _lineBytes - 1 ) ) };
+        const uint16_t run{ MIN( remaining, (uint16_t) ( _lineBytes - offset ) ) };
+
+        memcpy( cursor, line + offset, run );
+
+        cursor += run;
+        address += run;
+        remaining -= run;
+    }
+
+    return true;
+}
+
+
+/// @brief Writes data to external memory, through the cache
+/// @param src A pointer to local SRAM for the data to write.
+/// @param destAddr The address in external memory to write to.
+/// @param numBytes The number of bytes to write. May span several lines.
+/// @returns `true` if the data was written to the cache, `false` otherwise.
+/// @note The external memory isn't changed until the lines are evicted or flushed.
+/// Lines that are completely overwritten aren't read in first.
+bool SpiMemoryCache::write( const void* src, const uint32_t destAddr, const uint16_t numBytes )
+{
+    const uint8_t* cursor{ (const uint8_t*) src };
+    uint32_t address{ destAddr };
+    uint16_t remaining{ numBytes };
+
+    while ( remaining ) {
+        const uint16_t offset{ (uint16_t) ( address & ( _lineBytes - 1 ) ) };
+        const uint16_t run{ MIN( remaining, (uint16_t) ( _lineBytes - offset ) ) };
+
+        uint8_t* const line{ getLine( address, run == _lineBytes ) };
+
+        if ( !line ) {
+            return false;
+        }
+
+        memcpy( line + offset, cursor, run );
+        _lines[ _lastLine ].dirty = true;
+
+        cursor += run;
+        address += run;
+        remaining -= run;
+    }
+
+    return true;
+}
+
+
+/// @brief Writes every changed line back to the external memory
+/// @returns `true` if everything was written back, `false` otherwise.
+/// @note Blocks until the writes are complete. The lines stay in the cache.
+bool SpiMemoryCache::flush()
+{
+    if ( !*this ) {
+        return false;
+    }
+
+    bool rc{ true };
+
+    for ( uint8_t i = 0; i < _numLines; i++ ) {
+        if ( !writeBack( i ) ) {
+            rc = false;
+        }
+    }
+
+    return rc;
+}
+
+
+/// @brief Forgets every line in the cache
+/// @note Changed lines are **not** written back - call flush() first to keep them.
+void SpiMemoryCache::invalidate()
+{
+    if ( *this ) {
+        for ( uint8_t i = 0; i < _numLines; i++ ) {
+            _lines[ i ].valid = false;
+            _lines[ i ].dirty = false;
+        }
+    }
+}
+
+
+/// @brief Gets the number of line lookups that were served from the cache
+/// @returns The number of hits since the cache was created.
+uint32_t SpiMemoryCache::getHitCount() const
+{
+    return _hits;
+}
+
+
+/// @brief Gets the number of line lookups that needed a line to be brought in
+/// @returns The number of misses since the cache was created.
+uint32_t SpiMemoryCache::getMissCount() const
+{
+    return _misses;
+}
+
+
+// Finds the line holding an address, bringing it in (and evicting the least
+// recently used line) if needed. If the caller is going to overwrite the
+// whole line, it isn't read from the external memory first.
+uint8_t* SpiMemoryCache::getLine( const uint32_t address, const bool willOverwrite )
+{
+    if ( !*this ) {
+        return nullptr;
+    }
+
+    const uint32_t tag{ address & ~( (uint32_t) _lineBytes - 1 ) };
+    _useClock++;
+
+    // most accesses land on the same line as the last one
+    if ( _lines[ _lastLine ].valid and _lines[ _lastLine ].tag == tag ) {
+        _hits++;
+        _lines[ _lastLine ].lastUse = _useClock;
+        return getLineData( _lastLine );
+    }
+
+    uint8_t victim{ 0 };
+    uint16_t victimAge{ 0 };
+
+    for ( uint8_t i = 0; i < _numLines; i++ ) {
+        Line& l{ _lines[ i ] };
+
+        if ( l.valid and l.tag == tag ) {
+            _hits++;
+            _lastLine = i;
+            l.lastUse = _useClock;
+            return getLineData( i );
+        }
+
+        // an empty line beats any line in use
+        const uint16_t age{ l.valid ? (uint16_t) ( _useClock - l.lastUse ) : (uint16_t) 0xFFFF };
+
+        if ( age >= victimAge ) {
+            victim = i;
+            victimAge = age;
+        }
+    }
+
+    // a miss - make room, and bring the line in
+    _misses++;
+
+    if ( !writeBack( victim ) ) {
+        return nullptr;
+    }
+
+    Line& l{ _lines[ victim ] };
+    l.tag = tag;
+    l.valid = false;
+
+    if ( !willOverwrite and !transfer( SpiDirection::Read, victim ) ) {
+        return nullptr;
+    }
+
+    l.valid = true;
+    l.lastUse = _useClock;
+    _lastLine = victim;
+
+    return getLineData( victim );
+}
+
+
+// Gets the cached data of a line, which lives after all of the line details
+uint8_t* SpiMemoryCache::getLineData( const uint8_t index ) const
+{
+    return ( (uint8_t*) &_lines[ _numLines ] ) + ( index * _lineBytes );
+}
+
+
+// Writes a line back to the external memory, if it has been changed
+bool SpiMemoryCache::writeBack( const uint8_t index )
+{
+    Line& l{ _lines[ index ] };
+
+    if ( !l.valid or !l.dirty ) {
+        return true;
+    }
+
+    if ( !transfer( SpiDirection::Write, index ) ) {
+        return false;
+    }
+
+    l.dirty = false;
+
+    return true;
+}
+
+
+// Moves a whole line between the cache and the external memory, and
+// waits for it to get there
+bool SpiMemoryCache::transfer( const SpiDirection direction, const uint8_t index )
+{
+    _xfer.buffer = getLineData( index );
+    _xfer.address = _lines[ index ].tag;
+    _xfer.numBytes = _lineBytes;
+    _xfer.direction = direction;
+    _xfer.doneSyn = &_doneSyn;
+
+    _doneSyn.clearSignals();
+
+    if ( !_mem.queue( _xfer ) ) {
+        return false;
+    }
+
+    _doneSyn.wait();
+
+    return true;
+}
+
+
+#endif
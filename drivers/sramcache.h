@@ -0,0 +1,99 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_SPIMEM
+
+
+#ifndef TCRI_ZERO_SRAMCACHE_H
+#define TCRI_ZERO_SRAMCACHE_H
+
+
+#include <stdint.h>
+
+#include "thread.h"
+#include "sram.h"
+
+
+namespace zero {
+
+    /// @brief A write-back cache, in local SRAM, in front of a SpiMemory
+    /// @details The cache holds a number of lines, each a copy of an aligned run of the
+    /// external memory. Reads and writes that hit a cached line cost a memcpy() instead
+    /// of a command, an address and the data over SPI. On a miss, the least recently
+    /// used line is written back (if it was changed) and refilled in one transfer.
+    /// Changes reach the external memory only when a line is evicted, or on flush().
+    /// @code
+    /// SpiMemoryCache cache{ mem, 32, 8 };
+    ///
+    /// if ( cache ) {
+    ///     uint16_t count;
+    ///
+    ///     cache.get( 0x100, count );
+    ///     cache.put( 0x100, count + 1 );
+    ///     cache.flush();
+    /// }
+    /// @endcode
+    /// @note A cache belongs to the Thread that creates it, and must only be used by
+    /// that Thread. Other users of the same SpiMemory will not see changes until they
+    /// are flushed.
+    class SpiMemoryCache {
+    public:
+        SpiMemoryCache(
+            SpiMemory& mem,                             // the external memory to cache
+            const uint16_t lineBytes,                   // size of each line, a power of two
+            const uint8_t numLines );                   // number of lines to cache
+        ~SpiMemoryCache();
+
+        explicit operator bool() const;                 // Determines if the cache got its memory
+
+        bool read(
+            void* dest,                                 // destination address, in local SRAM
+            const uint32_t srcAddr,                     // source address, in external SPI memory
+            const uint16_t numBytes );                  // number of bytes to read
+
+        bool write(
+            const void* src,                            // source data address, in local SRAM
+            const uint32_t destAddr,                    // destination address, in external SPI memory
+            const uint16_t numBytes );                  // number of bytes to write
+
+        /// @brief Reads a value of any type through the cache
+        /// @param address The address of the value, in external SPI memory.
+        /// @param value A reference to the place to store the value.
+        /// @returns `true` if the value was read, `false` otherwise.
+        template <class T>
+        bool get( const uint32_t address, T& value )
+        {
+            return read( &value, address, sizeof( T ) );
+        }
+
+        /// @brief Writes a value of any type through the cache
+        /// @param address The address of the value, in external SPI memory.
+        /// @param value The value to write.
+        /// @returns `true` if the value was written, `false` otherwise.
+        template <class T>
+        bool put( const uint32_t address, const T& value )
+        {
+            return write( &value, address, sizeof( T ) );
+        }
+
+        bool flush();                                   // writes every changed line back
+        void invalidate();                              // forgets every line, changed or not
+
+        uint32_t getHitCount() const;                   // accesses served from the cache
+        uint32_t getMissCount() const;                  // accesses that needed a line filled
+
+        #include "sramcache_private.h"
+    };
+
+}    // namespace zero
+
+
+#endif
+
+
+#endif
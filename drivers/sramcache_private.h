@@ -0,0 +1,37 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    struct Line {
+        uint32_t tag;                                   // external address of the first byte
+        uint16_t lastUse;                               // when the line was last touched
+        bool valid;
+        bool dirty;
+    };
+
+private:
+    SpiMemoryCache( const SpiMemoryCache& c ) = delete;
+    void operator=( const SpiMemoryCache& c ) = delete;
+
+    uint8_t* getLine( const uint32_t address, const bool willOverwrite );
+    uint8_t* getLineData( const uint8_t index ) const;
+    bool writeBack( const uint8_t index );
+    bool transfer( const SpiDirection direction, const uint8_t index );
+
+    SpiMemory& _mem;
+    const uint16_t _lineBytes;
+    const uint8_t _numLines;
+    uint16_t _allocatedBytes{ 0 };                      // declared before _lines, whose initialiser sets it
+    Line* const _lines;                                 // the line details, followed by their data
+    uint8_t _lastLine{ 0 };                             // the line most recently hit
+    uint16_t _useClock{ 0 };                            // ticks once per access, for picking the LRU line
+    uint32_t _hits{ 0UL };
+    uint32_t _misses{ 0UL };
+    Synapse _doneSyn;
+    SpiMemoryTransaction _xfer{};
@@ -0,0 +1,327 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_SPIMEM
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sramlog.h"
+#include "memory.h"
+#include "util.h"
+
+
+using namespace zero;
+
+
+namespace {
+
+    // Works out how much of the chip the log gets - a whole number of pages
+    uint32_t getRegionBytes(
+        const SpiMemory& mem,
+        const uint16_t pageBytes,
+        const uint32_t baseAddr,
+        const uint32_t regionBytes )
+    {
+        const uint32_t capacity{ mem.getCapacity() };
+
+        if ( !pageBytes or baseAddr >= capacity ) {
+            return 0UL;
+        }
+
+        uint32_t rc{ regionBytes ? regionBytes : capacity - baseAddr };
+
+        if ( rc > capacity - baseAddr ) {
+            rc = capacity - baseAddr;
+        }
+
+        return rc - ( rc % pageBytes );
+    }
+
+}    // namespace
+
+
+/// @brief Creates a ring log in external memory, taking its page buffers from the heap
+/// @param mem The external memory to keep the log in.
+/// @param recordBytes The size of each record.
+/// @param pageBytes Optional. Default: `32`. The size of each write to the external
+/// memory. Two page buffers of this size are taken from the heap. Matching the chip's
+/// page size is a good choice.
+/// @param baseAddr Optional. Default: `0`. The address in external memory where the log
+/// starts.
+/// @param regionBytes Optional. Default: `0`. The number of bytes of external memory the
+/// log may use, rounded down to a whole number of pages. If `0`, the log uses everything
+/// from `baseAddr` to the end of the chip.
+/// @note Check the log with `operator bool()` before using it.
+SpiRingLog::SpiRingLog(
+    SpiMemory& mem,
+    const uint16_t recordBytes,
+    const uint16_t pageBytes,
+    const uint32_t baseAddr,
+    const uint32_t regionBytes )
+:
+    _mem{ mem },
+    _recordBytes{ recordBytes },
+    _pageBytes{ pageBytes },
+    _baseAddr{ baseAddr },
+    _regionBytes{ getRegionBytes( mem, pageBytes, baseAddr, regionBytes ) },
+    _pages{ ( recordBytes and _regionBytes >= recordBytes ) ?
+        (uint8_t*) memory::allocate( pageBytes * 2, &_allocatedBytes ) :
+        nullptr }
+{
+    // empty
+}
+
+
+/// @brief Writes out anything still waiting, then gives the page buffers back to the heap
+SpiRingLog::~SpiRingLog()
+{
+    if ( *this ) {
+        flush();
+        memory::free( _pages, _allocatedBytes );
+    }
+}
+
+
+/// @brief Determines if the log got its memory from the heap
+/// @returns `true` if the log can be used, `false` otherwise.
+SpiRingLog::operator bool() const
+{
+    return _pages != nullptr;
+}
+
+
+/// @brief Adds a record to the end of the log
+/// @param record The record to add - `recordBytes` long.
+/// @returns `true` if the record was added, `false` otherwise.
+/// @note Usually just a copy into local SRAM. When a page fills, it's written out in
+/// the background, but if the page before it is still being written, this waits for
+/// that first.
+bool SpiRingLog::append( const void* record )
+{
+    if ( !*this ) {
+        return false;
+    }
+
+    const uint8_t* cursor{ (const uint8_t*) record };
+    uint16_t remaining{ _recordBytes };
+
+    while ( remaining ) {
+        uint8_t* const page{ _pages + ( _fillPage * _pageBytes ) };
+        const uint16_t run{ MIN( remaining, (uint16_t) ( _pageBytes - _fillBytes ) ) };
+
+        memcpy( page + _fillBytes, cursor, run );
+
+        _fillBytes += run;
+        cursor += run;
+        remaining -= run;
+
+        if ( _fillBytes == _pageBytes ) {
+            // send off whatever of the page hasn't been flushed already
+            SpiMemoryTransaction& t{ _pageXfer[ _fillPage ] };
+
+            t.buffer = page + _flushedBytes;
+            t.address = _baseAddr + _pageOffset + _flushedBytes;
+            t.numBytes = _pageBytes - _flushedBytes;
+            t.direction = SpiDirection::Write;
+            t.doneSyn = &_doneSyn;
+
+            if ( !_mem.queue( t ) ) {
+                return false;
+            }
+
+            // on to the other page buffer, once it's finished with
+            _fillPage ^= 1;
+            _fillBytes = 0;
+            _flushedBytes = 0;
+            _pageOffset = wrap( _pageOffset + _pageBytes );
+
+            waitFor( _pageXfer[ _fillPage ] );
+        }
+    }
+
+    if ( _count < getCapacity() ) {
+        _count++;
+    }
+
+    _nextSequence++;
+
+    return true;
+}
+
+
+/// @brief Writes out the partly filled page, and waits for all writes to complete
+/// @returns `true` if everything was written, `false` otherwise.
+/// @note The page carries on filling afterwards, and only the bytes added since are
+/// written when it's full.
+bool SpiRingLog::flush()
+{
+    if ( !*this ) {
+        return false;
+    }
+
+    bool rc{ true };
+
+    // the page before this one may still be on its way out
+    waitFor( _pageXfer[ _fillPage ^ 1 ] );
+
+    if ( _fillBytes > _flushedBytes ) {
+        rc = writePage( _flushedBytes, _fillBytes );
+        _flushedBytes = _fillBytes;
+    }
+
+    return rc;
+}
+
+
+/// @brief Reads records from the log, starting at a given sequence number
+/// @param sequence The sequence number of the first record wanted. If that record has
+/// already been overwritten, reading starts from the oldest record instead. Updated to
+/// the sequence number of the record after the last one read, ready for the next call.
+/// @param records The place to put the records, oldest first.
+/// @param maxRecords The most records to read.
+/// @returns The number of records read.
+/// @note Flushes the log first, so that the newest records can be read back.
+uint32_t SpiRingLog::readFrom( uint32_t& sequence, void* records, const uint32_t maxRecords )
+{
+    if ( !*this or !flush() ) {
+        return 0UL;
+    }
+
+    // catch up, if the records asked for have been overwritten
+    if ( (uint32_t) ( _nextSequence - sequence ) > _count ) {
+        sequence = getOldestSequence();
+    }
+
+    const uint32_t available{ _nextSequence - sequence };
+    const uint32_t rc{ MIN( available, maxRecords ) };
+
+    if ( !rc ) {
+        return 0UL;
+    }
+
+    // where the first record is, counting back from the end of the log
+    const uint32_t headOffset{ wrap( _pageOffset + _fillBytes ) };
+    const uint32_t startOffset{ wrap( headOffset + _regionBytes - ( available * _recordBytes ) ) };
+    const uint32_t numBytes{ rc * _recordBytes };
+
+    // up to the end of the region, then the rest from the start
+    const uint32_t firstRun{ MIN( numBytes, _regionBytes - startOffset ) };
+
+    _xfer.buffer = records;
+    _xfer.address = _baseAddr + startOffset;
+    _xfer.numBytes = firstRun;
+    _xfer.direction = SpiDirection::Read;
+    _xfer.doneSyn = &_doneSyn;
+
+    if ( !_mem.queue( _xfer ) ) {
+        return 0UL;
+    }
+
+    waitFor( _xfer );
+
+    if ( numBytes > firstRun ) {
+        _xfer.buffer = (uint8_t*) records + firstRun;
+        _xfer.address = _baseAddr;
+        _xfer.numBytes = numBytes - firstRun;
+
+        if ( !_mem.queue( _xfer ) ) {
+            return 0UL;
+        }
+
+        waitFor( _xfer );
+    }
+
+    sequence += rc;
+
+    return rc;
+}
+
+
+/// @brief Reads the newest records from the log
+/// @param records The place to put the records, oldest first.
+/// @param numRecords How many of the newest records to read.
+/// @returns The number of records read - fewer than asked for if the log doesn't
+/// hold that many.
+uint32_t SpiRingLog::readLatest( void* records, const uint32_t numRecords )
+{
+    uint32_t sequence{ _nextSequence - MIN( numRecords, _count ) };
+
+    return readFrom( sequence, records, numRecords );
+}
+
+
+/// @brief Gets the number of records in the log
+/// @returns The number of records that can be read back.
+uint32_t SpiRingLog::getCount() const
+{
+    return _count;
+}
+
+
+/// @brief Gets the most records the log can hold
+/// @returns The number of records that fit in the log's region of the chip.
+uint32_t SpiRingLog::getCapacity() const
+{
+    return _recordBytes ? _regionBytes / _recordBytes : 0UL;
+}
+
+
+/// @brief Gets the sequence number of the oldest record in the log
+/// @returns The sequence number to pass to readFrom() to read everything.
+uint32_t SpiRingLog::getOldestSequence() const
+{
+    return _nextSequence - _count;
+}
+
+
+/// @brief Gets the sequence number the next record appended will get
+/// @returns One more than the sequence number of the newest record.
+uint32_t SpiRingLog::getNextSequence() const
+{
+    return _nextSequence;
+}
+
+
+// Writes part of the filling page out, and waits for it to get there
+bool SpiRingLog::writePage( const uint16_t fromOffset, const uint16_t toOffset )
+{
+    _xfer.buffer = _pages + ( _fillPage * _pageBytes ) + fromOffset;
+    _xfer.address = _baseAddr + _pageOffset + fromOffset;
+    _xfer.numBytes = toOffset - fromOffset;
+    _xfer.direction = SpiDirection::Write;
+    _xfer.doneSyn = &_doneSyn;
+
+    if ( !_mem.queue( _xfer ) ) {
+        return false;
+    }
+
+    waitFor( _xfer );
+
+    return true;
+}
+
+
+// Sleeps until a transfer is done with (or returns straight away if it is)
+void SpiRingLog::waitFor( SpiMemoryTransaction& t )
+{
+    while ( t.bus.pending ) {
+        _doneSyn.wait();
+    }
+}
+
+
+// Brings an offset that has run past the end of the region back to the start
+uint32_t SpiRingLog::wrap( const uint32_t offset ) const
+{
+    return ( offset >= _regionBytes ) ? offset - _regionBytes : offset;
+}
+
+
+#endif
@@ -0,0 +1,84 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_DRIVERS_SPIMEM
+
+
+#ifndef TCRI_ZERO_SRAMLOG_H
+#define TCRI_ZERO_SRAMLOG_H
+
+
+#include <stdint.h>
+
+#include "thread.h"
+#include "sram.h"
+
+
+namespace zero {
+
+    /// @brief A circular log of fixed-size records, kept in external SPI memory
+    /// @details Appended records are gathered in local SRAM, a page at a time, and each
+    /// full page is written out in one transfer in the background while the next page
+    /// fills - one SPI command per page, rather than one per record. Once the log has
+    /// wrapped around, each new record overwrites the oldest.
+    /// @details Every record appended gets a sequence number, counting up from zero, so
+    /// a reader can pick up where it left off with readFrom(), or get the most recent
+    /// records with readLatest().
+    /// @code
+    /// SpiRingLog log{ mem, sizeof( uint16_t ) };
+    ///
+    /// if ( log ) {
+    ///     while ( true ) {
+    ///         const uint16_t sample{ adc.getLastConversion() };
+    ///         log.append( &sample );
+    ///         ...
+    ///     }
+    /// }
+    /// @endcode
+    /// @note A log belongs to the Thread that creates it, and must only be used by that
+    /// Thread. The log's position is kept in local SRAM, so it starts empty again after
+    /// a reset.
+    class SpiRingLog {
+    public:
+        SpiRingLog(
+            SpiMemory& mem,                             // the external memory to keep the log in
+            const uint16_t recordBytes,                 // size of each record
+            const uint16_t pageBytes = 32,              // size of each batched write
+            const uint32_t baseAddr = 0UL,              // where the log starts, in external memory
+            const uint32_t regionBytes = 0UL );         // how much of the chip to use (0 = up to the end)
+        ~SpiRingLog();
+
+        explicit operator bool() const;                 // Determines if the log got its memory
+
+        bool append( const void* record );              // adds a record, overwriting the oldest if full
+        bool flush();                                   // writes out any partly filled page
+
+        uint32_t readFrom(
+            uint32_t& sequence,                         // first record wanted, updated to the next one
+            void* records,                              // place to put the records, oldest first
+            const uint32_t maxRecords );                // most records to read
+
+        uint32_t readLatest(
+            void* records,                              // place to put the records, oldest first
+            const uint32_t numRecords );                // how many of the newest records to read
+
+        uint32_t getCount() const;                      // records in the log right now
+        uint32_t getCapacity() const;                   // most records the log can hold
+        uint32_t getOldestSequence() const;             // sequence number of the oldest record
+        uint32_t getNextSequence() const;               // sequence number the next record will get
+
+        #include "sramlog_private.h"
+    };
+
+}    // namespace zero
+
+
+#endif
+
+
+#endif
@@ -0,0 +1,38 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+
+private:
+    SpiRingLog( const SpiRingLog& l ) = delete;
+    void operator=( const SpiRingLog& l ) = delete;
+
+    bool writePage( const uint16_t fromOffset, const uint16_t toOffset );
+    void waitFor( SpiMemoryTransaction& t );
+    uint32_t wrap( const uint32_t offset ) const;
+
+    SpiMemory& _mem;
+    const uint16_t _recordBytes;
+    const uint16_t _pageBytes;
+    const uint32_t _baseAddr;
+    const uint32_t _regionBytes;                        // a whole number of pages
+    uint16_t _allocatedBytes{ 0 };                      // declared before _pages, whose initialiser sets it
+    uint8_t* const _pages;                              // two page buffers, one filling while the other is written
+
+    uint8_t _fillPage{ 0 };                             // which page buffer is filling
+    uint16_t _fillBytes{ 0 };                           // bytes in the filling page
+    uint16_t _flushedBytes{ 0 };                        // bytes of the filling page already written out
+    uint32_t _pageOffset{ 0UL };                        // where the filling page goes, from the start of the region
+
+    uint32_t _count{ 0UL };                             // records in the log
+    uint32_t _nextSequence{ 0UL };                      // sequence number of the next record appended
+
+    Synapse _doneSyn;
+    SpiMemoryTransaction _pageXfer[ 2 ]{};              // background page writes, one per page buffer
+    SpiMemoryTransaction _xfer{};                       // flushes and reads
@@ -13,6 +13,7 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <avr/power.h>
 #include <util/atomic.h>
 
@@ -20,6 +21,7 @@
 #include "thread.h"
 #include "memory.h"
 #include "doublebuffer.h"
+#include "trace.h"
 #include "suart.h"
 
 
@@ -27,7 +29,13 @@ using namespace zero;
 
 
 namespace {
-    SuartTx* _suartTx{ nullptr };
+    // the most soft-TX channels that can share the bit-clock
+    const int NUM_TX_CHANNELS = 4;
+
+    SuartTx* _suartTx[ NUM_TX_CHANNELS ];
+    uint32_t _txClockBaud{ 0UL };                       // the bit-clock's speed, while there are channels
+
+    SuartRx* _suartRx{ nullptr };
 }
 
 
@@ -37,27 +45,49 @@ namespace {
 /// transmitter to send the data on.
 /// @param txReadySyn The Synapse to signal when the transmitter is ready to send new
 /// data.
+/// @note Up to four SuartTx channels can exist at once, all sharing Timer2 - so they
+/// must all use the same baud rate. For the leanest bit-clock ISR, put each channel's
+/// pins on a single port.
 SuartTx::SuartTx(
     const uint32_t baud,
     Gpio& pin,
     Synapse& txReadySyn )
 {
     ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
-        if ( resource::obtain( resource::ResourceId::Timer2 ) ) {
-            _baud = baud;
-            _gpio = &pin;
+        // the first channel claims the bit-clock, the rest have to match its speed
+        bool haveClock{ false };
+        int slot{ -1 };
 
-            _gpio->setAsOutput();
-            _gpio->lock( GpioAspect::Direction );
-            _gpio->switchOn();
+        for ( int i = 0; i < NUM_TX_CHANNELS; i++ ) {
+            if ( _suartTx[ i ] ) {
+                haveClock = true;
+            }
+            else if ( slot < 0 ) {
+                slot = i;
+            }
+        }
 
-            power_timer2_enable();
+        if ( slot < 0 ) return;
+        if ( haveClock and baud != _txClockBaud ) return;
+        if ( !haveClock and !resource::obtain( resource::ResourceId::Timer2 ) ) return;
+
+        _baud = _txClockBaud = baud;
+        _gpio = &pin;
 
-            _txReadySyn = &txReadySyn;
-            _txReadySyn->signal();
+        _gpio->setAsOutput();
+        _gpio->lock( GpioAspect::Direction );
+        _gpio->switchOn();
 
-            _suartTx = this;
+        findPort();
+
+        if ( !haveClock ) {
+            power_timer2_enable();
         }
+
+        _txReadySyn = &txReadySyn;
+        _txReadySyn->signal();
+
+        _suartTx[ slot ] = this;
     }
 }
 
@@ -67,16 +97,30 @@ SuartTx::~SuartTx()
 {
     ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
         if ( *this ) {
-            stopTxTimer();
-            power_timer2_disable();
+            bool othersRemain{ false };
+
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                for ( int i = 0; i < NUM_TX_CHANNELS; i++ ) {
+                    if ( _suartTx[ i ] == this ) {
+                        _suartTx[ i ] = nullptr;
+                    }
+                    else if ( _suartTx[ i ] ) {
+                        othersRemain = true;
+                    }
+                }
+            }
 
             _gpio->reset();
 
             _txReadySyn->clearSignals();
             _txReadySyn = nullptr;
 
-            _suartTx = nullptr;
-            resource::release( resource::ResourceId::Timer2 );
+            // the last one out switches off the bit-clock
+            if ( !othersRemain ) {
+                stopTxTimer();
+                power_timer2_disable();
+                resource::release( resource::ResourceId::Timer2 );
+            }
         }
     }
 }
@@ -86,13 +130,69 @@ SuartTx::~SuartTx()
 /// @returns `true` if the SuartTx initialized correctly, `false` otherwise.
 SuartTx::operator bool() const
 {
-    return ( _suartTx == this );
+    for ( int i = 0; i < NUM_TX_CHANNELS; i++ ) {
+        if ( _suartTx[ i ] == this ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// Works out the PORTx register and bit mask for the channel's pins, so that
+// each bit costs the ISR a single read-modify-write
+void SuartTx::findPort()
+{
+    const PinField pins{ _gpio->getAllocatedPins() };
+
+    _portReg = nullptr;
+    _portMask = 0;
+
+    for ( uint8_t port = 0; port < 4; port++ ) {
+        const uint8_t mask{ (uint8_t) ( pins >> ( port << 3 ) ) };
+
+        if ( !mask ) {
+            continue;
+        }
+
+        if ( _portReg ) {
+            // pins on more than one port, so the ISR will go via the Gpio
+            _portReg = nullptr;
+            return;
+        }
+
+        switch ( port ) {
+            #ifdef PORTA
+                case 0: _portReg = &PORTA; break;
+            #endif
+
+            #ifdef PORTB
+                case 1: _portReg = &PORTB; break;
+            #endif
+
+            #ifdef PORTC
+                case 2: _portReg = &PORTC; break;
+            #endif
+
+            #ifdef PORTD
+                case 3: _portReg = &PORTD; break;
+            #endif
+        }
+
+        _portMask = mask;
+    }
 }
 
 
-// starts the periodic bit-timer for transmission
+// starts the periodic bit-timer for transmission, unless it's already running
 void SuartTx::startTxTimer() const
 {
+    if ( TIMSK2 & ( 1 << OCIE2A ) ) {
+        // another channel has it going already
+        return;
+    }
+
     const uint16_t scaledMs{ (uint16_t) ( F_CPU / ( 16UL * _baud ) ) - 1 };
 
     TCCR2B = 0;                                         // make sure timer is stopped
@@ -105,7 +205,7 @@ void SuartTx::startTxTimer() const
 
 
 // stops the bit-timer
-void SuartTx::stopTxTimer() const
+void SuartTx::stopTxTimer()
 {
     TIMSK2 &= ~( 1 << OCIE2A );                         // disable Timer ISR
     TCCR2B = 0;                                         // make sure timer is stopped
@@ -119,12 +219,15 @@ void SuartTx::stopTxTimer() const
 /// @param allowBlock If `true` and the transmitter is currently busy, the calling
 /// Thread will block until the transmitter is ready to send again. If `false` and the
 /// transmitter is busy, the call will fail.
+/// @param fromFlash Optional. Default: `false`. If `true`, `buffer` points to an address
+/// in Flash memory instead of SRAM, and is read from there a byte at a time.
 /// @returns `true` if the transmission was successfully started, `false`
 /// otherwise.
 bool SuartTx::transmit(
     const void* buffer,
     const uint16_t numBytes,
-    const bool allowBlock )
+    const bool allowBlock,
+    const bool fromFlash )
 {
     if ( allowBlock and _txReadySyn ) {
         _txReadySyn->wait();
@@ -139,18 +242,47 @@ bool SuartTx::transmit(
             _txReadySyn->clearSignals();
         }
 
-        // remember the buffer data
-        _txBuffer = (uint8_t*) buffer;
-        _txBytesRemaining = numBytes;
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            // remember the buffer data
+            _txBuffer = (uint8_t*) buffer;
+            _txBytesRemaining = numBytes;
+            _txFromFlash = fromFlash;
 
-        // enable the ISR that starts the transmission
-        startTxTimer();
+            // make sure the bit-clock is ticking
+            startTxTimer();
+        }
 
         return true;
     }
 }
 
 
+/// @brief Determines if there is a transmission underway
+/// @returns `true` if the transmitter is busy, `false` otherwise.
+bool SuartTx::isBusy() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _txBuffer;
+    }
+}
+
+
+/// @brief Spins until the transmission underway, if any, has gone out
+/// @details With interrupts off the bit-clock ISR can't run, so the Timer2 compare is
+/// polled instead and the bits are sent from here, at the same rate.
+/// @note For fatal paths that need the pin to themselves. Everywhere else, wait for
+/// the ready Synapse.
+void SuartTx::finish()
+{
+    while ( isBusy() ) {
+        if ( !( SREG & ( 1 << SREG_I ) ) and ( TIFR2 & ( 1 << OCF2A ) ) ) {
+            TIFR2 = ( 1 << OCF2A );
+            onTick();
+        }
+    }
+}
+
+
 // Gets the next byte from the transmission buffer, if there is one
 bool SuartTx::getNextTxByte( uint8_t& data )
 {
@@ -159,7 +291,8 @@ bool SuartTx::getNextTxByte( uint8_t& data )
     data = 0;
 
     if ( _txBytesRemaining ) {
-        data = *_txBuffer++;
+        data = _txFromFlash ? pgm_read_byte( _txBuffer ) : *_txBuffer;
+        _txBuffer++;
         _txBytesRemaining--;
 
         rc = true;
@@ -169,57 +302,392 @@ bool SuartTx::getNextTxByte( uint8_t& data )
 }
 
 
+// Sends the next bit for every channel, switching the bit-clock off once
+// none of them have anything left to send
 void SuartTx::onTick()
 {
-    // just in time fetch of data to send
-    if ( !_txReg ) {
-        // Switch off transmission, even if there are more bytes. We will reset and
-        // restart the timer if we need to transmit more data. This improves transmission
-        // accuracy when the MCU is experiencing a lot of task switching and ISRs are
-        // being switched on and off and so on. This helps prevent bit errors under load,
-        // but doesn't completely eliminate them.
+    bool busy{ false };
+
+    for ( int i = 0; i < NUM_TX_CHANNELS; i++ ) {
+        if ( SuartTx* const tx = _suartTx[ i ] ) {
+            busy |= tx->onChannelTick();
+        }
+    }
+
+    if ( !busy ) {
         stopTxTimer();
+    }
+}
 
+
+// Sends the channel's next bit, returning false if there was nothing to send
+bool SuartTx::onChannelTick()
+{
+    // just in time fetch of data to send
+    if ( !_txReg ) {
         // the next byte to send is fetched by reference
         uint8_t nextByte;
 
         if ( !getNextTxByte( nextByte ) ) {
             // no more data to send? tidy up, and signal readiness to go again
-            _txBuffer = nullptr;
+            if ( _txBuffer ) {
+                _txBuffer = nullptr;
 
-            if ( _txReadySyn ) {
-                _txReadySyn->signal();
+                if ( _txReadySyn ) {
+                    _txReadySyn->signal();
+                }
             }
-        }
-        else {
-            // load next byte
-            _txReg = nextByte << 1;
-            _txReg &= ~( 1L << 0 );                     // force start bit low
-            _txReg |= ( 1L << 9 );                      // stop bit high (so it ends high)
 
-            startTxTimer();
+            return false;
         }
+
+        // start bit low (bit 0), then the data, then a high stop bit (so it ends high)
+        _txReg = ( (uint16_t) nextByte << 1 ) | ( 1 << 9 );
     }
 
-    if ( _txReg ) {
-        // we're mid-byte, keep pumping out the bits
+    // we're mid-byte, keep pumping out the bits
+    if ( _portReg ) {
         if ( _txReg & 1 ) {
-            _gpio->switchOn();
+            *_portReg |= _portMask;
         }
         else {
-            _gpio->switchOff();
+            *_portReg &= ~_portMask;
         }
-
-        _txReg >>= 1;
     }
+    else if ( _txReg & 1 ) {
+        _gpio->switchOn();
+    }
+    else {
+        _gpio->switchOff();
+    }
+
+    _txReg >>= 1;
+
+    return true;
 }
 
 
 // Timer tick ISR for the bit-clock
 ISR( TIMER2_COMPA_vect )
 {
-    if ( _suartTx ) {
-        _suartTx->onTick();
+    trace_isr( TIMER2_COMPA_vect_num );
+
+    SuartTx::onTick();
+}
+
+
+/// @brief Creates a new SuartRx object
+/// @param baud The bitrate of the incoming data.
+/// @param pin The pin to receive on. It is made an input, with its pull-up on so that
+/// an unconnected line idles high.
+/// @note Uses Timer1, so only one SuartRx can exist at a time.
+SuartRx::SuartRx( const uint32_t baud, const PinField pin )
+:
+    _gpio{ pin, onEdge }
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        if ( _gpio and resource::obtain( resource::ResourceId::Timer1 ) ) {
+            // find the PINx register and bit, so that sampling is a single read
+            const PinField pins{ _gpio.getAllocatedPins() };
+
+            for ( uint8_t bit = 0; bit < 32; bit++ ) {
+                if ( pins & ( 1UL << bit ) ) {
+                    switch ( bit >> 3 ) {
+                        #ifdef PINA
+                            case 0: _pinReg = &PINA; break;
+                        #endif
+
+                        #ifdef PINB
+                            case 1: _pinReg = &PINB; break;
+                        #endif
+
+                        #ifdef PINC
+                            case 2: _pinReg = &PINC; break;
+                        #endif
+
+                        #ifdef PIND
+                            case 3: _pinReg = &PIND; break;
+                        #endif
+                    }
+
+                    _pinMask = 1 << ( bit & 7 );
+                    break;
+                }
+            }
+
+            // one bit's worth of ticks, dropping to clk/8 for slow lines so
+            // that a bit and a half still fits in 16 bits
+            uint32_t ticks{ F_CPU / baud };
+            _prescaleBits = ( 1 << CS10 );
+
+            if ( ticks + ( ticks / 2 ) > 0xFFFF ) {
+                ticks /= 8;
+                _prescaleBits = ( 1 << CS11 );
+            }
+
+            _bitTicks = (uint16_t) ticks;
+
+            _gpio.setAsInput();
+            _gpio.switchOn();
+            _gpio.lock( GpioAspect::Direction );
+
+            power_timer1_enable();
+
+            _suartRx = this;
+        }
+    }
+}
+
+
+// dtor
+SuartRx::~SuartRx()
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        if ( *this ) {
+            disable();
+            power_timer1_disable();
+
+            _suartRx = nullptr;
+            resource::release( resource::ResourceId::Timer1 );
+        }
+    }
+}
+
+
+/// @brief Determines if the SuartRx initialized correctly.
+/// @returns `true` if the SuartRx initialized correctly, `false` otherwise.
+SuartRx::operator bool() const
+{
+    return ( _suartRx == this );
+}
+
+
+/// @brief Starts receiving into a buffer
+/// @param bufferSize The size of the buffer used to cache incoming data.
+/// @param rxSyn The Synapse to signal when new data has arrived.
+/// @param ovfSyn Optional. Default: `nullptr`. The Synapse to signal when the receive
+/// buffer is full and bytes are being lost.
+/// @returns `true` if the receiver was enabled, `false` otherwise.
+bool SuartRx::enable( const uint16_t bufferSize, Synapse& rxSyn, Synapse* ovfSyn )
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        disable();
+
+        if ( !*this ) {
+            return false;
+        }
+
+        _rxBuffer = new DoubleBuffer( bufferSize );
+
+        if ( !_rxBuffer or !*_rxBuffer ) {
+            delete _rxBuffer;
+            _rxBuffer = nullptr;
+            return false;
+        }
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            _rxDataReceivedSyn = &rxSyn;
+            _rxOverflowSyn = ovfSyn;
+        }
+
+        return true;
+    }
+}
+
+
+#ifdef ZERO_DRIVERS_PIPE
+
+/// @brief Starts receiving straight into a Pipe
+/// @param sink The Pipe to write received bytes into.
+/// @param ovfSyn Optional. Default: `nullptr`. The Synapse to signal when the Pipe is
+/// full and bytes are being lost.
+/// @returns `true` if the receiver was enabled, `false` otherwise.
+/// @note Readers are woken according to the Pipe's own watermarks.
+bool SuartRx::enable( Pipe& sink, Synapse* ovfSyn )
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        disable();
+
+        if ( !*this or !sink ) {
+            return false;
+        }
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            _rxPipe = &sink;
+            _rxOverflowSyn = ovfSyn;
+        }
+
+        return true;
+    }
+}
+
+#endif
+
+
+/// @brief Stops receiving
+void SuartRx::disable()
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            stopRxTimer();
+            _receiving = false;
+
+            _rxDataReceivedSyn = nullptr;
+            _rxOverflowSyn = nullptr;
+
+            #ifdef ZERO_DRIVERS_PIPE
+                _rxPipe = nullptr;
+            #endif
+        }
+
+        delete _rxBuffer;
+        _rxBuffer = nullptr;
+    }
+}
+
+
+/// @brief Gets the current receive buffer
+/// @param numBytes A reference to a `uint16_t` to store the number of valid bytes in
+/// the buffer.
+/// @returns A pointer to the current receive buffer, or `nullptr` is the buffer is
+/// currently empty.
+uint8_t* SuartRx::getCurrentBuffer( uint16_t& numBytes )
+{
+    numBytes = 0;
+    return _rxBuffer ? _rxBuffer->getCurrentBuffer( numBytes ) : nullptr;
+}
+
+
+/// @brief Discards the current contents of the receive buffer
+void SuartRx::flush()
+{
+    if ( _rxBuffer ) {
+        _rxBuffer->flush();
+    }
+}
+
+
+// Determines if there's somewhere to put received bytes
+bool SuartRx::hasSink() const
+{
+    #ifdef ZERO_DRIVERS_PIPE
+        if ( _rxPipe ) {
+            return true;
+        }
+    #endif
+
+    return _rxBuffer != nullptr;
+}
+
+
+// reads the RX line
+bool SuartRx::isLineHigh() const
+{
+    return *_pinReg & _pinMask;
+}
+
+
+// starts the bit-timer, first ticking in the middle of the first data bit
+void SuartRx::startRxTimer()
+{
+    TCCR1B = 0;                                         // make sure timer is stopped
+    TCCR1A = 0;
+    TCNT1 = 0;                                          // reset the counter
+    OCR1A = _bitTicks + ( _bitTicks / 2 );              // skip the start bit, land mid-bit
+    TIFR1 = ( 1 << OCF1A );                             // clear any stale match
+    TIMSK1 |= ( 1 << OCIE1A );                          // enable Timer1 ISR
+    TCCR1B = ( 1 << WGM12 ) | _prescaleBits;            // CTC, start the timer
+}
+
+
+// stops the bit-timer
+void SuartRx::stopRxTimer() const
+{
+    TIMSK1 &= ~( 1 << OCIE1A );                         // disable Timer ISR
+    TCCR1B = 0;                                         // make sure timer is stopped
+}
+
+
+// hands a received byte to whichever sink is in use
+void SuartRx::deliver( const uint8_t data )
+{
+    #ifdef ZERO_DRIVERS_PIPE
+        if ( _rxPipe ) {
+            if ( !_rxPipe->tryWrite( data ) and _rxPipe->isFull() and _rxOverflowSyn ) {
+                _rxOverflowSyn->signal();
+            }
+
+            return;
+        }
+    #endif
+
+    if ( _rxBuffer ) {
+        if ( _rxBuffer->write( data ) ) {
+            if ( _rxDataReceivedSyn ) {
+                _rxDataReceivedSyn->signal();
+            }
+        }
+        else if ( _rxOverflowSyn ) {
+            _rxOverflowSyn->signal();
+        }
+    }
+}
+
+
+// Pin change on the RX line - a falling edge while idle is a start bit
+void SuartRx::onEdge( const Gpio& )
+{
+    SuartRx* const rx{ _suartRx };
+
+    if ( rx and !rx->_receiving and rx->hasSink() and !rx->isLineHigh() ) {
+        rx->_receiving = true;
+        rx->_bitNumber = 0;
+        rx->_rxReg = 0;
+
+        rx->startRxTimer();
+    }
+}
+
+
+// Samples one bit, in the middle of it
+void SuartRx::onTick()
+{
+    const bool high{ isLineHigh() };
+
+    if ( !_bitNumber ) {
+        // from here on, tick once per bit
+        OCR1A = _bitTicks;
+    }
+
+    if ( _bitNumber < 8 ) {
+        // data bits arrive LSB first
+        _rxReg >>= 1;
+
+        if ( high ) {
+            _rxReg |= 0x80;
+        }
+
+        _bitNumber++;
+    }
+    else {
+        // the stop bit - a low one means a framing error, so the byte is dropped
+        stopRxTimer();
+        _receiving = false;
+
+        if ( high ) {
+            deliver( _rxReg );
+        }
+    }
+}
+
+
+// Timer tick ISR for the receive bit-clock
+ISR( TIMER1_COMPA_vect )
+{
+    trace_isr( TIMER1_COMPA_vect_num );
+
+    if ( _suartRx ) {
+        _suartRx->onTick();
     }
 }
 
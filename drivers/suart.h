@@ -17,6 +17,8 @@
 
 #include "thread.h"
 #include "gpio.h"
+#include "doublebuffer.h"
+#include "pipe.h"
 
 
 namespace zero {
@@ -32,13 +34,64 @@ namespace zero {
         bool transmit(
             const void* buffer,
             const uint16_t sz,
-            const bool allowBlock = false );
+            const bool allowBlock = false,
+            const bool fromFlash = false );             // buffer points to Flash, not SRAM
+
+        bool isBusy() const;
+        void finish();                                  // spins until the transmission is out
 
         explicit operator bool() const;
 
         #include "suart_private.h"
     };
 
+
+    /// @brief Provides software interrupt-driven UART reception on any GPIO pin
+    /// @details The falling edge of each start bit is caught with a pin change interrupt,
+    /// then Timer1 ticks in the middle of every bit to sample it. 8-none-1 only.
+    /// @code
+    /// int gpsThread()
+    /// {
+    ///     Synapse rxSyn;
+    ///     SuartRx rx{ 9600, ZERO_PIND4 };
+    ///
+    ///     if ( rx and rx.enable( 64, rxSyn ) ) {
+    ///         while ( true ) {
+    ///             rxSyn.wait();
+    ///
+    ///             uint16_t numBytes;
+    ///             const uint8_t* const data{ rx.getCurrentBuffer( numBytes ) };
+    ///             ...
+    ///         }
+    ///     }
+    /// }
+    /// @endcode
+    class SuartRx {
+    public:
+        SuartRx(
+            const uint32_t baud,                        // the speed of the communications
+            const PinField pin );                       // the pin to use for the RX line
+
+        bool enable(
+            const uint16_t bufferSize,                  // size of the buffer used to cache incoming data
+            Synapse& dataRecdSyn,                       // Synapse to signal when data arrives
+            Synapse* overflowSyn = nullptr );           // Synapse to signal when data is lost
+
+        #ifdef ZERO_DRIVERS_PIPE
+            bool enable(
+                Pipe& sink,                             // Pipe to write received bytes straight into
+                Synapse* overflowSyn = nullptr );       // Synapse to signal when the Pipe is full
+        #endif
+
+        void disable();
+        uint8_t* getCurrentBuffer( uint16_t& numBytes );
+        void flush();
+
+        explicit operator bool() const;
+
+        #include "suartrx_private.h"
+    };
+
 }    // namespace zero
 
 
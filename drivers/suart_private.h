@@ -9,19 +9,22 @@
 public:
     /// @privatesection
     ~SuartTx();
-    void onTick();
+    static void onTick();
 
 private:
     SuartTx( const SuartTx& s ) = delete;
     void operator=( const SuartTx& s ) = delete;
 
+    bool onChannelTick();
     bool getNextTxByte( uint8_t& data );
+    void findPort();
     void startTxTimer() const;
-    void stopTxTimer() const;
+    static void stopTxTimer();
 
     // buffer-level stuff
     uint8_t* _txBuffer{ nullptr };
     uint16_t _txBytesRemaining{ 0 };
+    bool _txFromFlash{ false };                         // read _txBuffer with pgm_read_byte()
     Synapse* _txReadySyn{ nullptr };
 
     // sub-byte management
@@ -30,3 +33,5 @@ private:
     // GPIO and comms
     uint32_t _baud{ 0UL };
     Gpio* _gpio{ nullptr };
+    volatile uint8_t* _portReg{ nullptr };              // PORTx for the pins, if they're all on one port
+    uint8_t _portMask{ 0 };
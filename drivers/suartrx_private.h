@@ -0,0 +1,46 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    ~SuartRx();
+    static void onEdge( const Gpio& g );
+    void onTick();
+
+private:
+    SuartRx( const SuartRx& s ) = delete;
+    void operator=( const SuartRx& s ) = delete;
+
+    bool hasSink() const;
+    bool isLineHigh() const;
+    void startRxTimer();
+    void stopRxTimer() const;
+    void deliver( const uint8_t data );
+
+    // the pin
+    Gpio _gpio;
+    volatile uint8_t* _pinReg{ nullptr };
+    uint8_t _pinMask{ 0 };
+
+    // timing
+    uint16_t _bitTicks{ 0 };
+    uint8_t _prescaleBits{ 0 };
+
+    // sub-byte management
+    volatile bool _receiving{ false };
+    uint8_t _bitNumber{ 0 };
+    uint8_t _rxReg{ 0 };
+
+    // buffer-level stuff
+    DoubleBuffer* _rxBuffer{ nullptr };
+    Synapse* _rxDataReceivedSyn{ nullptr };
+    Synapse* _rxOverflowSyn{ nullptr };
+
+    #ifdef ZERO_DRIVERS_PIPE
+        Pipe* _rxPipe{ nullptr };
+    #endif
@@ -13,6 +13,7 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
 
 #ifdef UCSR0B
@@ -24,6 +25,8 @@
 #include "thread.h"
 #include "memory.h"
 #include "doublebuffer.h"
+#include "bufferring.h"
+#include "trace.h"
 #include "usart.h"
 
 
@@ -160,18 +163,22 @@ UsartTx::operator bool() const
 /// @param allowBlock When this parameter is `true` and a previous transmission is
 /// still underway, the call will block until that transmission has completed. If this
 /// parameter is `false` when a previous transmission is underway, the call will fail.
+/// @param fromFlash Optional. Default: `false`. If `true`, `buffer` points to an address
+/// in Flash memory instead of SRAM. The ISR reads it from there a byte at a time, so
+/// constant tables and banners needn't be copied into SRAM first.
 /// @returns `true` if the transmission began successfully, `false` otherwise.
 bool UsartTx::transmit(
     const void* buffer,
     const uint16_t numBytes,
-    const bool allowBlock )
+    const bool allowBlock,
+    const bool fromFlash )
 {
     if ( allowBlock and _txReadySyn ) {
         _txReadySyn->wait();
     }
 
     ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
-        if ( _txBuffer ) return false;
+        if ( isBusy() ) return false;
         if ( !buffer ) return false;
         if ( !numBytes ) return false;
 
@@ -182,6 +189,7 @@ bool UsartTx::transmit(
         // prime the buffer data
         _txBuffer = (uint8_t*) buffer;
         _txBytesRemaining = numBytes;
+        _txFromFlash = fromFlash;
 
         // enable the ISR that starts the transmission
         UCSRB( _deviceNum ) |= ( 1 << UDRIE0 );
@@ -191,14 +199,93 @@ bool UsartTx::transmit(
 }
 
 
+/// @brief Queues a buffer for transmission, behind any others already queued
+/// @param d The descriptor of the buffer to send.
+/// @returns `true` if the buffer was queued, `false` if it was empty.
+/// @note Never blocks. Queued buffers are sent back-to-back, with no gap between them,
+/// so a frame can be sent as a chain of (say) a header, payload and CRC.
+/// @note May be called from within an ISR.
+bool UsartTx::queue( UsartTxDescriptor& d )
+{
+    if ( !d.buffer or !d.numBytes ) {
+        return false;
+    }
+
+    d.next = nullptr;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _txQueueTail ) {
+            _txQueueTail->next = &d;
+        }
+        else {
+            _txQueueHead = &d;
+        }
+
+        _txQueueTail = &d;
+
+        if ( _txReadySyn ) {
+            _txReadySyn->clearSignals();
+        }
+
+        // (re)enable the ISR that feeds the transmitter
+        UCSRB( _deviceNum ) |= ( 1 << UDRIE0 );
+    }
+
+    return true;
+}
+
+
+/// @brief Determines if there is a transmission underway or queued
+/// @returns `true` if the transmitter is busy, `false` otherwise.
+bool UsartTx::isBusy() const
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        return _txBuffer or _txCurrent or _txQueueHead;
+    }
+}
+
+
+// Finishes with the queued buffer that's just been sent, and
+// moves on to the next one (if there is one)
+void UsartTx::nextDescriptor()
+{
+    if ( _txCurrent ) {
+        if ( _txCurrent->doneSyn ) {
+            _txCurrent->doneSyn->signal();
+        }
+
+        _txCurrent = nullptr;
+    }
+
+    if ( UsartTxDescriptor* const d = _txQueueHead ) {
+        _txQueueHead = d->next;
+
+        if ( !_txQueueHead ) {
+            _txQueueTail = nullptr;
+        }
+
+        _txCurrent = d;
+        _txBuffer = (uint8_t*) d->buffer;
+        _txBytesRemaining = d->numBytes;
+        _txFromFlash = d->fromFlash;
+    }
+}
+
+
 bool UsartTx::getNextTxByte( uint8_t& data )
 {
     bool rc{ false };
 
     data = 0;
 
+    // straight on to the next queued buffer, so there's no gap on the line
+    if ( !_txBytesRemaining and ( _txCurrent or _txQueueHead ) ) {
+        nextDescriptor();
+    }
+
     if ( _txBytesRemaining ) {
-        data = *_txBuffer++;
+        data = _txFromFlash ? pgm_read_byte( _txBuffer ) : *_txBuffer;
+        _txBuffer++;
         _txBytesRemaining--;
 
         rc = true;
@@ -210,7 +297,7 @@ bool UsartTx::getNextTxByte( uint8_t& data )
 
 void UsartTx::byteTxComplete()
 {
-    if ( !_txBytesRemaining and _txBuffer ) {
+    if ( !_txBytesRemaining and _txBuffer and !_txCurrent and !_txQueueHead ) {
         _txBuffer = nullptr;
 
         if ( _txReadySyn ) {
@@ -285,29 +372,94 @@ void UsartRx::setCommsParams( const uint32_t baud )
 bool UsartRx::enable( const uint16_t bufferSize, Synapse& rxSyn, Synapse* ovfSyn )
 {
     ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
-        bool rc{ false };
+        disable();
+
+        if ( ( _rxBuffer = new DoubleBuffer( bufferSize ) ) ) {
+            if ( *_rxBuffer ) {
+                _rxDataReceivedSyn = &rxSyn;
+                _rxOverflowSyn = ovfSyn;
 
-        _rxDataReceivedSyn = nullptr;
-        _rxOverflowSyn = nullptr;
+                UCSRB( _deviceNum ) |= RX_BITS;
 
-        delete _rxBuffer;
-        _rxBuffer = nullptr;
+                return true;
+            }
+
+            delete _rxBuffer;
+            _rxBuffer = nullptr;
+        }
+
+        return false;
+    }
+}
 
-        if ( ( _rxBuffer = new DoubleBuffer( bufferSize ) ) ) {
-            if ( *_rxBuffer) {
-                rc = true;
 
+/// @brief Enables the USART receiver hardware, receiving into a ring of buffer slots
+/// @param bufferSize The number of bytes to share between the slots.
+/// @param numSlots The number of slots. At least two (2).
+/// @param rxSyn The Synapse to signal when new data has arrived.
+/// @param ovfSyn Optional. Default: `nullptr`. The Synapse to signal when every slot is
+/// full or acquired, and bytes are being lost.
+/// @returns `true` if the receiver was enabled, `false` otherwise.
+/// @details Collect the data with acquireBuffer(), and give each slot back with
+/// releaseBuffer() once it has been dealt with. Meanwhile the ISR carries on into the
+/// other slots, so a slow reader loses nothing until they have all filled up. The data
+/// received Synapse is signalled whenever a slot fills, as well as by the watermark.
+/// @note Only UsartFraming::None and UsartFraming::IdleLine apply - frames are not
+/// split out. getCurrentBuffer() always returns `nullptr`.
+bool UsartRx::enable( const uint16_t bufferSize, const uint8_t numSlots, Synapse& rxSyn, Synapse* ovfSyn )
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        disable();
+
+        if ( ( _rxRing = new BufferRing( bufferSize, numSlots ) ) ) {
+            if ( *_rxRing ) {
                 _rxDataReceivedSyn = &rxSyn;
                 _rxOverflowSyn = ovfSyn;
 
                 UCSRB( _deviceNum ) |= RX_BITS;
+
+                return true;
             }
+
+            delete _rxRing;
+            _rxRing = nullptr;
         }
 
-        return rc;
+        return false;
+    }
+}
+
+
+#ifdef ZERO_DRIVERS_PIPE
+
+/// @brief Enables the USART receiver hardware, streaming into a Pipe
+/// @param sink The Pipe to write received bytes into.
+/// @param ovfSyn Optional. Default: `nullptr`. The Synapse to signal when the Pipe is
+/// full and bytes are being lost.
+/// @returns `true` if the receiver was enabled, `false` otherwise.
+/// @note Bytes are written straight into the Pipe from the ISR, so readers are woken
+/// according to the Pipe's own watermarks and idle timeout (see Pipe::setWatermarks()).
+/// getCurrentBuffer(), waitForData() and framing do not apply.
+bool UsartRx::enable( Pipe& sink, Synapse* ovfSyn )
+{
+    ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
+        disable();
+
+        if ( !sink ) {
+            return false;
+        }
+
+        _rxPipe = &sink;
+        _rxOverflowSyn = ovfSyn;
+
+        UCSRB( _deviceNum ) |= RX_BITS;
+
+        return true;
     }
 }
 
+#endif
+
 
 /// @brief Disables the USART receiver hardware
 void UsartRx::disable()
@@ -318,6 +470,13 @@ void UsartRx::disable()
         delete _rxBuffer;
         _rxBuffer = nullptr;
 
+        delete _rxRing;
+        _rxRing = nullptr;
+
+        #ifdef ZERO_DRIVERS_PIPE
+            _rxPipe = nullptr;
+        #endif
+
         if ( _rxDataReceivedSyn ) {
             _rxDataReceivedSyn->clearSignals();
             _rxDataReceivedSyn = nullptr;
@@ -336,29 +495,303 @@ void UsartRx::disable()
 /// the buffer.
 /// @returns A pointer to the current receive buffer, or `nullptr` is the buffer is
 /// currently empty.
+/// @note With UsartFraming::Delimiter or UsartFraming::LengthPrefixed, only whole frames
+/// are returned (perhaps several, one after another), and any partly received frame
+/// stays behind for next time.
 uint8_t* UsartRx::getCurrentBuffer( uint16_t& numBytes )
 {
-    return _rxBuffer->getCurrentBuffer( numBytes );
+    if ( !_rxBuffer ) {
+        numBytes = 0;
+        return nullptr;
+    }
+
+    if ( !isFramed() ) {
+        return _rxBuffer->getCurrentBuffer( numBytes );
+    }
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        uint8_t* const rc{ _rxBuffer->getCurrentBuffer( numBytes, _frameEnd ) };
+        _frameEnd = 0;
+
+        return rc;
+    }
+}
+
+
+/// @brief Takes the oldest filled slot of the receive ring
+/// @param numBytes A reference to a `uint16_t` to store the number of valid bytes in
+/// the slot.
+/// @returns A pointer to the slot, or `nullptr` if nothing has been received (or the
+/// receiver wasn't enabled with a ring). If no slot is full yet, the one being filled is
+/// handed over as it is.
+/// @note The slot is left alone until releaseBuffer() is called. More than one may be
+/// held at once - they're released oldest first.
+uint8_t* UsartRx::acquireBuffer( uint16_t& numBytes )
+{
+    if ( !_rxRing ) {
+        numBytes = 0;
+        return nullptr;
+    }
+
+    return _rxRing->acquire( numBytes );
+}
+
+
+/// @brief Gives the oldest slot taken with acquireBuffer() back to the receiver
+void UsartRx::releaseBuffer()
+{
+    if ( _rxRing ) {
+        _rxRing->release();
+    }
 }
 
 
 /// @brief Discards the current contents of the receive buffer
+/// @note Slots taken with acquireBuffer() stay taken, until released.
 void UsartRx::flush()
 {
-    _rxBuffer->flush();
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        if ( _rxBuffer ) {
+            _rxBuffer->flush();
+        }
+
+        if ( _rxRing ) {
+            _rxRing->flush();
+        }
+
+        _frameEnd = _frameLength = _dropBytes = 0;
+    }
+}
+
+
+/// @brief Sets how the received data is split into frames
+/// @param mode How to find the end of each frame.
+/// @param delimiter Optional. Default: `'\n'`. The byte that ends each frame, for
+/// UsartFraming::Delimiter. The delimiter is kept, at the end of each frame.
+/// @note With UsartFraming::Delimiter or UsartFraming::LengthPrefixed, the data received
+/// Synapse is only signalled once a whole frame has arrived. A frame too big for the
+/// receive buffer is thrown away (and the overflow Synapse signalled).
+/// @note Anything already received is discarded.
+void UsartRx::setFraming( const UsartFraming mode, const uint8_t delimiter )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _framing = mode;
+        _delimiter = delimiter;
+
+        if ( _rxBuffer or _rxRing ) {
+            flush();
+        }
+    }
+}
+
+
+// Determines if the ISR works out where frames end
+bool UsartRx::isFramed() const
+{
+    return _framing == UsartFraming::Delimiter or _framing == UsartFraming::LengthPrefixed;
+}
+
+
+/// @brief Sets how many bytes must arrive before the data received Synapse is signalled
+/// @param numBytes The number of bytes. `1` (the default) signals for every byte.
+/// @param idleTimeout Optional. Default: `0_ms`. If not zero, waitForData() also returns
+/// when some data has arrived and the line has then been quiet this long.
+/// @note The Synapse is always signalled when the receive buffer fills up.
+void UsartRx::setWatermark( const uint16_t numBytes, const Duration idleTimeout )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+        _rxWatermark = numBytes ? numBytes : 1;
+        _rxIdleMs = (uint16_t) (uint32_t) idleTimeout;
+    }
+}
+
+
+/// @brief Waits until the watermark has been reached, or data has arrived and the line
+/// has gone quiet
+/// @note Call this from the Thread that owns the data received Synapse passed to
+/// enable(), then collect the data with getCurrentBuffer().
+void UsartRx::waitForData()
+{
+    while ( _rxDataReceivedSyn and ( _rxBuffer or _rxRing ) ) {
+        const uint16_t used{ _rxBuffer ? _rxBuffer->getUsedBytes() : _rxRing->getFillingBytes() };
+        uint16_t timeout{ 0 };
+
+        if ( _rxRing ) {
+            // a whole slot is always worth collecting
+            if ( _rxRing->getFilledCount() or ( _framing != UsartFraming::IdleLine and used >= _rxWatermark ) ) {
+                return;
+            }
+        }
+        else if ( isFramed() ) {
+            if ( _frameEnd ) {
+                return;
+            }
+        }
+        else if ( ( _framing != UsartFraming::IdleLine and used >= _rxWatermark ) or
+                  used == _rxBuffer->getCapacity() )
+        {
+            return;
+        }
+
+        if ( used and _rxIdleMs ) {
+            const uint16_t quietFor{ (uint16_t) ( (uint16_t) Thread::now() - _lastRxMs ) };
+
+            if ( quietFor >= _rxIdleMs ) {
+                return;
+            }
+
+            // wake up when the line would have been quiet long enough
+            timeout = _rxIdleMs - quietFor;
+        }
+
+        _rxDataReceivedSyn->wait( Duration{ timeout } );
+    }
+}
+
+
+// Receives a byte when Delimiter or LengthPrefixed framing is on, only waking
+// the reader once a frame is complete
+void UsartRx::onFrameByte( const uint8_t data )
+{
+    // still throwing away a frame that didn't fit?
+    if ( _dropBytes ) {
+        if ( _framing == UsartFraming::Delimiter ) {
+            if ( data == _delimiter ) {
+                _dropBytes = 0;
+            }
+        }
+        else {
+            _dropBytes--;
+        }
+
+        return;
+    }
+
+    if ( !_rxBuffer->write( data ) ) {
+        // no room to finish this frame, so lose what we have of it, and the rest of it too
+        const uint16_t have{ (uint16_t) ( _rxBuffer->getUsedBytes() - _frameEnd ) };
+        _rxBuffer->truncate( _frameEnd );
+
+        if ( _framing == UsartFraming::Delimiter ) {
+            _dropBytes = ( data == _delimiter ) ? 0 : 0xFFFF;
+        }
+        else {
+            // if this byte was a length prefix, everything it counts has to go
+            _dropBytes = _frameLength ? _frameLength - have - 1 : data;
+        }
+
+        _frameLength = 0;
+
+        if ( _rxOverflowSyn ) {
+            _rxOverflowSyn->signal();
+        }
+
+        return;
+    }
+
+    const uint16_t used{ _rxBuffer->getUsedBytes() };
+    bool complete;
+
+    if ( _framing == UsartFraming::Delimiter ) {
+        complete = ( data == _delimiter );
+    }
+    else {
+        if ( !_frameLength ) {
+            // the length prefix, plus that many bytes more
+            _frameLength = (uint16_t) data + 1;
+        }
+
+        complete = ( used - _frameEnd == _frameLength );
+    }
+
+    if ( complete ) {
+        _frameEnd = used;
+        _frameLength = 0;
+
+        if ( _rxDataReceivedSyn ) {
+            _rxDataReceivedSyn->signal();
+        }
+    }
+}
+
+
+// Receives a byte into the ring of slots, waking the reader whenever a slot
+// fills, as well as for the watermark
+void UsartRx::onRingByte( const uint8_t data )
+{
+    const uint8_t filled{ _rxRing->getFilledCount() };
+
+    if ( !_rxRing->write( data ) ) {
+        if ( _rxOverflowSyn ) {
+            _rxOverflowSyn->signal();
+        }
+
+        return;
+    }
+
+    const uint16_t used{ _rxRing->getFillingBytes() };
+
+    if ( _rxIdleMs ) {
+        _lastRxMs = (uint16_t) Thread::now();
+    }
+
+    if ( _rxDataReceivedSyn ) {
+        if ( _rxRing->getFilledCount() != filled or
+             ( _framing != UsartFraming::IdleLine and used >= _rxWatermark ) or
+             ( _rxIdleMs and used == 1 ) )
+        {
+            _rxDataReceivedSyn->signal();
+        }
+    }
 }
 
 
 void UsartRx::onRx( const uint8_t deviceNum, const uint8_t data )
 {
-    if ( _usartRx[ deviceNum ]->_rxBuffer->write( data ) ) {
-        if ( _usartRx[ deviceNum ]->_rxDataReceivedSyn ) {
-            _usartRx[ deviceNum ]->_rxDataReceivedSyn->signal();
+    UsartRx* const rx{ _usartRx[ deviceNum ] };
+
+    #ifdef ZERO_DRIVERS_PIPE
+        if ( rx->_rxPipe ) {
+            // (a byte the Pipe's write filter rejects isn't an overflow)
+            if ( !rx->_rxPipe->tryWrite( data ) and rx->_rxPipe->isFull() and rx->_rxOverflowSyn ) {
+                rx->_rxOverflowSyn->signal();
+            }
+
+            return;
+        }
+    #endif
+
+    if ( rx->_rxRing ) {
+        rx->onRingByte( data );
+        return;
+    }
+
+    if ( rx->isFramed() ) {
+        rx->onFrameByte( data );
+        return;
+    }
+
+    if ( rx->_rxBuffer->write( data ) ) {
+        const uint16_t used{ rx->_rxBuffer->getUsedBytes() };
+
+        if ( rx->_rxIdleMs ) {
+            rx->_lastRxMs = (uint16_t) Thread::now();
+        }
+
+        if ( rx->_rxDataReceivedSyn ) {
+            // wake the reader for a full batch, a full buffer, or (so that it can start
+            // timing the idle period) the first byte of a burst
+            if ( ( rx->_framing != UsartFraming::IdleLine and used >= rx->_rxWatermark ) or
+                 used == rx->_rxBuffer->getCapacity() or
+                 ( rx->_rxIdleMs and used == 1 ) )
+            {
+                rx->_rxDataReceivedSyn->signal();
+            }
         }
     }
     else {
-        if ( _usartRx[ deviceNum ]->_rxOverflowSyn ) {
-            _usartRx[ deviceNum ]->_rxOverflowSyn->signal();
+        if ( rx->_rxOverflowSyn ) {
+            rx->_rxOverflowSyn->signal();
         }
     }
 }
@@ -368,6 +801,8 @@ void UsartRx::onRx( const uint8_t deviceNum, const uint8_t data )
 
 ISR( USART_TX_vect )
 {
+    trace_isr( USART_TX_vect_num );
+
     // last byte complete
     _usartTx[ 0 ]->byteTxComplete();
 }
@@ -375,6 +810,8 @@ ISR( USART_TX_vect )
 
 ISR( USART_UDRE_vect )
 {
+    trace_isr( USART_UDRE_vect_num );
+
     // need more data
     uint8_t nextByte;
 
@@ -389,6 +826,8 @@ ISR( USART_UDRE_vect )
 
 ISR( USART_RX_vect )
 {
+    trace_isr( USART_RX_vect_num );
+
     register volatile uint8_t newByte = UDR0;
     UsartRx::onRx( 0, newByte );
 }
@@ -400,6 +839,8 @@ ISR( USART_RX_vect )
 
 ISR( USART1_TX_vect )
 {
+    trace_isr( USART1_TX_vect_num );
+
     // last byte complete
     _usartTx[ 1 ]->byteTxComplete();
 }
@@ -407,6 +848,8 @@ ISR( USART1_TX_vect )
 
 ISR( USART1_UDRE_vect )
 {
+    trace_isr( USART1_UDRE_vect_num );
+
     // need more data
     uint8_t nextByte;
 
@@ -421,6 +864,8 @@ ISR( USART1_UDRE_vect )
 
 ISR( USART1_RX_vect )
 {
+    trace_isr( USART1_RX_vect_num );
+
     register volatile uint8_t newByte = UDR1;
     UsartRx::onRx( 1, newByte );
 }
@@ -432,6 +877,8 @@ ISR( USART1_RX_vect )
 
 ISR( USART2_TX_vect )
 {
+    trace_isr( USART2_TX_vect_num );
+
     // last byte complete
     _usartTx[ 2 ]->byteTxComplete();
 }
@@ -439,6 +886,8 @@ ISR( USART2_TX_vect )
 
 ISR( USART2_UDRE_vect )
 {
+    trace_isr( USART2_UDRE_vect_num );
+
     // need more data
     uint8_t nextByte;
 
@@ -453,6 +902,8 @@ ISR( USART2_UDRE_vect )
 
 ISR( USART2_RX_vect )
 {
+    trace_isr( USART2_RX_vect_num );
+
     register volatile uint8_t newByte = UDR2;
     UsartRx::onRx( 2, newByte );
 }
@@ -464,6 +915,8 @@ ISR( USART2_RX_vect )
 
 ISR( USART3_TX_vect )
 {
+    trace_isr( USART3_TX_vect_num );
+
     // last byte complete
     _usartTx[ 3 ]->byteTxComplete();
 }
@@ -471,6 +924,8 @@ ISR( USART3_TX_vect )
 
 ISR( USART3_UDRE_vect )
 {
+    trace_isr( USART3_UDRE_vect_num );
+
     // need more data
     uint8_t nextByte;
 
@@ -485,6 +940,8 @@ ISR( USART3_UDRE_vect )
 
 ISR( USART3_RX_vect )
 {
+    trace_isr( USART3_RX_vect_num );
+
     register volatile uint8_t newByte = UDR3;
     UsartRx::onRx( 3, newByte );
 }
@@ -22,10 +22,35 @@
 
 #include "thread.h"
 #include "doublebuffer.h"
+#include "bufferring.h"
+#include "pipe.h"
 
 
 namespace zero {
 
+    /// @brief One buffer in a chain of buffers queued on a UsartTx
+    /// @note The descriptor, and the buffer it points to, belong to the caller and must
+    /// stay put until the descriptor's Synapse is signalled (or the UsartTx's ready
+    /// Synapse, if it has none).
+    struct UsartTxDescriptor {
+        /// The data to transmit
+        const void* buffer;
+
+        /// The number of bytes to transmit
+        uint16_t numBytes;
+
+        /// Optional. The Synapse to signal once the buffer has been sent and may be reused
+        const Synapse* doneSyn;
+
+        /// Optional. If `true`, `buffer` points to Flash memory (for example, from `PSTR()`)
+        /// instead of SRAM
+        bool fromFlash;
+
+        /// @private
+        UsartTxDescriptor* next;
+    };
+
+
     /// @brief Provides a driver for accessing the hardware USART transmitters
     /// @code
     /// int hardwareTxDemoThread()
@@ -51,13 +76,33 @@ namespace zero {
         bool transmit(
             const void* buffer,
             const uint16_t sz,
-            const bool allowBlock = false );
+            const bool allowBlock = false,
+            const bool fromFlash = false );             // buffer points to Flash, not SRAM
+
+        bool queue( UsartTxDescriptor& d );
+        bool isBusy() const;
 
         explicit operator bool() const;
 
         #include "usarttx_private.h"
     };
 
+    /// @brief How a UsartRx splits what it receives into frames
+    enum class UsartFraming : uint8_t {
+        /// No framing - the data received Synapse follows the watermark (see `setWatermark()`)
+        None = 0,
+
+        /// Frames end with a delimiter byte, for example `'\n'` or SLIP's `0xC0`
+        Delimiter,
+
+        /// Frames start with a byte giving the number of bytes that follow it
+        LengthPrefixed,
+
+        /// Frames end when the line goes quiet for the idle timeout given to `setWatermark()`
+        IdleLine,
+    };
+
+
     /// @brief Provides a driver for accessing the hardware USART receivers
     class UsartRx {
     public:
@@ -70,10 +115,33 @@ namespace zero {
             Synapse& dataRecdSyn,
             Synapse* overflowSyn );
 
+        bool enable(
+            const uint16_t bufferSize,                  // bytes shared between the slots
+            const uint8_t numSlots,                     // slots in the receive ring
+            Synapse& dataRecdSyn,
+            Synapse* overflowSyn = nullptr );
+
+        #ifdef ZERO_DRIVERS_PIPE
+            bool enable(
+                Pipe& sink,                             // Pipe to write received bytes straight into
+                Synapse* overflowSyn = nullptr );       // Synapse to signal when the Pipe is full
+        #endif
+
         void disable();
         uint8_t* getCurrentBuffer( uint16_t& numBytes );
+        uint8_t* acquireBuffer( uint16_t& numBytes );   // takes the oldest filled slot of the receive ring
+        void releaseBuffer();                           // gives the slot back
         void flush();
 
+        void setWatermark(
+            const uint16_t numBytes,                    // bytes received before the data Synapse is signalled
+            const Duration idleTimeout = 0_ms );        // quiet period after which waitForData() returns anyway
+        void waitForData();                             // waits for a batch of data, or for the line to go quiet
+
+        void setFraming(
+            const UsartFraming mode,                    // how to find the end of each frame
+            const uint8_t delimiter = '\n' );           // the byte that ends a frame, for UsartFraming::Delimiter
+
         explicit operator bool() const;
 
         #include "usartrx_private.h"
@@ -14,9 +14,28 @@ public:
     Synapse* _rxDataReceivedSyn{ nullptr };
     Synapse* _rxOverflowSyn{ nullptr };
     DoubleBuffer* _rxBuffer{ nullptr };
+    BufferRing* _rxRing{ nullptr };                     // when set, used instead of _rxBuffer
+
+    #ifdef ZERO_DRIVERS_PIPE
+        Pipe* _rxPipe{ nullptr };                       // when set, received bytes go here instead
+    #endif
+
+    uint16_t _rxWatermark{ 1 };
+    uint16_t _rxIdleMs{ 0 };
+    volatile uint16_t _lastRxMs{ 0 };                   // low 16 bits of Thread::now()
+
+    UsartFraming _framing{ UsartFraming::None };
+    uint8_t _delimiter{ '\n' };
+    volatile uint16_t _frameEnd{ 0 };                   // bytes in the buffer that make up whole frames
+    uint16_t _frameLength{ 0 };                         // length of the frame being received, once known
+    uint16_t _dropBytes{ 0 };                           // bytes still to throw away from a frame that didn't fit
 
 private:
     UsartRx( const UsartRx& u ) = delete;
     void operator=( const UsartRx& u ) = delete;
 
+    void onFrameByte( const uint8_t data );
+    void onRingByte( const uint8_t data );
+    bool isFramed() const;
+
     uint8_t _deviceNum = 0;
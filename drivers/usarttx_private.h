@@ -16,7 +16,13 @@ private:
     UsartTx( const UsartTx& s ) = delete;
     void operator=( const UsartTx& s ) = delete;
 
+    void nextDescriptor();
+
     uint8_t _deviceNum{ 0 };
     uint8_t* _txBuffer{ nullptr };
     uint16_t _txBytesRemaining{ 0 };
+    bool _txFromFlash{ false };                         // read _txBuffer with pgm_read_byte()
+    UsartTxDescriptor* _txCurrent{ nullptr };           // the queued buffer being sent
+    UsartTxDescriptor* _txQueueHead{ nullptr };         // queued buffers still to send
+    UsartTxDescriptor* _txQueueTail{ nullptr };
     Synapse* _txReadySyn{ nullptr };
@@ -10,10 +10,17 @@
 /// @brief Contains classes for managing the Watchdog Timer
 
 
+#include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/wdt.h>
+#include <util/atomic.h>
+
 #include "thread.h"
 #include "watchdog.h"
+#include "power.h"
 #include "debug.h"
+#include "trace.h"
+#include "attrs.h"
 
 
 using namespace zero;
@@ -24,6 +31,38 @@ namespace {
     #ifdef ZERO_DRIVERS_WDT
         WatchdogFlags _allocatedFlags{ 0 };
         WatchdogFlags _currentPats{ 0 };
+        WatchdogFlags _deadlineFlags{ 0 };              // participants checked by the tick, not the WDT
+        Watchdog* _deadlineDogs[ sizeof( WatchdogFlags ) * 8 ];    // indexed by flag bit
+
+        // the report survives the reset in .noinit, and is only trusted if the magic matches
+        const uint16_t REPORT_MAGIC{ 0x5744 };
+        uint16_t _savedMagic NOINIT;
+        WatchdogReport _savedReport NOINIT;
+        WatchdogReport _lastReport{ WatchdogMiss::None, 0, nullptr, nullptr, 0UL };
+
+
+        // Gets the bit number of a single flag
+        uint8_t getFlagIndex( const WatchdogFlags flag )
+        {
+            uint8_t rc{ 0 };
+
+            while ( !( flag & ( 1U << rc ) ) ) {
+                rc++;
+            }
+
+            return rc;
+        }
+
+
+        // Resets the MCU as quickly as the WDT allows
+        void resetNow()
+        {
+            cli();
+            wdt_enable( WDTO_15MS );
+
+            while ( true )
+                ;
+        }
     #endif
 
 }    // namespace
@@ -32,6 +71,13 @@ namespace {
 void Watchdog::init()
 {
     #ifdef ZERO_DRIVERS_WDT
+        // pick up what was saved before the reset, if the WDT caused it
+        if ( ( Power::getResetFlags() & ResetFlags::Wdt ) and _savedMagic == REPORT_MAGIC ) {
+            _lastReport = _savedReport;
+        }
+
+        _savedMagic = 0;
+
         disable();
     #endif
 }
@@ -43,6 +89,11 @@ void Watchdog::init()
     void Watchdog::enable( const uint8_t dur )
     {
         wdt_enable( dur );
+
+        #ifdef WDIE
+            // interrupt first, so that a report can be saved, then reset
+            WDTCSR |= ( 1 << WDIE );
+        #endif
     }
 #else
     void Watchdog::enable( const uint8_t )
@@ -93,9 +144,56 @@ void Watchdog::disable()
 #endif
 
 
+/// @brief Creates a new Watchdog participant, with a deadline of its own
+/// @param deadline The longest time allowed between calls to pat(). It may be longer
+/// (or shorter) than `WATCHDOG_TIMEOUT`.
+/// @param name Optional. Default: `nullptr`. A name for the participant (pointer to
+/// Flash, not SRAM), to be saved in the WatchdogReport if it misses its deadline.
+/// @details The deadline is checked every kernel tick. A participant that misses it
+/// causes an immediate reset, and a WatchdogReport naming it, and the Thread that
+/// created it, is saved over the reset. Deadline participants don't have to pat()
+/// before the other participants' pats count.
+/// @note With `TICKLESS_IDLE` enabled, the tick comes once per stretch of idle time
+/// instead, so a missed deadline may be caught up to a stretch late (about 16ms, at 16MHz).
+#ifdef ZERO_DRIVERS_WDT
+    Watchdog::Watchdog( const Duration deadline, const char* const name )
+    :
+        Watchdog{}
+    {
+        if ( *this ) {
+            const bool fromThread{ !!( SREG & ( 1 << SREG_I ) ) };
+            const char* const threadName{ fromThread ? me.getName() : nullptr };
+
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                _deadlineMs = (uint32_t) deadline ? (uint32_t) deadline : 1UL;
+                _lastPatMs = Thread::now();
+                _name = name;
+                _threadName = threadName;
+
+                _deadlineDogs[ getFlagIndex( _flag ) ] = this;
+                _deadlineFlags |= _flag;
+                _currentPats &= ~_flag;
+            }
+        }
+    }
+#else
+    Watchdog::Watchdog( const Duration, const char* const )
+    :
+        _flag{ 0 }
+    {
+        // empty
+    }
+#endif
+
+
 Watchdog::~Watchdog()
 {
     #ifdef ZERO_DRIVERS_WDT
+        // the tick looks at deadline participants, so it mustn't see this one go
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+            _deadlineFlags &= ~_flag;
+        }
+
         ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
             _currentPats &= ~_flag;
             _allocatedFlags &= ~_flag;
@@ -143,13 +241,121 @@ Watchdog::operator bool() const
 void Watchdog::pat() const
 {
     #ifdef ZERO_DRIVERS_WDT
+        if ( _deadlineMs ) {
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                _lastPatMs = Thread::now();
+            }
+
+            return;
+        }
+
         ZERO_ATOMIC_BLOCK ( ZERO_ATOMIC_RESTORESTATE ) {
             _currentPats |= _flag;
 
-            if ( _currentPats == _allocatedFlags ) {
+            if ( _currentPats == ( _allocatedFlags & ~_deadlineFlags ) ) {
                 wdt_reset();
                 _currentPats = 0;
             }
         }
     #endif
 }
+
+
+/// @brief Gets what the Watchdog recorded just before the last reset
+/// @returns The WatchdogReport. Its `reason` is WatchdogMiss::None if the last reset
+/// wasn't caused by the Watchdog.
+/// @see Power::getResetFlags()
+WatchdogReport Watchdog::getResetReport()
+{
+    #ifdef ZERO_DRIVERS_WDT
+        return _lastReport;
+    #else
+        return WatchdogReport{ WatchdogMiss::None, 0, nullptr, nullptr, 0UL };
+    #endif
+}
+
+
+// Checks the deadline participants - called from the kernel tick, with interrupts off
+void Watchdog::onTick()
+{
+    #ifdef ZERO_DRIVERS_WDT
+        if ( !_allocatedFlags ) {
+            return;
+        }
+
+        const uint32_t now{ Thread::now() };
+        WatchdogFlags remaining{ _deadlineFlags };
+
+        for ( uint8_t i = 0; remaining; i++ ) {
+            const WatchdogFlags m{ (WatchdogFlags) ( 1U << i ) };
+
+            if ( remaining & m ) {
+                remaining &= ~m;
+
+                const Watchdog* const dog{ _deadlineDogs[ i ] };
+
+                if ( now - dog->_lastPatMs > dog->_deadlineMs ) {
+                    saveReport( WatchdogMiss::Deadline, m, dog->_name, dog->_threadName );
+                    resetNow();
+                }
+            }
+        }
+
+        // with no ordinary participants to do it, all's well, so keep the WDT quiet
+        if ( !( _allocatedFlags & ~_deadlineFlags ) ) {
+            wdt_reset();
+        }
+    #endif
+}
+
+
+// Determines if any participants have deadlines of their own, which
+// only the kernel tick checks (and keeps the WDT quiet for)
+bool Watchdog::hasDeadlines()
+{
+    #ifdef ZERO_DRIVERS_WDT
+        return _deadlineFlags;
+    #else
+        return false;
+    #endif
+}
+
+
+// Saves a report in .noinit memory, for after the reset
+#ifdef ZERO_DRIVERS_WDT
+    void Watchdog::saveReport(
+        const WatchdogMiss reason,
+        const WatchdogFlags lateFlags,
+        const char* const participant,
+        const char* const threadName )
+    {
+        _savedReport = WatchdogReport{ reason, lateFlags, participant, threadName, Thread::now() };
+        _savedMagic = REPORT_MAGIC;
+    }
+#else
+    void Watchdog::saveReport( const WatchdogMiss, const WatchdogFlags, const char* const, const char* const )
+    {
+        // empty
+    }
+#endif
+
+
+#ifdef ZERO_DRIVERS_WDT
+
+/// @private
+/// @brief The WDT's interrupt, just before it resets the MCU
+ISR( WDT_vect )
+{
+    trace_isr( WDT_vect_num );
+
+    // whoever hasn't patted is late, and whoever is running is the likely culprit
+    Watchdog::saveReport(
+        WatchdogMiss::Timeout,
+        ( _allocatedFlags & ~_deadlineFlags ) & ~_currentPats,
+        nullptr,
+        me.getName() );
+
+    resetNow();
+}
+
+#endif
@@ -12,12 +12,50 @@
 
 #include <stdint.h>
 #include <avr/wdt.h>
+#include "time.h"
 
 
 namespace zero {
 
     typedef uint16_t WatchdogFlags;
 
+
+    /// @brief Why the Watchdog last reset the MCU
+    enum class WatchdogMiss : uint8_t {
+        /// The last reset wasn't caused by a Watchdog (or nothing was recorded)
+        None = 0,
+
+        /// A participant with its own deadline didn't pat() in time
+        Deadline,
+
+        /// The WDT timed out, because not every participant patted within `WATCHDOG_TIMEOUT`
+        Timeout,
+    };
+
+
+    /// @brief What the Watchdog recorded just before it reset the MCU
+    /// @note Kept in `.noinit` memory over the reset, and read back with
+    /// Watchdog::getResetReport().
+    struct WatchdogReport {
+        /// What went wrong
+        WatchdogMiss reason;
+
+        /// The flags of the participants that were late
+        WatchdogFlags lateFlags;
+
+        /// For a missed deadline, the name given to the participant (pointer to Flash),
+        /// or `nullptr`
+        const char* participant;
+
+        /// For a missed deadline, the name of the Thread that created the participant.
+        /// For a timeout, the name of the Thread that was running - the likely hog.
+        /// (Pointer to Flash, or `nullptr`.)
+        const char* threadName;
+
+        /// Milliseconds since boot, when it happened
+        uint32_t uptimeMs;
+    };
+
     /// @brief Provides multi-participant Watchdog timer services
     /// @details Sections of code can opt in and out of patting the WDT as required. When
     /// multiple threads or even multiple sections of code within a single thread are
@@ -38,6 +76,11 @@ namespace zero {
     /// time. Be sure to check that your dog initialized correctly before proceeding.
     /// @note You can use a Watchdog in your onReset() handler if you have one, and also
     /// in main().
+    /// @details A participant can instead be given a deadline of its own, looser or
+    /// tighter than `WATCHDOG_TIMEOUT`. Deadline participants are checked every kernel
+    /// tick rather than by the WDT, and don't hold up the other participants' pats. If
+    /// one misses its deadline, or if the WDT times out, a WatchdogReport naming the late
+    /// participant and Thread is saved over the reset - see getResetReport().
     /// @details Another use for the Watchdog is to make the idle thread a participant.
     /// You might want to do this to check that your program isn't endlessly busy when it
     /// shouldn't be. You can override the default idle thread code by supplying your own
@@ -64,9 +107,16 @@ namespace zero {
     class Watchdog {
     public:
         Watchdog();
+
+        Watchdog(
+            const Duration deadline,                    // the longest allowed between pats
+            const char* const name = nullptr );         // name of the participant (pointer to Flash, not SRAM)
+
         explicit operator bool() const;
         void pat() const;
 
+        static WatchdogReport getResetReport();         // What the Watchdog recorded before the last reset
+
         #include "watchdog_private.h"
     };
 
@@ -11,8 +11,22 @@ public:
     static void init();
     static void enable( const uint8_t dur );
     static void disable();
+    static void onTick();
+    static bool hasDeadlines();
+    static void saveReport(
+        const WatchdogMiss reason,
+        const WatchdogFlags lateFlags,
+        const char* const participant,
+        const char* const threadName );
+
     ~Watchdog();
 
 private:
     static WatchdogFlags allocateFlag();
     const WatchdogFlags _flag;
+
+    // deadline participants only
+    uint32_t _deadlineMs{ 0UL };                        // 0 for an ordinary participant
+    mutable uint32_t _lastPatMs{ 0UL };
+    const char* _name{ nullptr };
+    const char* _threadName{ nullptr };
@@ -24,6 +24,7 @@
 #define DTOR __attribute__( ( destructor ) )
 #define ALIGNED( x ) __attribute__( ( aligned( ( x ) ) ) )
 #define CLEANUP( x ) __attribute__( ( cleanup( x ) ) )
+#define NOINIT __attribute__( ( section( ".noinit" ) ) )
 
 
 #endif
\ No newline at end of file
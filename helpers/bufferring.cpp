@@ -0,0 +1,211 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "bufferring.h"
+#include "memory.h"
+
+
+using namespace zero;
+
+
+/// @brief Creates a new BufferRing
+/// @param size The number of bytes to share between the slots. Slightly more is
+/// allocated, to keep track of each slot's length.
+/// @param numSlots The number of slots. At least two (2).
+BufferRing::BufferRing( const uint16_t size, const uint8_t numSlots )
+:
+    _buffer{ (uint8_t*) memory::allocate(
+        size + ( ( numSlots < 2 ) ? 2 : numSlots ) * sizeof( uint16_t ), &_bufferSize ) },
+    _numSlots{ ( numSlots < 2 ) ? (uint8_t) 2 : numSlots }
+{
+    _slotBytes = _buffer ? ( _bufferSize - _numSlots * sizeof( uint16_t ) ) / _numSlots : 0;
+}
+
+
+// dtor
+BufferRing::~BufferRing()
+{
+    memory::free( _buffer, _bufferSize );
+}
+
+
+/// @brief Determines if the BufferRing initialized correctly
+/// @returns `true` if the BufferRing initialized correctly, `false` otherwise.
+BufferRing::operator bool() const
+{
+    return _buffer and _slotBytes;
+}
+
+
+/// @brief Writes a byte into the slot being filled
+/// @param d The byte to write.
+/// @returns `true` if the byte was written, `false` if every slot is full or acquired.
+/// @note When the byte fills its slot, the slot is committed and the next free one is
+/// filled from then on.
+bool BufferRing::write( const uint8_t d )
+{
+    bool rc{ false };
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    if ( _numHeld + _numFilled < _numSlots ) {
+        const uint8_t slot{ getFillingSlot() };
+
+        getSlot( slot )[ _fillingBytes++ ] = d;
+
+        if ( _fillingBytes == _slotBytes ) {
+            commit();
+        }
+
+        rc = true;
+    }
+
+    SREG = oldSreg;
+
+    return rc;
+}
+
+
+/// @brief Closes the slot being filled, so that it can be acquired as it is
+/// @returns `true` if a slot was committed, `false` if there was nothing to commit.
+bool BufferRing::commit()
+{
+    bool rc{ false };
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    if ( _fillingBytes and _numHeld + _numFilled < _numSlots ) {
+        ( (uint16_t*) _buffer )[ getFillingSlot() ] = _fillingBytes;
+        _numFilled++;
+        _fillingBytes = 0;
+
+        rc = true;
+    }
+
+    SREG = oldSreg;
+
+    return rc;
+}
+
+
+/// @brief Takes the oldest filled slot, to be read in place
+/// @param numBytes A place to store the number of valid bytes in the slot.
+/// @returns A pointer to the slot, or `nullptr` if there's nothing to read. If no slot
+/// is full but the one being filled has something in it, that one is committed and
+/// returned.
+/// @note The slot stays the consumer's, and the producer won't touch it, until it is
+/// release()d. More than one slot may be held at once - they're released oldest first.
+uint8_t* BufferRing::acquire( uint16_t& numBytes )
+{
+    uint8_t* rc{ nullptr };
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    numBytes = 0;
+
+    if ( !_numFilled ) {
+        commit();
+    }
+
+    if ( _numFilled ) {
+        const uint8_t slot{ (uint8_t) ( ( _first + _numHeld ) % _numSlots ) };
+
+        numBytes = ( (uint16_t*) _buffer )[ slot ];
+        rc = getSlot( slot );
+
+        _numHeld++;
+        _numFilled--;
+    }
+
+    SREG = oldSreg;
+
+    return rc;
+}
+
+
+/// @brief Gives the oldest acquired slot back to the producer
+void BufferRing::release()
+{
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    if ( _numHeld ) {
+        _first = ( _first + 1 ) % _numSlots;
+        _numHeld--;
+    }
+
+    SREG = oldSreg;
+}
+
+
+/// @brief Discards everything filled or being filled
+/// @note Acquired slots stay acquired, until released.
+void BufferRing::flush()
+{
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    _numFilled = 0;
+    _fillingBytes = 0;
+
+    SREG = oldSreg;
+}
+
+
+// the number of bytes in the slot being filled
+uint16_t BufferRing::getFillingBytes() const
+{
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    const uint16_t rc{ _fillingBytes };
+
+    SREG = oldSreg;
+
+    return rc;
+}
+
+
+// the number of slots waiting to be acquired
+uint8_t BufferRing::getFilledCount() const
+{
+    return _numFilled;
+}
+
+
+// the number of bytes each slot can hold
+uint16_t BufferRing::getSlotBytes() const
+{
+    return _slotBytes;
+}
+
+
+// the number of slots in the ring
+uint8_t BufferRing::getSlotCount() const
+{
+    return _numSlots;
+}
+
+
+// the slot the producer writes into - only meaningful while one is free
+uint8_t BufferRing::getFillingSlot() const
+{
+    return ( _first + _numHeld + _numFilled ) % _numSlots;
+}
+
+
+// the data area of a slot, after the table of lengths
+uint8_t* BufferRing::getSlot( const uint8_t slot ) const
+{
+    return _buffer + _numSlots * sizeof( uint16_t ) + slot * _slotBytes;
+}
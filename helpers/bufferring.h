@@ -0,0 +1,48 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_BUFFERRING_H
+#define TCRI_ZERO_BUFFERRING_H
+
+
+#include <stdint.h>
+
+
+namespace zero {
+
+    /// @brief Provides a thread-safe ring of equal-sized buffer slots
+    /// @details The producer (typically an ISR) fills one slot at a time, moving on to
+    /// the next free slot whenever one fills up. The consumer acquire()s the oldest filled
+    /// slot and reads it in place, for as long as it likes, then release()s it. Meanwhile
+    /// the producer carries on filling the other slots, so a slow consumer only loses data
+    /// once every slot is full - unlike a DoubleBuffer, where the half being read is
+    /// handed back to the producer as soon as the other half is asked for.
+    class BufferRing {
+    public:
+        BufferRing( const uint16_t size, const uint8_t numSlots );
+        explicit operator bool() const;
+
+        bool write( const uint8_t d );                  // producer: appends a byte to the slot being filled
+        bool commit();                                  // closes the slot being filled, even if it isn't full
+
+        uint8_t* acquire( uint16_t& numBytes );         // consumer: takes the oldest filled slot
+        void release();                                 // consumer: gives back the oldest acquired slot
+        void flush();
+
+        uint16_t getFillingBytes() const;
+        uint8_t getFilledCount() const;
+        uint16_t getSlotBytes() const;
+        uint8_t getSlotCount() const;
+
+        #include "bufferring_private.h"
+    };
+
+}    // namespace zero
+
+
+#endif
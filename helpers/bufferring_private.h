@@ -0,0 +1,31 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+public:
+    /// @privatesection
+    ~BufferRing();
+
+private:
+    BufferRing( const BufferRing& b ) = delete;
+    void operator=( const BufferRing& b ) = delete;
+
+    uint8_t getFillingSlot() const;
+    uint8_t* getSlot( const uint8_t slot ) const;
+
+    // The slots, in ring order from _first, are: _numHeld acquired by the
+    // consumer, then _numFilled waiting for it, then the one being filled,
+    // then any free ones. When held and filled take every slot, there's
+    // nowhere to write.
+    uint16_t _bufferSize{ 0 };                          // declared before _buffer, whose initialiser sets it
+    uint8_t* const _buffer;                             // the slot lengths, then the slots themselves
+    const uint8_t _numSlots;
+    uint16_t _slotBytes;
+    uint8_t _first{ 0 };
+    uint8_t _numHeld{ 0 };
+    uint8_t _numFilled{ 0 };
+    uint16_t _fillingBytes{ 0 };
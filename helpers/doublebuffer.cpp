@@ -7,6 +7,7 @@
 
 
 #include <stdint.h>
+#include <string.h>
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
@@ -71,9 +72,11 @@ bool DoubleBuffer::write( const uint8_t d )
 
 /// @brief Returns the currently active half of the buffer
 /// @param numBytes A place to store the number of valid bytes in the buffer.
+/// @param maxBytes Optional. Default: `0xFFFF`. The most bytes to hand over. Anything
+/// past this stays behind, carried over into the other half for next time.
 /// @returns A pointer to the active half of the buffer, or `nullptr` if the buffer is
 /// empty.
-uint8_t* DoubleBuffer::getCurrentBuffer( uint16_t& numBytes )
+uint8_t* DoubleBuffer::getCurrentBuffer( uint16_t& numBytes, const uint16_t maxBytes )
 {
     const uint8_t oldSreg{ SREG };
     cli();
@@ -81,18 +84,21 @@ uint8_t* DoubleBuffer::getCurrentBuffer( uint16_t& numBytes )
     uint8_t* rc{ nullptr };
 
     // tell the caller how many bytes we have
-    numBytes = _usedBytes;
+    numBytes = ( _usedBytes < maxBytes ) ? _usedBytes : maxBytes;
 
-    // clear ready for more data
-    _usedBytes = 0;
+    // anything past maxBytes stays behind, for next time
+    const uint16_t carried{ (uint16_t) ( _usedBytes - numBytes ) };
+    const uint16_t oldOffset{ _writeOffset };
 
     // return the current half of the buffer
     if ( numBytes ) {
         rc = &_buffer[ _writeOffset ];
     }
 
-    // swap to the other half
+    // swap to the other half, taking the leftovers with us
     _writeOffset = _writeOffset == 0 ? _pivot : 0;
+    memcpy( &_buffer[ _writeOffset ], &_buffer[ oldOffset + numBytes ], carried );
+    _usedBytes = carried;
 
     // restore SREG and escape
     SREG = oldSreg;
@@ -101,6 +107,45 @@ uint8_t* DoubleBuffer::getCurrentBuffer( uint16_t& numBytes )
 }
 
 
+/// @brief Throws away everything in the current half past the first few bytes
+/// @param numBytes The number of bytes to keep. Nothing happens if there are no more
+/// than this waiting already.
+void DoubleBuffer::truncate( const uint16_t numBytes )
+{
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    if ( numBytes < _usedBytes ) {
+        _usedBytes = numBytes;
+    }
+
+    SREG = oldSreg;
+}
+
+
+/// @brief Determines how many bytes are waiting in the current half of the buffer
+/// @returns The number of bytes written since the halves were last swapped.
+uint16_t DoubleBuffer::getUsedBytes() const
+{
+    const uint8_t oldSreg{ SREG };
+    cli();
+
+    const uint16_t rc{ _usedBytes };
+
+    SREG = oldSreg;
+
+    return rc;
+}
+
+
+/// @brief Determines how many bytes each half of the buffer can hold
+/// @returns The capacity of one half of the buffer, in bytes.
+uint16_t DoubleBuffer::getCapacity() const
+{
+    return _pivot;
+}
+
+
 /// @brief Clears the buffer
 void DoubleBuffer::flush()
 {
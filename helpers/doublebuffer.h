@@ -22,9 +22,13 @@ namespace zero {
         explicit operator bool() const;
 
         bool write( const uint8_t d );
-        uint8_t* getCurrentBuffer( uint16_t& numBytes );
+        uint8_t* getCurrentBuffer( uint16_t& numBytes, const uint16_t maxBytes = 0xFFFF );
+        void truncate( const uint16_t numBytes );
         void flush();
 
+        uint16_t getUsedBytes() const;
+        uint16_t getCapacity() const;
+
         #include "doublebuffer_private.h"
     };
 
@@ -39,6 +39,23 @@ T* List<T>::getTail() const
 }
 
 
+/// @brief Determines if an item is in the List
+/// @param item The item to look for.
+/// @returns `true` if the item is in the List, `false` otherwise.
+/// @note This walks the List, so takes time proportional to its length.
+template <class T>
+bool List<T>::contains( const T& item ) const
+{
+    for ( const T* cur = _head; cur; cur = cur->_next ) {
+        if ( cur == &item ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
 /// @brief Adds a new item to the start of the List
 /// @param item The item to add to the List.
 template <class T>
@@ -20,6 +20,7 @@ namespace zero {
 
         T* getHead() const;
         T* getTail() const;
+        bool contains( const T& item ) const;
 
         void prepend( T& item );
         void append( T& item );
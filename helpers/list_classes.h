@@ -8,6 +8,8 @@
 
 #include "gpio.h"
 #include "thread.h"
+#include "timer.h"
+#include "task.h"
 
 
 #ifdef ZERO_DRIVERS_GPIO
@@ -16,3 +18,12 @@
 
 template class List<Thread>;
 template class OffsetList<Thread>;
+
+#ifdef ZERO_TASKS
+    template class List<Task>;
+#endif
+
+#ifdef ZERO_SOFT_TIMERS
+    template class List<Timer>;
+    template class OffsetList<Timer>;
+#endif
@@ -78,11 +78,25 @@ template <uint16_t PAGE_COUNT>
 uint16_t PageManager<PAGE_COUNT>::getFreePageCount() const
 {
     uint16_t rc{ 0 };
+    uint16_t i{ 0 };
+
+    while ( i < PAGE_COUNT ) {
+        // whole bytes that are all used or all free are easy
+        if ( !BF_BIT( i ) and i + 8 <= PAGE_COUNT ) {
+            const uint8_t b{ _memoryMap[ BF_BYTE( i ) ] };
+
+            if ( b == 0xFF or b == 0x00 ) {
+                rc += b ? 0 : 8;
+                i += 8;
+                continue;
+            }
+        }
 
-    for ( uint16_t i = 0; i < getTotalPageCount(); i++ ) {
         if ( isPageAvailable( i ) ) {
             rc++;
         }
+
+        i++;
     }
 
     return rc;
@@ -99,35 +113,46 @@ uint16_t PageManager<PAGE_COUNT>::getUsedPageCount() const
 }
 
 
-// search strategy function prototypes
-static uint16_t getPageForSearchStep_TopDown( const uint16_t step, const uint16_t totalPages );
-static uint16_t getPageForSearchStep_BottomUp( const uint16_t step, const uint16_t totalPages );
+/// @brief Gets the length of the longest run of contiguous available pages
+/// @returns The number of pages in the largest free run.
+/// @see getFreePageCount()
+template <uint16_t PAGE_COUNT>
+uint16_t PageManager<PAGE_COUNT>::getLargestFreeRun() const
+{
+    uint16_t rc{ 0 };
+    uint16_t runLength{ 0 };
+    uint16_t i{ 0 };
 
+    while ( i < PAGE_COUNT ) {
+        if ( !BF_BIT( i ) and i + 8 <= PAGE_COUNT ) {
+            const uint8_t b{ _memoryMap[ BF_BYTE( i ) ] };
 
-// search strategy - BottomUp starts searching the allocation table at the bottom and works up
-static uint16_t getPageForSearchStep_BottomUp(
-    const uint16_t step,
-    const uint16_t )
-{
-    return step;
-}
+            if ( b == 0xFF ) {
+                runLength = 0;
+                i += 8;
+                continue;
+            }
 
+            if ( b == 0x00 ) {
+                runLength += 8;
+                rc = MAX( rc, runLength );
+                i += 8;
+                continue;
+            }
+        }
 
-// search strategy - TopDown starts searching the allocation table at the top and works down
-static uint16_t getPageForSearchStep_TopDown(
-    const uint16_t step,
-    const uint16_t totalPages )
-{
-    return totalPages - ( step + 1 );
-}
+        if ( IS_PAGE_AVAIL( i ) ) {
+            runLength++;
+            rc = MAX( rc, runLength );
+        }
+        else {
+            runLength = 0;
+        }
 
+        i++;
+    }
 
-namespace {
-    // set up the vector table for the search strategies
-    uint16_t ( *_strategies[] )( const uint16_t, const uint16_t ) = {
-        getPageForSearchStep_TopDown,
-        getPageForSearchStep_BottomUp,
-    };
+    return rc;
 }
 
 
@@ -138,43 +163,194 @@ int16_t PageManager<PAGE_COUNT>::findFreePages(
     const uint16_t numPagesRequired,
     const memory::SearchStrategy strat ) const
 {
-    uint16_t startPage{ (uint16_t) -1 };
-    uint16_t pageCount{ 0 };
+    if ( !numPagesRequired or numPagesRequired > PAGE_COUNT ) {
+        return -1;
+    }
+
+    switch ( strat ) {
+        case memory::SearchStrategy::TopDown:
+            return findDown( numPagesRequired, 0, PAGE_COUNT );
+
+        case memory::SearchStrategy::NextFit: {
+            // carry on from where the last allocation ended, wrapping around once
+            const uint16_t cursor{ (uint16_t) ( _nextFit < PAGE_COUNT ? _nextFit : 0 ) };
+            const int16_t rc{ findUp( numPagesRequired, cursor, PAGE_COUNT ) };
+
+            return ( rc >= 0 ) ? rc : findUp( numPagesRequired, 0, MIN( (uint16_t) ( cursor + numPagesRequired - 1 ), PAGE_COUNT ) );
+        }
+
+        default:
+            return findUp( numPagesRequired, 0, PAGE_COUNT );
+    }
+}
+
+
+// Finds the lowest run of free pages within [ from, to ). Whole bytes of the
+// map are looked at in one go where possible, only the edges go bit by bit.
+template <uint16_t PAGE_COUNT>
+int16_t PageManager<PAGE_COUNT>::findUp(
+    const uint16_t numPagesRequired,
+    const uint16_t from,
+    const uint16_t to ) const
+{
+    uint16_t runStart{ from };
+    uint16_t runLength{ 0 };
+    uint16_t curPage{ from };
+
+    while ( curPage < to ) {
+        // a whole byte's worth of pages?
+        if ( !BF_BIT( curPage ) and curPage + 8 <= to ) {
+            const uint8_t b{ _memoryMap[ BF_BYTE( curPage ) ] };
+
+            if ( b == 0xFF ) {
+                // all used, skip the lot
+                runLength = 0;
+                curPage += 8;
+                continue;
+            }
+
+            if ( b == 0x00 ) {
+                // all free
+                if ( !runLength ) {
+                    runStart = curPage;
+                }
+
+                runLength += 8;
+                curPage += 8;
 
-    for ( uint16_t curStep = 0; curStep < PAGE_COUNT; curStep++ ) {
-        const uint16_t curPage{ _strategies[ (int) strat ]( curStep, PAGE_COUNT ) };
+                if ( runLength >= numPagesRequired ) {
+                    return runStart;
+                }
 
-        // If that page was free..
-        if ( isPageAvailable( curPage ) ) {
-            pageCount++;
+                continue;
+            }
+        }
 
-            // if we didn't have a startPage, we do now
-            if ( startPage == (uint16_t) -1 ) {
-                startPage = curPage;
+        if ( IS_PAGE_AVAIL( curPage ) ) {
+            if ( !runLength ) {
+                runStart = curPage;
             }
 
-            // if we've found the right number of pages, stop looking
-            if ( pageCount == numPagesRequired ) {
-                // MIN in case we searched backwards
-                startPage = MIN( startPage, curPage );
-                break;
+            if ( ++runLength == numPagesRequired ) {
+                return runStart;
             }
         }
         else {
-            // wasn't free? start the search from scratch
-            startPage = (uint16_t) -1;
-            pageCount = 0;
+            runLength = 0;
         }
+
+        curPage++;
     }
 
-    // if we couldn't find right number of pages
-    if ( pageCount < numPagesRequired ) {
-        return -1;
+    return -1;
+}
+
+
+// Finds the highest run of free pages within [ from, to ), returning the
+// lowest page of the highest numPagesRequired pages of that run
+template <uint16_t PAGE_COUNT>
+int16_t PageManager<PAGE_COUNT>::findDown(
+    const uint16_t numPagesRequired,
+    const uint16_t from,
+    const uint16_t to ) const
+{
+    uint16_t runTop{ 0 };
+    uint16_t runLength{ 0 };
+    uint16_t curPage{ to };
+
+    while ( curPage > from ) {
+        // a whole byte's worth of pages, ending at curPage?
+        if ( !BF_BIT( curPage ) and curPage >= from + 8 ) {
+            const uint8_t b{ _memoryMap[ BF_BYTE( curPage - 8 ) ] };
+
+            if ( b == 0xFF ) {
+                runLength = 0;
+                curPage -= 8;
+                continue;
+            }
+
+            if ( b == 0x00 ) {
+                if ( !runLength ) {
+                    runTop = curPage;
+                }
+
+                runLength += 8;
+                curPage -= 8;
+
+                if ( runLength >= numPagesRequired ) {
+                    return runTop - numPagesRequired;
+                }
+
+                continue;
+            }
+        }
+
+        curPage--;
+
+        if ( IS_PAGE_AVAIL( curPage ) ) {
+            if ( !runLength ) {
+                runTop = curPage + 1;
+            }
+
+            if ( ++runLength == numPagesRequired ) {
+                return curPage;
+            }
+        }
+        else {
+            runLength = 0;
+        }
     }
 
-    // if we get here, then we were successful at
-    // finding what the caller wanted
-    return startPage;
+    return -1;
+}
+
+
+/// @brief Marks a range of pages as used
+/// @param firstPage The first page to mark as unavailable.
+/// @param numPages The number of pages to mark.
+/// @note Whole bytes of the map are set in one go, only the edges go bit by bit.
+template <uint16_t PAGE_COUNT>
+void PageManager<PAGE_COUNT>::markAsUsed( const uint16_t firstPage, const uint16_t numPages )
+{
+    const uint16_t end{ (uint16_t) ( firstPage + numPages ) };
+    uint16_t curPage{ firstPage };
+
+    while ( curPage < end ) {
+        if ( !BF_BIT( curPage ) and curPage + 8 <= end ) {
+            _memoryMap[ BF_BYTE( curPage ) ] = 0xFF;
+            curPage += 8;
+        }
+        else {
+            MARK_AS_USED( curPage );
+            curPage++;
+        }
+    }
+
+    // next-fit searches pick up from here
+    _nextFit = end;
+}
+
+
+/// @brief Marks a range of pages as free
+/// @param firstPage The first page to mark as available.
+/// @param numPages The number of pages to mark.
+/// @note Whole bytes of the map are cleared in one go, only the edges go bit by bit.
+template <uint16_t PAGE_COUNT>
+void PageManager<PAGE_COUNT>::markAsFree( const uint16_t firstPage, const uint16_t numPages )
+{
+    const uint16_t end{ (uint16_t) ( firstPage + numPages ) };
+    uint16_t curPage{ firstPage };
+
+    while ( curPage < end ) {
+        if ( !BF_BIT( curPage ) and curPage + 8 <= end ) {
+            _memoryMap[ BF_BYTE( curPage ) ] = 0x00;
+            curPage += 8;
+        }
+        else {
+            MARK_AS_FREE( curPage );
+            curPage++;
+        }
+    }
 }
 
 
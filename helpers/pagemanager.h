@@ -31,6 +31,9 @@ namespace zero {
 
             /// Search forwards from the lowest address available
             BottomUp,
+
+            /// Search forwards from the end of the last allocation, wrapping around
+            NextFit,
         };
     }
 
@@ -46,10 +49,13 @@ namespace zero {
         bool isPageAvailable( const uint16_t pageNumber ) const;
         void markAsFree( const uint16_t pageNumber );
         void markAsUsed( const uint16_t pageNumber );
+        void markAsFree( const uint16_t firstPage, const uint16_t numPages );
+        void markAsUsed( const uint16_t firstPage, const uint16_t numPages );
 
         uint16_t getTotalPageCount() const;
         uint16_t getUsedPageCount() const;
         uint16_t getFreePageCount() const;
+        uint16_t getLargestFreeRun() const;
 
         #include "pagemanager_private.h"
     };
@@ -14,4 +14,8 @@ public:
         const memory::SearchStrategy strat ) const;
 
 private:
+    int16_t findUp( const uint16_t numPagesRequired, const uint16_t from, const uint16_t to ) const;
+    int16_t findDown( const uint16_t numPagesRequired, const uint16_t from, const uint16_t to ) const;
+
     uint8_t _memoryMap[ ROUND_UP( PAGE_COUNT, 8 ) / 8 ];
+    uint16_t _nextFit;                                  // where the next NextFit search starts
@@ -0,0 +1,174 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_SPSCRING_H
+#define TCRI_ZERO_SPSCRING_H
+
+
+#include <stdint.h>
+#include <util/atomic.h>
+
+
+namespace zero {
+
+    /// @private
+    // picks the narrowest index able to count to twice the ring's capacity
+    template <bool NARROW>
+    struct SpscRingIndex {
+        typedef uint8_t Type;
+    };
+
+    /// @private
+    template <>
+    struct SpscRingIndex<false> {
+        typedef uint16_t Type;
+    };
+
+
+    /// @brief A lock-free ring for passing items from one producer to one consumer
+    /// @details Typically the producer is an ISR and the consumer is a Thread (or the
+    /// other way around). The producer only ever writes the head index, and the consumer
+    /// only ever writes the tail, so neither side has to disable interrupts. With a
+    /// capacity of 128 items or fewer, both indices are single bytes, which the AVR reads
+    /// and writes atomically - pushing or popping is then just a handful of instructions.
+    /// @tparam T The type of item held in the ring.
+    /// @tparam CAPACITY The number of items the ring holds. Must be a power of two.
+    /// @note Everything lives in this header, so that push() and pop() can be inlined
+    /// into ISRs.
+    /// @note Only one context may push() and only one context may pop(). For anything
+    /// else, use a Pipe.
+    template <class T, uint16_t CAPACITY>
+    class SpscRing {
+
+        static_assert( CAPACITY > 0 and ( CAPACITY & ( CAPACITY - 1 ) ) == 0, "SpscRing capacity must be a power of two" );
+        static_assert( CAPACITY <= 32768, "SpscRing capacity must be no more than 32768 items" );
+
+        // the indices run freely, wrapping at twice the capacity or more, so that
+        // full (head - tail == CAPACITY) and empty (head == tail) look different
+        typedef typename SpscRingIndex<( CAPACITY <= 128 )>::Type Index;
+
+    public:
+
+        /// @brief Adds an item to the ring
+        /// @param item The item to add.
+        /// @returns `true` if the item was added, `false` if the ring was full.
+        /// @note Producer side only.
+        bool push( const T& item )
+        {
+            const Index head{ _head };
+
+            if ( (Index) ( head - load( _tail ) ) == CAPACITY ) {
+                return false;
+            }
+
+            _items[ head & ( CAPACITY - 1 ) ] = item;
+
+            // the item must be in place before the consumer can see it
+            barrier();
+            store( _head, head + 1 );
+
+            return true;
+        }
+
+        /// @brief Takes the oldest item from the ring
+        /// @param item A reference to the place to store the item.
+        /// @returns `true` if an item was taken (`item` will be valid), `false` if the
+        /// ring was empty.
+        /// @note Consumer side only.
+        bool pop( T& item )
+        {
+            const Index tail{ _tail };
+
+            if ( load( _head ) == tail ) {
+                return false;
+            }
+
+            item = _items[ tail & ( CAPACITY - 1 ) ];
+
+            // the item must be copied out before the producer can reuse its slot
+            barrier();
+            store( _tail, tail + 1 );
+
+            return true;
+        }
+
+        /// @brief Discards everything in the ring
+        /// @note Consumer side only.
+        void clear()
+        {
+            store( _tail, load( _head ) );
+        }
+
+        /// @brief Determines if the ring is empty
+        /// @returns `true` if there is nothing to pop(), `false` otherwise.
+        bool isEmpty() const
+        {
+            return load( _head ) == load( _tail );
+        }
+
+        /// @brief Determines if the ring is full
+        /// @returns `true` if there is no room to push(), `false` otherwise.
+        bool isFull() const
+        {
+            return getCount() == CAPACITY;
+        }
+
+        /// @brief Gets the number of items in the ring
+        /// @returns The number of items waiting to be popped.
+        uint16_t getCount() const
+        {
+            return (Index) ( load( _head ) - load( _tail ) );
+        }
+
+        /// @brief Gets the most items the ring can hold
+        /// @returns The ring's capacity.
+        static constexpr uint16_t getCapacity()
+        {
+            return CAPACITY;
+        }
+
+    private:
+        // 16-bit indices take two instructions to read or write, so only those
+        // need interrupts off - 8-bit ones never do
+        static Index load( const volatile Index& i )
+        {
+            if ( sizeof( Index ) == 1 ) {
+                return i;
+            }
+
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                return i;
+            }
+        }
+
+        static void store( volatile Index& i, const Index v )
+        {
+            if ( sizeof( Index ) == 1 ) {
+                i = v;
+                return;
+            }
+
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE ) {
+                i = v;
+            }
+        }
+
+        // stops the compiler moving item accesses past an index update
+        static void barrier()
+        {
+            __asm__ __volatile__ ( "" ::: "memory" );
+        }
+
+        T _items[ CAPACITY ];
+        volatile Index _head{ 0 };                      // written by the producer only
+        volatile Index _tail{ 0 };                      // written by the consumer only
+    };
+
+}    // namespace zero
+
+#endif
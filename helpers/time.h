@@ -43,6 +43,38 @@ namespace zero {
     };
 
 
+    /// @brief Simple class to specify short lengths of time, in microseconds
+    class MicroDuration {
+    public:
+
+        /// @brief Creates a new MicroDuration object
+        /// @param v The number of microseconds to be represented by the object
+        explicit constexpr MicroDuration( const uint32_t v )
+        :
+            _v{ v }
+        {
+            // empty
+        }
+
+        /// @brief Gets the number of microseconds represented by the object
+        explicit operator uint32_t() const
+        {
+            return (uint32_t) _v;
+        }
+
+    private:
+        uint32_t _v;
+    };
+
+
+    /// @brief Creates a literal constant MicroDuration of a given number of microseconds
+    /// @param v The number of microseconds to be represented by the new MicroDuration object.
+    inline constexpr MicroDuration operator""_us( const unsigned long long int v )
+    {
+        return MicroDuration{ (uint32_t) v };
+    }
+
+
     /// @brief Creates a literal constant Duration of a given number of milliseconds
     /// @param v The number of milliseconds to be represented by the new Duration object.
     inline constexpr Duration operator""_ms( const unsigned long long int v )
@@ -0,0 +1,123 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifdef ZERO_TIMER_WHEEL
+
+
+#include <stdint.h>
+#include "timerwheel.h"
+
+
+using namespace zero;
+
+
+/// @brief Adds an item to the wheel
+/// @param item The item to add to the wheel.
+/// @param now The current time, in ticks.
+/// @param offsetFromNow The number of ticks from now at which the item expires. Must
+/// not be zero.
+/// @note Takes the same time regardless of how many items are in the wheel.
+template <class T, uint8_t SLOTS>
+void TimerWheel<T, SLOTS>::insertByOffset( T& item, const uint32_t now, const uint32_t offsetFromNow )
+{
+    uint32_t deadline{ now + offsetFromNow };
+
+    // a deadline of zero would look like 'not sleeping' to the
+    // rest of the kernel, so once every 49 days we wake a tick late
+    if ( !deadline ) {
+        deadline = 1;
+    }
+
+    item._timeoutOffset = deadline;
+    getSlot( deadline ).append( item );
+}
+
+
+/// @brief Removes an item from the wheel
+/// @param item The item to remove from the wheel.
+/// @note Takes the same time regardless of how many items are in the wheel.
+template <class T, uint8_t SLOTS>
+void TimerWheel<T, SLOTS>::remove( T& item )
+{
+    getSlot( item._timeoutOffset ).remove( item );
+    item._timeoutOffset = 0UL;
+}
+
+
+/// @brief Removes and returns an item whose deadline is now
+/// @param now The current time, in ticks.
+/// @returns An expired item, or `nullptr` if none (or no more) expire at this tick.
+/// @note Only the one slot for this tick is looked at. Items sharing that slot with a
+/// later deadline are skipped over, but left untouched.
+template <class T, uint8_t SLOTS>
+T* TimerWheel<T, SLOTS>::popExpired( const uint32_t now )
+{
+    List<T>& slot{ getSlot( now ) };
+
+    for ( T* cur = slot.getHead(); cur; cur = cur->_next ) {
+        if ( cur->_timeoutOffset == now ) {
+            slot.remove( *cur );
+            cur->_timeoutOffset = 0UL;
+            return cur;
+        }
+    }
+
+    return nullptr;
+}
+
+
+/// @brief Finds how far away the next deadline is
+/// @param now The current time, in ticks.
+/// @param limit How many ticks into the future to look.
+/// @returns The number of ticks until the earliest item expires, or `0` if nothing
+/// expires within `limit` ticks.
+/// @note This looks at one slot per tick of `limit`, so keep `limit` small.
+template <class T, uint8_t SLOTS>
+uint32_t TimerWheel<T, SLOTS>::getNextOffset( const uint32_t now, const uint32_t limit ) const
+{
+    for ( uint32_t offset = 1; offset <= limit; offset++ ) {
+        const uint32_t deadline{ now + offset };
+
+        for ( const T* cur = _slots[ deadline & ( SLOTS - 1 ) ].getHead(); cur; cur = cur->_next ) {
+            if ( cur->_timeoutOffset == deadline ) {
+                return offset;
+            }
+        }
+    }
+
+    return 0UL;
+}
+
+
+/// @brief Determines if the wheel holds no items at all
+/// @returns `true` if no item is waiting to expire, `false` otherwise.
+/// @note Looks at every slot once, regardless of how many items there are.
+template <class T, uint8_t SLOTS>
+bool TimerWheel<T, SLOTS>::isEmpty() const
+{
+    for ( uint8_t i = 0; i < SLOTS; i++ ) {
+        if ( _slots[ i ].getHead() ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Finds the List for a given deadline
+template <class T, uint8_t SLOTS>
+List<T>& TimerWheel<T, SLOTS>::getSlot( const uint32_t deadline )
+{
+    return _slots[ deadline & ( SLOTS - 1 ) ];
+}
+
+
+#include "timerwheel_classes.h"
+
+#endif
@@ -0,0 +1,44 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_TIMERWHEEL_H
+#define TCRI_ZERO_TIMERWHEEL_H
+
+
+#include <stdint.h>
+#include "list.h"
+
+
+namespace zero {
+
+    /// @brief A template class for a hashed timer wheel
+    /// @details Items are hashed by their absolute deadline into one of `SLOTS` Lists, so
+    /// adding and removing an item takes the same time no matter how many items are
+    /// waiting. Each item's deadline is kept in it's `_timeoutOffset` member while it is
+    /// in the wheel.
+    template <class T, uint8_t SLOTS>
+    class TimerWheel {
+    public:
+        static_assert( SLOTS and !( SLOTS & ( SLOTS - 1 ) ), "TimerWheel SLOTS must be a power of 2" );
+
+        void insertByOffset( T& item, const uint32_t now, const uint32_t offsetFromNow );
+        void remove( T& item );
+
+        T* popExpired( const uint32_t now );
+        uint32_t getNextOffset( const uint32_t now, const uint32_t limit ) const;
+        bool isEmpty() const;
+
+    private:
+        List<T>& getSlot( const uint32_t deadline );
+
+        List<T> _slots[ SLOTS ];
+    };
+
+}    // namespace zero
+
+#endif
@@ -0,0 +1,12 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#include "thread.h"
+
+
+template class TimerWheel<Thread, TIMER_WHEEL_SLOTS>;
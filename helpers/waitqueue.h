@@ -0,0 +1,101 @@
+//
+// zero - pre-emptive multitasking kernel for AVR
+//
+// Techno Cosmic Research Institute    Dirk Mahoney           dirk@tcri.com.au
+// Catchpole Robotics                  Christian Catchpole    christian@catchpole.net
+//
+
+
+#ifndef TCRI_ZERO_WAITQUEUE_H
+#define TCRI_ZERO_WAITQUEUE_H
+
+
+namespace zero {
+
+    /// @brief An intrusive queue of the Threads blocked on a synchronization primitive
+    /// @details Each waiter is a small struct on the stack of the blocked Thread, linked
+    /// in through its own `next` pointer, so queueing never allocates. The Thread adds
+    /// itself before waiting on its Synapse, and takes itself out again if the wait times
+    /// out before anyone hands it what it was waiting for. Whoever does the handing over
+    /// takes the waiter out first, then signals it - with interrupts (or switching) still
+    /// off, so that the waiter can't go out of scope in between.
+    /// @tparam T The waiter type. Must have a `T* next` member, and a `Thread* thread`
+    /// member to use insertByPriority().
+    /// @note Not thread-safe. Every call must be made with interrupts off, or with
+    /// switching off if the primitive is never touched from an ISR.
+    template <class T>
+    class WaitQueue {
+    public:
+
+        /// @brief Gets the waiter at the front of the queue
+        /// @returns The waiter that would be popped next, or `nullptr` if the queue is empty.
+        T* getHead() const
+        {
+            return _head;
+        }
+
+        /// @brief Adds a waiter to the back of the queue
+        /// @param w The waiter to add.
+        void append( T& w )
+        {
+            T** cur{ &_head };
+
+            while ( *cur ) {
+                cur = &( *cur )->next;
+            }
+
+            w.next = nullptr;
+            *cur = &w;
+        }
+
+        /// @brief Adds a waiter behind everyone of the same or higher priority
+        /// @param w The waiter to add.
+        /// @note First come, first served within a priority level.
+        void insertByPriority( T& w )
+        {
+            T** cur{ &_head };
+
+            while ( *cur and ( *cur )->thread->getPriority() >= w.thread->getPriority() ) {
+                cur = &( *cur )->next;
+            }
+
+            w.next = *cur;
+            *cur = &w;
+        }
+
+        /// @brief Takes the waiter at the front of the queue
+        /// @returns The waiter, or `nullptr` if the queue is empty.
+        T* pop()
+        {
+            T* const rc{ _head };
+
+            if ( rc ) {
+                _head = rc->next;
+            }
+
+            return rc;
+        }
+
+        /// @brief Takes a waiter out of the queue, wherever it is
+        /// @param w The waiter to take out.
+        /// @returns `true` if the waiter was in the queue, `false` otherwise.
+        bool remove( T& w )
+        {
+            for ( T** cur = &_head; *cur; cur = &( *cur )->next ) {
+                if ( *cur == &w ) {
+                    *cur = w.next;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+        T* _head{ nullptr };
+    };
+
+}    // namespace zero
+
+
+#endif